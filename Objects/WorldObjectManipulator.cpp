@@ -17,6 +17,7 @@ WorldObjectManipulator::WorldObjectManipulator(World* world)
     , isDragging(false)
     , dragStartX(0)
     , dragStartY(0)
+    , dragHeight(0)
 {
     UpdateSelectableObjects();
 }
@@ -118,11 +119,16 @@ SelectableObject* WorldObjectManipulator::GetObjectAtPosition(const Vec3D& rayOr
     float closestDist = FLT_MAX;
     SelectableObject* closestObj = nullptr;
 
+    // nothing behind what the mouse is over
+    RayHit hit;
+    float maxT = world->raycast(rayOrigin, rayDir, world->culldistance, hit, false) ? hit.t : FLT_MAX;
+
     for (auto& obj : selectableObjects) {
         Vec3D toObj = obj.position - rayOrigin;
         float t = toObj * rayDir;
 
         if (t < 0) continue;
+        if (t > maxT + 3.0f) continue;
 
         Vec3D closest = rayOrigin + rayDir * t;
         float dist = (closest - obj.position).length();
@@ -148,6 +154,12 @@ void WorldObjectManipulator::StartDragging(float mouseX, float mouseY)
     dragStartX = mouseX;
     dragStartY = mouseY;
     dragStartPos = selectedObject->position;
+
+    // nodes sit on something; keep them that high over whatever they are dragged onto
+    RayHit hit;
+    dragHeight = 0;
+    if (world->raycast(dragStartPos + Vec3D(0, 2.0f, 0), Vec3D(0, -1.0f, 0), 100.0f, hit, false))
+        dragHeight = dragStartPos.y - hit.point.y;
 }
 
 void WorldObjectManipulator::UpdateDragging(float mouseX, float mouseY)
@@ -177,7 +189,18 @@ void WorldObjectManipulator::UpdateDragging(float mouseX, float mouseY)
         &farX, &farY, &farZ);
 
     Vec3D rayOrigin(nearX, nearY, nearZ);
-    Vec3D rayDir = Vec3D(farX - nearX, farY - nearY, farZ - nearZ).normalize();
+    Vec3D rayEnd(farX, farY, farZ);
+    Vec3D rayDir = (rayEnd - rayOrigin).normalize();
+
+    // Without CTRL the object goes onto the surface under the mouse
+    RayHit hit;
+    if (!allowYMovement && world->raycast(rayOrigin, rayDir, (rayEnd - rayOrigin).length(), hit, false)) {
+        selectedObject->position = hit.point + Vec3D(0, dragHeight, 0);
+        if (selectedObject->moveFunc) {
+            selectedObject->moveFunc(selectedObject->position);
+        }
+        return;
+    }
 
     // Use different intersection planes based on CTRL state
     Vec3D planeNormal;
@@ -189,7 +212,7 @@ void WorldObjectManipulator::UpdateDragging(float mouseX, float mouseY)
         planeDistance = -(planeNormal * dragStartPos);
     }
     else {
-        // Use ground plane when CTRL is not held
+        // Use ground plane when CTRL is not held and the mouse is over nothing
         planeNormal = Vec3D(0, 1, 0);
         planeDistance = -dragStartPos.y;
     }
@@ -203,8 +226,14 @@ void WorldObjectManipulator::UpdateDragging(float mouseX, float mouseY)
             Vec3D newPos = intersectionPoint;
 
             if (!allowYMovement) {
-                // Keep original Y height when not holding CTRL
-                newPos.y = dragStartPos.y;
+                // Keep the height above ground when not holding CTRL, so
+                // nodes follow the terrain; the original Y where there is none
+                float startGround, ground;
+                if (world->getHeight(dragStartPos.x, dragStartPos.z, startGround) &&
+                    world->getHeight(newPos.x, newPos.z, ground))
+                    newPos.y = ground + (dragStartPos.y - startGround);
+                else
+                    newPos.y = dragStartPos.y;
             }
 
             selectedObject->position = newPos;
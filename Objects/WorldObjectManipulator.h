@@ -65,6 +65,8 @@ private:
     bool isDragging;
     float dragStartX, dragStartY;
     Vec3D dragStartPos;
+    // how far above the surface below it the object was picked up
+    float dragHeight;
 
     void UpdateSelectableObjects();
     void RegisterTravelNodes();
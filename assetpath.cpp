@@ -0,0 +1,49 @@
+#include "assetpath.h"
+#include "mpq.h"
+#include <unordered_map>
+#include <mutex>
+
+namespace
+{
+    // entries are never freed, the set of paths in the archives is finite
+    std::unordered_map<std::string, AssetPath::Entry*>& table()
+    {
+        static std::unordered_map<std::string, AssetPath::Entry*> t;
+        return t;
+    }
+
+    std::mutex tableMutex;
+}
+
+AssetPath::AssetPath(const char* name)
+{
+    std::lock_guard<std::mutex> lock(tableMutex);
+
+    std::unordered_map<std::string, Entry*>& t = table();
+    std::unordered_map<std::string, Entry*>::iterator it = t.find(name);
+    if (it != t.end())
+    {
+        entry = it->second;
+        return;
+    }
+
+    Entry* e = new Entry;
+    e->name = name;
+    e->key = MPQCache::normalize(name);
+    e->nameHash = assetNameHash(name);
+    libmpq__file_hash(e->key.c_str(), &e->hash1, &e->hash2, &e->hash3);
+
+    t[e->name] = e;
+    entry = e;
+}
+
+AssetPath::AssetPath(const std::string& name) :
+    AssetPath(name.c_str())
+{
+}
+
+size_t AssetPath::internedCount()
+{
+    std::lock_guard<std::mutex> lock(tableMutex);
+    return table().size();
+}
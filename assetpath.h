@@ -0,0 +1,55 @@
+#ifndef ASSETPATH_H
+#define ASSETPATH_H
+
+#include <string>
+
+// FNV-1a, what the manager name tables hash with
+inline unsigned int assetNameHash(const char *s)
+{
+    unsigned int h = 2166136261u;
+    for (; *s; s++)
+    {
+        h ^= (unsigned char)*s;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// An archive path interned for the whole run. The first time a spelling is
+// seen it is normalized for the MPQ caches and its three MPQ name hashes are
+// computed; after that the same spelling yields the same entry, so copies
+// are a pointer and equal paths compare by address.
+class AssetPath
+{
+    public:
+        struct Entry
+        {
+            std::string name;       // as given
+            std::string key;        // upper case with backslashes, like MPQCache::normalize
+            unsigned int nameHash;  // assetNameHash(name)
+            unsigned int hash1, hash2, hash3;
+        };
+
+        AssetPath() : entry(0) {}
+        explicit AssetPath(const char* name);
+        explicit AssetPath(const std::string& name);
+
+        bool empty() const { return !entry; }
+        const std::string& str() const { return entry->name; }
+        const char* c_str() const { return entry->name.c_str(); }
+        const std::string& key() const { return entry->key; }
+        unsigned int nameHash() const { return entry->nameHash; }
+        unsigned int hash1() const { return entry->hash1; }
+        unsigned int hash2() const { return entry->hash2; }
+        unsigned int hash3() const { return entry->hash3; }
+
+        bool operator==(const AssetPath& other) const { return entry == other.entry; }
+        bool operator!=(const AssetPath& other) const { return entry != other.entry; }
+
+        static size_t internedCount();
+
+    private:
+        const Entry* entry;
+};
+
+#endif
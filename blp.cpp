@@ -0,0 +1,344 @@
+#include "blp.h"
+#include "video.h"
+#include "mpq.h"
+#include "dxt.h"
+#include "palette.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <string.h>
+
+namespace {
+
+// too big for maxSize, and not the last mip there is
+bool skipMip(int maxSize, int w, int h, int i, const int *offsets, const int *sizes)
+{
+	if (!maxSize || (w <= maxSize && h <= maxSize))
+		return false;
+	return i < 15 && offsets[i+1] && sizes[i+1];
+}
+
+// false when the sectors under it could not be read; a mip that runs past
+// the end of the file just gets what is there
+bool readAt(MPQFile &f, int offset, void *dest, int bytes)
+{
+	size_t size = f.getSize();
+	if (bytes <= 0 || offset < 0 || (size_t)offset >= size)
+		return true;
+	f.seek(offset);
+	return f.read(dest, bytes) == std::min((size_t)bytes, size - offset);
+}
+
+}
+
+size_t BLPImage::bytes() const
+{
+	size_t n = 0;
+	for (size_t i=0; i<mips.size(); i++)
+		n += mips[i].size;
+	return n;
+}
+
+BLPImage BLPImage::tail(int maxSize) const
+{
+	size_t first = 0;
+	while (first+1 < mips.size() && (mips[first].w > maxSize || mips[first].h > maxSize))
+		first++;
+
+	BLPImage t;
+	t.w = w;
+	t.h = h;
+	t.compressed = compressed;
+	t.format = format;
+	t.allocate(mips.begin() + first, mips.end());
+	for (size_t i=first; i<mips.size(); i++)
+		memcpy(t.pixels(i-first), pixels(i), mips[i].size);
+	return t;
+}
+
+void BLPImage::allocate(std::vector<Mip>::const_iterator begin, std::vector<Mip>::const_iterator end)
+{
+	mips.assign(begin, end);
+	size_t offset = 0;
+	for (size_t i=0; i<mips.size(); i++) {
+		mips[i].offset = offset;
+		offset += mips[i].size;
+	}
+	data = MPQBuffer(new char[offset ? offset : 1], std::default_delete<char[]>());
+}
+
+namespace {
+
+// Cache entries: this header, one BLPCacheMip per level, then the levels
+// back to back, ready to hand to GL as they are.
+struct BLPCacheHeader
+{
+	char magic[4];
+	unsigned int version;
+	unsigned int format;
+	unsigned int compressed;
+	int w, h;
+	unsigned int nMips;
+};
+
+struct BLPCacheMip
+{
+	int w, h;
+	unsigned int offset, size;
+};
+
+const unsigned int BLP_CACHE_VERSION = 1;
+
+// S3TC blocks and expanded RGBA are both valid for the same file, keyed by
+// what this machine uploads
+std::string cacheKey(const AssetPath &path)
+{
+	return "blpcache\\" + path.key() + (supportCompression ? ".s3tc" : ".rgba");
+}
+
+bool loadCached(const std::string &key, BLPImage &img, int maxSize)
+{
+	MPQBuffer data;
+	libmpq__off_t size;
+	if (!gMPQDiskCache.find(key, data, size))
+		return false;
+
+	const BLPCacheHeader *hdr = (const BLPCacheHeader*)data.get();
+	if ((size_t)size < sizeof(BLPCacheHeader) || memcmp(hdr->magic, "BLPC", 4) || hdr->version != BLP_CACHE_VERSION ||
+		hdr->nMips == 0 || hdr->nMips > 16 || sizeof(BLPCacheHeader) + hdr->nMips*sizeof(BLPCacheMip) > (size_t)size)
+		return false;
+
+	const BLPCacheMip *m = (const BLPCacheMip*)(hdr + 1);
+	img.w = hdr->w;
+	img.h = hdr->h;
+	img.format = hdr->format;
+	img.compressed = hdr->compressed != 0;
+	img.mips.clear();
+	for (unsigned int i=0; i<hdr->nMips; i++) {
+		if ((size_t)m[i].offset + m[i].size > (size_t)size)
+			return false;
+		BLPImage::Mip mip;
+		mip.w = m[i].w;
+		mip.h = m[i].h;
+		mip.offset = m[i].offset;
+		mip.size = m[i].size;
+		img.mips.push_back(mip);
+	}
+
+	// the mapped entry is the pixel storage, nothing is copied
+	img.data = data;
+
+	if (maxSize)
+		img = img.tail(maxSize);
+	return true;
+}
+
+void storeCached(const std::string &key, const BLPImage &img)
+{
+	size_t headerSize = sizeof(BLPCacheHeader) + img.mips.size()*sizeof(BLPCacheMip);
+	size_t size = headerSize + img.bytes();
+
+	MPQBuffer data(new char[size], std::default_delete<char[]>());
+	BLPCacheHeader *hdr = (BLPCacheHeader*)data.get();
+	memcpy(hdr->magic, "BLPC", 4);
+	hdr->version = BLP_CACHE_VERSION;
+	hdr->format = img.format;
+	hdr->compressed = img.compressed;
+	hdr->w = img.w;
+	hdr->h = img.h;
+	hdr->nMips = (unsigned int)img.mips.size();
+
+	BLPCacheMip *m = (BLPCacheMip*)(hdr + 1);
+	size_t offset = headerSize;
+	for (size_t i=0; i<img.mips.size(); i++) {
+		m[i].w = img.mips[i].w;
+		m[i].h = img.mips[i].h;
+		m[i].offset = (unsigned int)offset;
+		m[i].size = (unsigned int)img.mips[i].size;
+		memcpy(data.get() + offset, img.pixels(i), img.mips[i].size);
+		offset += img.mips[i].size;
+	}
+
+	gMPQDiskCache.store(key, data, (libmpq__off_t)size);
+}
+
+}
+
+namespace {
+
+// decodeBLP without the cache
+bool decode(const AssetPath &path, BLPImage &img, int maxSize)
+{
+	int offsets[16],sizes[16],w,h;
+	char attr[4];
+
+	// mips live at known offsets, stream them instead of inflating the whole file
+	MPQFile f(path, true);
+	if (f.isEof()) {
+		return false;
+	}
+
+	f.seek(8);
+	if (f.read(attr,4) != 4 || f.read(&w,4) != 4 || f.read(&h,4) != 4 ||
+		f.read(offsets,4*16) != 4*16 || f.read(sizes,4*16) != 4*16) {
+		return false;
+	}
+
+	img.w = w;
+	img.h = h;
+	img.mips.clear();
+
+	GLint format = GL_RGBA;
+	int blocksize = 8;
+
+	if (attr[0] == 2) {
+		// compressed
+		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+
+		// guesswork here :(
+		if (attr[1]==8) {
+			// dxt3 or 5, the alpha type says which
+			if (attr[2]==7) format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+			else format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+
+			blocksize = 16;
+
+		} else {
+			if (!attr[3]) format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		}
+
+		// without the extension the blocks are expanded here instead of by the driver
+		img.compressed = supportCompression;
+		img.format = supportCompression ? format : GL_RGBA;
+	}
+	else if (attr[0]==1) {
+		img.compressed = false;
+		img.format = GL_RGBA;
+	}
+	else {
+		return false;
+	}
+
+	// lay out the levels that are kept, then decode each into its place
+	std::vector<BLPImage::Mip> layout;
+	int level[16];
+	for (int i=0; i<16; i++) {
+		if (w==0) w = 1;
+		if (h==0) h = 1;
+		if (!offsets[i] || !sizes[i])
+			break;
+		if (!skipMip(maxSize, w, h, i, offsets, sizes)) {
+			BLPImage::Mip mip;
+			mip.w = w;
+			mip.h = h;
+			mip.offset = 0;
+			mip.size = img.compressed ? ((w+3)/4) * ((h+3)/4) * blocksize : w*h*4;
+			level[layout.size()] = i;
+			layout.push_back(mip);
+		}
+		w >>= 1;
+		h >>= 1;
+	}
+	if (layout.empty())
+		return false;
+	img.allocate(layout.begin(), layout.end());
+
+	std::vector<unsigned char> buf;
+
+	if (attr[0] == 2) {
+		for (size_t j=0; j<img.mips.size(); j++) {
+			int i = level[j];
+			const BLPImage::Mip &mip = img.mips[j];
+			int size = ((mip.w+3)/4) * ((mip.h+3)/4) * blocksize;
+
+			if (img.compressed) {
+				// the file may store less than a full set of blocks
+				memset(img.pixels(j), 0, size);
+				if (!readAt(f, offsets[i], img.pixels(j), std::min(size, sizes[i])))
+					return false;
+			} else {
+				buf.assign(std::max(size, sizes[i]), 0);
+				if (!readAt(f, offsets[i], &buf[0], sizes[i]))
+					return false;
+				decompressDXTC(format, mip.w, mip.h, size, &buf[0], img.pixels(j));
+			}
+		}
+	}
+	else {
+		// uncompressed
+		unsigned int pal[256];
+		f.seek(0x94);
+		if (f.read(pal,1024) != 1024)
+			return false;
+
+		int alphabits = attr[1];
+		if (alphabits!=1 && alphabits!=4 && alphabits!=8) alphabits = 0;
+
+		// swizzle once instead of per pixel, alpha comes from the alpha plane
+		unsigned int rgba[256];
+		for (int i=0; i<256; i++) {
+			unsigned int k = pal[i];
+			k = ((k&0x00FF0000)>>16) | ((k&0x0000FF00)) | ((k& 0x000000FF)<<16);
+			rgba[i] = alphabits ? k : k | 0xFF000000;
+		}
+
+		for (size_t j=0; j<img.mips.size(); j++) {
+			int i = level[j];
+			const BLPImage::Mip &mip = img.mips[j];
+			int n = mip.w*mip.h;
+
+			// indices followed by at most a byte of alpha per pixel
+			buf.assign(std::max(sizes[i], n*2), 0);
+			if (!readAt(f, offsets[i], &buf[0], sizes[i]))
+				return false;
+
+			expandPalette(rgba, &buf[0], &buf[0] + n, alphabits, n, (unsigned int*)img.pixels(j));
+		}
+	}
+
+	return true;
+}
+
+}
+
+bool decodeBLP(const AssetPath &path, BLPImage &img, int maxSize)
+{
+	if (!gMPQDiskCache.isOpen())
+		return decode(path, img, maxSize);
+
+	std::string key = cacheKey(path);
+	if (loadCached(key, img, maxSize))
+		return true;
+	if (!decode(path, img, maxSize))
+		return false;
+
+	// with nothing left out the chain is whole already
+	if (img.mips[0].w == img.w && img.mips[0].h == img.h) {
+		storeCached(key, img);
+	} else {
+		// the caller waits for the small mips only; the whole chain for the
+		// cache is decoded once the workers have nothing more pressing
+		gThreadPool.pushLow([path, key] {
+			BLPImage full;
+			if (decode(path, full, 0))
+				storeCached(key, full);
+		});
+	}
+	return true;
+}
+
+void uploadBLP(const BLPImage &img)
+{
+	for (size_t i=0; i<img.mips.size(); i++) {
+		const BLPImage::Mip &mip = img.mips[i];
+		if (img.compressed) {
+			glCompressedTexImage2DARB(GL_TEXTURE_2D, (GLint)i, img.format, mip.w, mip.h, 0, (GLsizei)mip.size, img.pixels(i));
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA8, mip.w, mip.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, img.pixels(i));
+		}
+	}
+
+	// levels past the chain may be left over from a longer one
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAX_LEVEL,(GLint)img.mips.size()-1);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+}
@@ -0,0 +1,54 @@
+#ifndef BLP_H
+#define BLP_H
+
+#include <vector>
+#include <SDL_opengl.h>
+#include "mpq.h"
+
+// A BLP texture decoded into the exact buffers glTexImage2D or
+// glCompressedTexImage2DARB want. All levels share one buffer, which is
+// either owned or a memory-mapped texture cache entry.
+struct BLPImage
+{
+	struct Mip
+	{
+		int w, h;
+		size_t offset, size;
+	};
+
+	int w, h;
+	bool compressed;	// data is S3TC blocks in format, otherwise RGBA8
+	GLenum format;
+	std::vector<Mip> mips;
+	MPQBuffer data;
+
+	BLPImage(): w(0), h(0), compressed(false), format(GL_RGBA) {}
+
+	unsigned char *pixels(size_t i) { return (unsigned char*)data.get() + mips[i].offset; }
+	const unsigned char *pixels(size_t i) const { return (const unsigned char*)data.get() + mips[i].offset; }
+
+	size_t bytes() const;
+
+	// a copy of just the mips that fit in maxSize (at least the last one),
+	// with its own storage
+	BLPImage tail(int maxSize) const;
+
+	// sets mips and gives them fresh, packed storage
+	void allocate(std::vector<Mip>::const_iterator begin, std::vector<Mip>::const_iterator end);
+};
+
+// Reads and decodes a BLP from the open archives. Touches no GL state, so
+// it is safe to call from worker threads. With maxSize set, mips wider or
+// taller than that are skipped, except the last one in the file.
+//
+// With the disk cache open, decoded chains are kept there (in the format
+// this machine uploads) and later loads map them instead of decoding. A
+// miss with maxSize set decodes just the mips asked for and leaves the
+// whole chain for the cache to a ThreadPool::pushLow job.
+bool decodeBLP(const AssetPath &path, BLPImage &img, int maxSize = 0);
+
+// Uploads the decoded mips as levels 0..n-1 of the texture bound to
+// GL_TEXTURE_2D, so a shorter chain replaces (and shrinks) a longer one.
+void uploadBLP(const BLPImage &img);
+
+#endif
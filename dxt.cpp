@@ -0,0 +1,258 @@
+#include "dxt.h"
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define DXT_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+// decodes one 4x4 block into four rows of 16 bytes, pitch bytes apart
+typedef void (*DecodeBlock)(GLint format, const unsigned char *src, unsigned char *dest, int pitch);
+
+bool hasAlphaBlock(GLint format)
+{
+    return format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+}
+
+// the eight DXT5 alpha levels and the 3 bit index of every pixel
+void dxt5Alpha(const unsigned char *src, unsigned char *alpha)
+{
+    unsigned int a[8];
+    a[0] = src[0];
+    a[1] = src[1];
+    if (a[0] > a[1]) {
+        for (int i=2; i<8; i++)
+            a[i] = ((8-i)*a[0] + (i-1)*a[1]) / 7;
+    } else {
+        for (int i=2; i<6; i++)
+            a[i] = ((6-i)*a[0] + (i-1)*a[1]) / 5;
+        a[6] = 0;
+        a[7] = 255;
+    }
+
+    unsigned long long bits = 0;
+    for (int i=0; i<6; i++)
+        bits |= (unsigned long long)src[2+i] << (8*i);
+
+    for (int i=0; i<16; i++) {
+        alpha[i] = (unsigned char)a[bits & 0x07];
+        bits >>= 3;
+    }
+}
+
+struct Color {
+    unsigned char r, g, b;
+};
+
+void decodeBlockScalar(GLint format, const unsigned char *src, unsigned char *dest, int pitch)
+{
+    // sort of copied from linghuye
+    unsigned char alpha[16];
+    if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
+        for (int i=0; i<8; i++) {
+            alpha[2*i] = (unsigned char)((src[i] & 0x0f) << 4);
+            alpha[2*i+1] = (unsigned char)(src[i] & 0xf0);
+        }
+        src += 8;
+    } else if (format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) {
+        dxt5Alpha(src, alpha);
+        src += 8;
+    }
+
+    unsigned int c0 = src[0] | (src[1] << 8);
+    unsigned int c1 = src[2] | (src[3] << 8);
+    src += 4;
+
+    Color color[4];
+    color[0].r = (unsigned char) ((c0 >> 11) & 0x1f) << 3;
+    color[0].g = (unsigned char) ((c0 >>  5) & 0x3f) << 2;
+    color[0].b = (unsigned char) ((c0      ) & 0x1f) << 3;
+    color[1].r = (unsigned char) ((c1 >> 11) & 0x1f) << 3;
+    color[1].g = (unsigned char) ((c1 >>  5) & 0x3f) << 2;
+    color[1].b = (unsigned char) ((c1      ) & 0x1f) << 3;
+    if(c0 > c1) {
+        color[2].r = (color[0].r * 2 + color[1].r) / 3;
+        color[2].g = (color[0].g * 2 + color[1].g) / 3;
+        color[2].b = (color[0].b * 2 + color[1].b) / 3;
+        color[3].r = (color[0].r + color[1].r * 2) / 3;
+        color[3].g = (color[0].g + color[1].g * 2) / 3;
+        color[3].b = (color[0].b + color[1].b * 2) / 3;
+    } else {
+        color[2].r = (color[0].r + color[1].r) / 2;
+        color[2].g = (color[0].g + color[1].g) / 2;
+        color[2].b = (color[0].b + color[1].b) / 2;
+        color[3].r = 0;
+        color[3].g = 0;
+        color[3].b = 0;
+    }
+
+    for (int j=0; j<4; j++) {
+        unsigned int index = src[j];
+        unsigned char *dd = dest + j*pitch;
+        for (int i=0; i<4; i++) {
+            *dd++ = color[index & 0x03].r;
+            *dd++ = color[index & 0x03].g;
+            *dd++ = color[index & 0x03].b;
+            if (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) {
+                *dd++ = ((index & 0x03) == 3 && c0 <= c1) ? 0 : 255;
+            } else if (hasAlphaBlock(format)) {
+                *dd++ = alpha[j*4 + i];
+            } else {
+                *dd++ = 255;
+            }
+            index >>= 2;
+        }
+    }
+}
+
+#ifdef DXT_SSE2
+
+// The four block colors as packed RGBA, computed two endpoints at a time in
+// 16 bit lanes. x/3 is exact as a multiply by 0x5556 for x < 768.
+inline __m128i colorPalette(GLint format, unsigned int c0, unsigned int c1)
+{
+    short opaque = hasAlphaBlock(format) ? 0 : 255;
+    __m128i a = _mm_setr_epi16(
+        (short)(((c0 >> 11) & 0x1f) << 3), (short)(((c0 >> 5) & 0x3f) << 2), (short)((c0 & 0x1f) << 3), opaque,
+        (short)(((c1 >> 11) & 0x1f) << 3), (short)(((c1 >> 5) & 0x3f) << 2), (short)((c1 & 0x1f) << 3), opaque);
+    __m128i b = _mm_shuffle_epi32(a, _MM_SHUFFLE(1,0,3,2));
+
+    __m128i mid;
+    if (c0 > c1) {
+        mid = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(a, a), b), _mm_set1_epi16(0x5556));
+    } else {
+        // color 3 is black, and transparent for DXT1 with alpha
+        short keepAlpha = format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT ? 0 : -1;
+        mid = _mm_srli_epi16(_mm_add_epi16(a, b), 1);
+        mid = _mm_and_si128(mid, _mm_setr_epi16(-1, -1, -1, -1, 0, 0, 0, keepAlpha));
+    }
+    return _mm_packus_epi16(a, mid);
+}
+
+void decodeBlockSSE2(GLint format, const unsigned char *src, unsigned char *dest, int pitch)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i alpha[4];
+    bool hasAlpha = hasAlphaBlock(format);
+
+    if (hasAlpha) {
+        // sixteen alpha bytes in pixel order
+        __m128i a8;
+        if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT) {
+            const __m128i low = _mm_set1_epi8(0x0f);
+            __m128i packed = _mm_loadl_epi64((const __m128i*)src);
+            __m128i lo = _mm_and_si128(packed, low);
+            __m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), low);
+            a8 = _mm_slli_epi16(_mm_unpacklo_epi8(lo, hi), 4);
+        } else {
+            unsigned char a[16];
+            dxt5Alpha(src, a);
+            a8 = _mm_loadu_si128((const __m128i*)a);
+        }
+        src += 8;
+
+        // move every byte to the top of its pixel
+        __m128i a16lo = _mm_unpacklo_epi8(zero, a8);
+        __m128i a16hi = _mm_unpackhi_epi8(zero, a8);
+        alpha[0] = _mm_unpacklo_epi16(zero, a16lo);
+        alpha[1] = _mm_unpackhi_epi16(zero, a16lo);
+        alpha[2] = _mm_unpacklo_epi16(zero, a16hi);
+        alpha[3] = _mm_unpackhi_epi16(zero, a16hi);
+    }
+
+    unsigned int c0 = src[0] | (src[1] << 8);
+    unsigned int c1 = src[2] | (src[3] << 8);
+    __m128i pal = colorPalette(format, c0, c1);
+    __m128i p0 = _mm_shuffle_epi32(pal, 0x00);
+    __m128i p1 = _mm_shuffle_epi32(pal, 0x55);
+    __m128i p2 = _mm_shuffle_epi32(pal, 0xaa);
+    __m128i p3 = _mm_shuffle_epi32(pal, 0xff);
+
+    // pixel i of a row wants bits 2i..2i+1 of the index byte: shift it up
+    // to bit 6 with a 16 bit multiply, then down again for every lane at once
+    const __m128i shifts = _mm_setr_epi32(64, 16, 4, 1);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i two = _mm_set1_epi32(2);
+    const __m128i three = _mm_set1_epi32(3);
+
+    for (int j=0; j<4; j++) {
+        __m128i idx = _mm_set1_epi32(src[4+j]);
+        idx = _mm_and_si128(_mm_srli_epi32(_mm_mullo_epi16(idx, shifts), 6), three);
+
+        __m128i px = _mm_or_si128(
+            _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(idx, zero), p0), _mm_and_si128(_mm_cmpeq_epi32(idx, one), p1)),
+            _mm_or_si128(_mm_and_si128(_mm_cmpeq_epi32(idx, two), p2), _mm_and_si128(_mm_cmpeq_epi32(idx, three), p3)));
+        if (hasAlpha)
+            px = _mm_or_si128(px, alpha[j]);
+
+        _mm_storeu_si128((__m128i*)(dest + j*pitch), px);
+    }
+}
+
+bool haveSSE2()
+{
+#if defined(_M_IX86)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    // always there on x64, and __SSE2__ means the compiler already relies on it
+    return true;
+#endif
+}
+
+#endif
+
+void decompress(DecodeBlock decodeBlock, GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest)
+{
+    size_t blockSize = hasAlphaBlock(format) ? 16 : 8;
+    unsigned char *end = src + size;
+    unsigned char edge[64];
+
+    for (int y=0; y<h; y += 4) {
+        for (int x=0; x<w; x += 4) {
+            if ((size_t)(end - src) < blockSize)
+                return;
+
+            if (x+4 <= w && y+4 <= h) {
+                decodeBlock(format, src, dest + (w*y+x)*4, w*4);
+            } else {
+                // small mips only use the top left corner of the block
+                decodeBlock(format, src, edge, 16);
+                int bw = (w-x < 4) ? w-x : 4;
+                int bh = (h-y < 4) ? h-y : 4;
+                for (int j=0; j<bh; j++)
+                    memcpy(dest + (w*(y+j)+x)*4, edge + j*16, bw*4);
+            }
+            src += blockSize;
+        }
+    }
+}
+
+DecodeBlock selectDecoder()
+{
+#ifdef DXT_SSE2
+    if (haveSSE2())
+        return decodeBlockSSE2;
+#endif
+    return decodeBlockScalar;
+}
+
+}
+
+void decompressDXTC(GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest)
+{
+    // textures are decoded on worker threads, static init is thread safe
+    static const DecodeBlock decodeBlock = selectDecoder();
+    decompress(decodeBlock, format, w, h, size, src, dest);
+}
+
+void decompressDXTCScalar(GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest)
+{
+    decompress(decodeBlockScalar, format, w, h, size, src, dest);
+}
@@ -0,0 +1,15 @@
+#ifndef DXT_H
+#define DXT_H
+
+#include <stddef.h>
+#include <SDL_opengl.h>
+
+// Expands S3TC blocks (DXT1 RGB/RGBA, DXT3, DXT5) into w*h RGBA8 pixels for
+// drivers without GL_EXT_texture_compression_s3tc. Picks the SSE2 decoder
+// when the CPU has it.
+void decompressDXTC(GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest);
+
+// Plain C++ decoder, same output as decompressDXTC.
+void decompressDXTCScalar(GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest);
+
+#endif
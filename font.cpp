@@ -33,7 +33,7 @@ Font::Font(unsigned int tex, int tw, int th, int size, const char* infofile) : t
     }
 
     if (!in.is_open()) {
-        gLog("Error: Could not open font info file %s\n", infofile);
+        gLogError("Error: Could not open font info file %s\n", infofile);
         throw runtime_error("Failed to open font info file");
     }
 
@@ -48,7 +48,7 @@ Font::Font(unsigned int tex, int tw, int th, int size, const char* infofile) : t
         for (int i = 0; i < 7; i++) {
             if (!(in >> line[i])) {
                 if (in.eof()) break;  // Normal end of file
-                gLog("Error reading font info at parameter %d\n", i);
+                gLogError("Error reading font info at parameter %d\n", i);
                 in.close();
                 throw runtime_error("Failed to read font info data");
             }
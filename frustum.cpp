@@ -1,5 +1,10 @@
 #include "frustum.h"
-#include "video.h"
+#include <SDL_opengl.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
 
 
 void Plane::normalize()
@@ -27,6 +32,8 @@ void Frustum::retrieve()
 	
 	glPopMatrix();
 	glMatrixMode(GL_MODELVIEW);
+
+	for (int i=0; i<16; i++) matrix[i] = mat[i];
 	
 	planes[RIGHT].a = mat[ 3] - mat[ 0];
 	planes[RIGHT].b = mat[ 7] - mat[ 4];
@@ -78,29 +85,13 @@ bool Frustum::contains(const Vec3D &v) const
 
 bool Frustum::intersects(const Vec3D &v1, const Vec3D &v2) const
 {
-	Vec3D points[8];
-	points[0] = Vec3D(v1.x,v1.y,v1.z);
-	points[1] = Vec3D(v1.x,v1.y,v2.z);
-	points[2] = Vec3D(v1.x,v2.y,v1.z);
-	points[3] = Vec3D(v1.x,v2.y,v2.z);
-	points[4] = Vec3D(v2.x,v1.y,v1.z);
-	points[5] = Vec3D(v2.x,v1.y,v2.z);
-	points[6] = Vec3D(v2.x,v2.y,v1.z);
-	points[7] = Vec3D(v2.x,v2.y,v2.z);
-
- 	for (int i=0; i<6; i++) {
-		int numIn = 0;
-
-		for (int k=0; k<8; k++) {
-			if ((planes[i].a*points[k].x + planes[i].b*points[k].y + planes[i].c*points[k].z + planes[i].d) > 0)
-			{
-				numIn++;
-			}
-		}
-
-		if (numIn == 0) return false;
+	// the box is out when even its corner farthest along the plane normal
+	// is behind the plane; same as testing all eight corners
+	Vec3D c = (v1 + v2) * 0.5f, e = (v2 - v1) * 0.5f;
+	for (int i=0; i<6; i++) {
+		const Plane &p = planes[i];
+		if (p.a*c.x + p.b*c.y + p.c*c.z + p.d + fabsf(p.a)*e.x + fabsf(p.b)*e.y + fabsf(p.c)*e.z <= 0) return false;
 	}
-
 	return true;
 }
 
@@ -115,3 +106,115 @@ bool Frustum::intersectsSphere(const Vec3D& v, const float rad) const
 	return true;
 }
 
+
+void Boxes4::set(int i, const Vec3D &v1, const Vec3D &v2)
+{
+	cx[i] = (v1.x + v2.x) * 0.5f;
+	cy[i] = (v1.y + v2.y) * 0.5f;
+	cz[i] = (v1.z + v2.z) * 0.5f;
+	ex[i] = (v2.x - v1.x) * 0.5f;
+	ey[i] = (v2.y - v1.y) * 0.5f;
+	ez[i] = (v2.z - v1.z) * 0.5f;
+}
+
+void SphereList::clear()
+{
+	x.clear();
+	y.clear();
+	z.clear();
+	r.clear();
+}
+
+void SphereList::add(const Vec3D &c, float rad)
+{
+	x.push_back(c.x);
+	y.push_back(c.y);
+	z.push_back(c.z);
+	r.push_back(rad);
+}
+
+namespace {
+
+// Four boxes or spheres against the planes, starting at hint and stopping
+// once all four are out. Spheres are boxes with no extent and the radius
+// as the margin; ex etc. may be 0 then. Returns the lanes that are out.
+#ifdef FRUSTUM_SSE
+int outside4(const Plane *planes, const float *cx, const float *cy, const float *cz,
+			 const float *ex, const float *ey, const float *ez, const float *rad, unsigned char &hint)
+{
+	const __m128 zero = _mm_setzero_ps();
+	__m128 x = _mm_loadu_ps(cx), y = _mm_loadu_ps(cy), z = _mm_loadu_ps(cz);
+	__m128 hx = ex ? _mm_loadu_ps(ex) : zero;
+	__m128 hy = ey ? _mm_loadu_ps(ey) : zero;
+	__m128 hz = ez ? _mm_loadu_ps(ez) : zero;
+	__m128 r = rad ? _mm_loadu_ps(rad) : zero;
+
+	int out = 0, first = -1;
+	for (int k=0, p=hint; k<6 && out != 15; k++, p = p == 5 ? 0 : p + 1) {
+		const Plane &pl = planes[p];
+		__m128 dist = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.a), x), _mm_mul_ps(_mm_set1_ps(pl.b), y)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(pl.c), z), _mm_set1_ps(pl.d)));
+		__m128 reach = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(pl.a)), hx), _mm_mul_ps(_mm_set1_ps(fabsf(pl.b)), hy)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(fabsf(pl.c)), hz), r));
+		int o = _mm_movemask_ps(_mm_cmple_ps(_mm_add_ps(dist, reach), zero));
+		if ((o & ~out) && first < 0) first = p;
+		out |= o;
+	}
+	if (first >= 0) hint = (unsigned char)first;
+	return out;
+}
+#else
+int outside4(const Plane *planes, const float *cx, const float *cy, const float *cz,
+			 const float *ex, const float *ey, const float *ez, const float *rad, unsigned char &hint)
+{
+	int out = 0, first = -1;
+	for (int k=0, p=hint; k<6 && out != 15; k++, p = p == 5 ? 0 : p + 1) {
+		const Plane &pl = planes[p];
+		int o = 0;
+		for (int i=0; i<4; i++) {
+			float reach = rad ? rad[i] : fabsf(pl.a)*ex[i] + fabsf(pl.b)*ey[i] + fabsf(pl.c)*ez[i];
+			if (pl.a*cx[i] + pl.b*cy[i] + pl.c*cz[i] + pl.d + reach <= 0) o |= 1 << i;
+		}
+		if ((o & ~out) && first < 0) first = p;
+		out |= o;
+	}
+	if (first >= 0) hint = (unsigned char)first;
+	return out;
+}
+#endif
+
+}
+
+unsigned int Frustum::intersects4(const Boxes4 &b, unsigned char &hint) const
+{
+	return ~outside4(planes, b.cx, b.cy, b.cz, b.ex, b.ey, b.ez, 0, hint) & 15;
+}
+
+void Frustum::cull(SphereList &s) const
+{
+	size_t n = s.size();
+	s.visible.assign((n + 31) / 32, 0);
+	s.hints.resize((n + 3) / 4, 0);
+
+	for (size_t i=0; i<n; i+=4) {
+		unsigned int in;
+		if (i + 4 <= n) {
+			in = ~outside4(planes, &s.x[i], &s.y[i], &s.z[i], 0, 0, 0, &s.r[i], s.hints[i/4]) & 15;
+		} else {
+			// the last few, padded out with copies of the first of them
+			float x[4], y[4], z[4], r[4];
+			for (int k=0; k<4; k++) {
+				size_t j = i + k < n ? i + k : i;
+				x[k] = s.x[j];
+				y[k] = s.y[j];
+				z[k] = s.z[j];
+				r[k] = s.r[j];
+			}
+			in = ~outside4(planes, x, y, z, 0, 0, 0, r, s.hints[i/4]) & ((1 << (n - i)) - 1);
+		}
+		// i is a multiple of 4, so the four bits never straddle a word
+		s.visible[i >> 5] |= in << (i & 31);
+	}
+}
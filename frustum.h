@@ -2,6 +2,7 @@
 #define FRUSTUM_H
 
 #include "vec3d.h"
+#include <vector>
 
 struct Plane {
 	float a,b,c,d;
@@ -12,14 +13,47 @@ enum Directions {
 	RIGHT, LEFT, BOTTOM, TOP, BACK, FRONT
 };
 
+// Four boxes by component, centers and half sizes, so that they go
+// through each plane together
+struct Boxes4 {
+	float cx[4], cy[4], cz[4];
+	float ex[4], ey[4], ez[4];
+
+	void set(int i, const Vec3D &v1, const Vec3D &v2);
+};
+
+// Spheres to test in one go, by component like Boxes4. Frustum::cull()
+// leaves one bit per sphere in visible. The hints are which plane turned
+// each group of four away last time, it is tried first on the next call,
+// so keep one list per set of things and refill it rather than making a
+// new one.
+struct SphereList {
+	std::vector<float> x, y, z, r;
+	std::vector<unsigned int> visible;
+	std::vector<unsigned char> hints;
+
+	void clear();
+	void add(const Vec3D &c, float rad);
+	size_t size() const { return r.size(); }
+	bool isVisible(size_t i) const { return (visible[i >> 5] >> (i & 31)) & 1; }
+};
+
 struct Frustum {
 	Plane planes[6];
+	// projection * modelview the planes came from, column major
+	float matrix[16];
 
 	void retrieve();
 
 	bool contains(const Vec3D &v) const;
 	bool intersects(const Vec3D &v1, const Vec3D &v2) const;
 	bool intersectsSphere(const Vec3D& v, const float rad) const;
+
+	// Bit i set for the boxes of b that intersects() would keep. hint is
+	// the plane to start with and is updated for the next frame
+	unsigned int intersects4(const Boxes4 &b, unsigned char &hint) const;
+	// fills s.visible, four spheres at a time
+	void cull(SphereList &s) const;
 };
 
 
@@ -18,7 +18,7 @@ bool GuiManager::Init(SDL_Surface* screen) {
     }
 
     if (!screen) {
-        gLog("Invalid screen surface passed to GUI manager\n");
+        gLogError("Invalid screen surface passed to GUI manager\n");
         return false;
     }
 
@@ -30,7 +30,7 @@ bool GuiManager::Init(SDL_Surface* screen) {
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
     if (!ImGui::GetCurrentContext()) {
-        gLog("Failed to create ImGui context\n");
+        gLogError("Failed to create ImGui context\n");
         return false;
     }
 
@@ -45,13 +45,13 @@ bool GuiManager::Init(SDL_Surface* screen) {
     style.Colors[ImGuiCol_WindowBg].w = 0.8f;
 
     if (!ImGui_ImplSDL1_Init()) {
-        gLog("Failed to initialize ImGui SDL1 backend\n");
+        gLogError("Failed to initialize ImGui SDL1 backend\n");
         ImGui::DestroyContext();
         return false;
     }
 
     if (!ImGui_ImplOpenGL2_Init()) {
-        gLog("Failed to initialize ImGui OpenGL2 backend\n");
+        gLogError("Failed to initialize ImGui OpenGL2 backend\n");
         ImGui_ImplSDL1_Shutdown();
         ImGui::DestroyContext();
         return false;
@@ -95,7 +95,7 @@ void GuiManager::Render(World* world, Test* test) {
         ImGui::NewFrame();
     }
     catch (...) {
-        gLog("Error in ImGui::NewFrame()\n");
+        gLogError("Error in ImGui::NewFrame()\n");
         return;
     }
 
@@ -165,6 +165,9 @@ void GuiManager::RenderMainControls(Test* test) {
     if (ImGui::Button("Toggle WMO"))
         test->world->drawwmo = !test->world->drawwmo;
 
+    if (ImGui::Button("Toggle Occlusion Culling"))
+        test->world->occlusionculling = !test->world->occlusionculling;
+
     if (ImGui::Button("Toggle Nodes"))
         test->world->drawnodes = !test->world->drawnodes;
 
@@ -222,6 +225,47 @@ void GuiManager::RenderCameraMapInfo(World* world)
 void GuiManager::RenderPerformance() {
     ImGui::Begin("Performance", &showPerformance);
     ImGui::Text("FPS: %.1f", gFPS);
+
+    MPQCache::Stats mpq = gMPQCache.getStats();
+    uint64 lookups = mpq.hits + mpq.misses;
+    ImGui::Separator();
+    ImGui::Text("MPQ cache: %.1f / %.1f MB, %zu files", mpq.bytes / 1048576.0f, gMPQCache.getBudget() / 1048576.0f, mpq.entries);
+    ImGui::Text("Hits: %llu  Misses: %llu  Evictions: %llu  (%.1f%% hit)",
+        (unsigned long long)mpq.hits, (unsigned long long)mpq.misses, (unsigned long long)mpq.evictions,
+        lookups ? 100.0f * mpq.hits / lookups : 0.0f);
+    if (gMPQDiskCache.isOpen())
+    {
+        MPQDiskCache::Stats disk = gMPQDiskCache.getStats();
+        ImGui::Text("Disk cache: %llu hits, %llu misses, %llu written",
+            (unsigned long long)disk.hits, (unsigned long long)disk.misses, (unsigned long long)disk.writes);
+    }
+
+    TextureManager::Stats tex = video.textures.getStats();
+    ImGui::Separator();
+    ImGui::Text("Textures: %zu pending, %zu decoded and queued for upload", tex.pending, tex.ready);
+    ImGui::Text("Uploaded: %u  Failed: %u", tex.uploaded, tex.failed);
+    ImGui::Text("Decode: %.2f ms avg  Upload: %.2f ms avg, %.2f ms last frame",
+        tex.avgDecodeMs, tex.avgUploadMs, tex.lastFrameUploadMs);
+    ImGui::Text("Texture memory: %.1f / %.1f MB  Streamed in: %u  Dropped: %u",
+        tex.residentBytes / 1048576.0f, tex.memoryBudget / 1048576.0f, tex.streamedIn, tex.dropped);
+
+    if (gWorld)
+    {
+        TileStreamer::Stats tiles = gWorld->streamer.getStats();
+        ImGui::Separator();
+        ImGui::Text("Tiles: %u parsed ahead, %d in flight, commit %.1f ms last frame",
+            tiles.prefetched, tiles.queued, tiles.lastBuildMs);
+        ImGui::Text("Crossings: %u  Hitches: %u  Last: %.1f ms  Worst: %.1f ms",
+            tiles.crossings, tiles.hitches, tiles.lastCrossingMs, tiles.worstCrossingMs);
+        TileCache::Stats cache = gWorld->tiles.getStats();
+        size_t pending = gWorld->streamer.pendingBytes();
+        ImGui::Text("Tile memory: %.1f + %.1f parsed / %.1f MB in %u tiles  Evicted: %u  Waiting to unload: %u",
+            cache.bytes / 1048576.0f, pending / 1048576.0f, cache.budget / 1048576.0f, (unsigned int)cache.tiles,
+            cache.evictions, (unsigned int)cache.dropped);
+        OcclusionBuffer::Stats occ = gWorld->occlusion.getStats();
+        ImGui::Text("Occluders: %u triangles  Hidden: %u of %u tested",
+            (unsigned int)occ.triangles, occ.hidden, occ.tested);
+    }
     ImGui::End();
 }
 
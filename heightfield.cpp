@@ -0,0 +1,138 @@
+#include "heightfield.h"
+#include "raycast.h"
+#include <algorithm>
+#include <cmath>
+#include <cfloat>
+
+HeightField::HeightField()
+{
+	// chunks nobody set are not there
+	for (int i=0; i<16*16; i++) holes[i] = 0xffff;
+	for (int i=0; i<32*32; i++) lowest[i] = FLT_MAX;
+}
+
+void HeightField::set(int i, int j, const ChunkData &d)
+{
+	// MCVT rows alternate between 9 outer and 8 inner vertices
+	for (int y=0; y<9; y++) {
+		float *o = outer + (j*8 + y)*129 + i*8;
+		for (int x=0; x<9; x++) o[x] = d.vertices[y*17 + x].y;
+	}
+	for (int y=0; y<8; y++) {
+		float *n = inner + (j*8 + y)*128 + i*8;
+		for (int x=0; x<8; x++) n[x] = d.vertices[y*17 + 9 + x].y;
+	}
+	holes[j*16 + i] = (unsigned short)d.holes;
+
+	// a hole bit is 2x2 cells, a quarter of a chunk has four of them
+	for (int q=0; q<4; q++) {
+		int qx = q & 1, qz = q >> 1;
+		float h = FLT_MAX;
+		if (!(d.holes & (0x33 << (qz*8 + qx*2)))) {
+			for (int y=0; y<=8; y++) {
+				for (int x=0; x<=4; x++) {
+					// outer rows are even, inner ones odd and a vertex shorter
+					if ((y & 1) && x == 4) continue;
+					int k = (y >> 1)*17 + ((y & 1) ? 9 : 0) + x;
+					h = std::min(h, d.vertices[k + qz*4*17 + qx*4].y);
+				}
+			}
+		}
+		lowest[(j*2 + qz)*32 + i*2 + qx] = h;
+	}
+}
+
+bool HeightField::height(float u, float v, float &h) const
+{
+	// written so that NaN fails too
+	if (!(u >= 0 && v >= 0 && u < 128 && v < 128)) return false;
+
+	int ci = (int)u, cj = (int)v;
+	float fx = u - ci, fz = v - cj;
+
+	// a hole bit covers 2x2 cells of its chunk
+	if (holes[(cj >> 3)*16 + (ci >> 3)] & (1 << (((cj & 7) >> 1)*4 + ((ci & 7) >> 1)))) return false;
+
+	const float *o = outer + cj*129 + ci;
+	float h00 = o[0], h10 = o[1], h01 = o[129], h11 = o[130];
+	float hc = inner[cj*128 + ci];
+
+	// the triangle is the one facing the nearest cell edge
+	if (fz < fx) {
+		if (fx + fz < 1) h = h00 + (h10 - h00)*fx + (2*hc - h00 - h10)*fz;
+		else h = h10 + (h11 - h10)*fz + (2*hc - h10 - h11)*(1 - fx);
+	} else {
+		if (fx + fz < 1) h = h00 + (h01 - h00)*fz + (2*hc - h00 - h01)*fx;
+		else h = h01 + (h11 - h01)*fx + (2*hc - h01 - h11)*(1 - fz);
+	}
+	return true;
+}
+
+bool HeightField::raycast(int i, int j, const Vec3D &o, const Vec3D &d, float x0, float z0, float tmin, float &t) const
+{
+	// the ray in cells from the tile corner
+	float ox = (o.x - x0) * (1.0f / UNITSIZE), oz = (o.z - z0) * (1.0f / UNITSIZE);
+	float dx = d.x * (1.0f / UNITSIZE), dz = d.z * (1.0f / UNITSIZE);
+	bool hit = false;
+
+	// row by row, only the cells the ray passes over
+	for (int cj=j*8; cj<j*8+8; cj++) {
+		float ta = tmin, tb = t;
+		if (dz != 0) {
+			float t1 = (cj - oz) / dz, t2 = (cj + 1 - oz) / dz;
+			ta = std::max(ta, std::min(t1, t2));
+			tb = std::min(tb, std::max(t1, t2));
+		} else if (oz < cj || oz >= cj + 1) continue;
+		if (ta > tb) continue;
+
+		// clamped before going to int: along x alone tb is as far as the
+		// caller looks, which can be well past what an int holds
+		float xa = ox + dx*ta, xb = ox + dx*tb;
+		int c0 = (int)std::max((float)(i*8), floorf(std::min(xa, xb) - 0.001f));
+		int c1 = (int)std::min((float)(i*8 + 7), floorf(std::max(xa, xb) + 0.001f));
+
+		for (int ci=c0; ci<=c1; ci++) {
+			if (holes[(cj >> 3)*16 + (ci >> 3)] & (1 << (((cj & 7) >> 1)*4 + ((ci & 7) >> 1)))) continue;
+
+			const float *h = outer + cj*129 + ci;
+			float x = x0 + ci*UNITSIZE, z = z0 + cj*UNITSIZE;
+			Vec3D p00(x, h[0], z), p10(x + UNITSIZE, h[1], z);
+			Vec3D p01(x, h[129], z + UNITSIZE), p11(x + UNITSIZE, h[130], z + UNITSIZE);
+			Vec3D pc(x + UNITSIZE*0.5f, inner[cj*128 + ci], z + UNITSIZE*0.5f);
+
+			if (rayTriangle(o, d, p00, p10, pc, t)) hit = true;
+			if (rayTriangle(o, d, p10, p11, pc, t)) hit = true;
+			if (rayTriangle(o, d, p11, p01, pc, t)) hit = true;
+			if (rayTriangle(o, d, p01, p00, pc, t)) hit = true;
+		}
+	}
+	return hit;
+}
+
+void HeightField::occluder(float x0, float z0, const bool *show, std::vector<Vec3D> &verts, std::vector<unsigned short> &tris) const
+{
+	const float step = UNITSIZE * 4;
+	verts.resize(33*33);
+	for (int z=0; z<=32; z++) {
+		for (int x=0; x<=32; x++) {
+			// under every cell it is a corner of, so the triangles stay
+			// under the lowest point of each cell
+			float h = FLT_MAX;
+			for (int k=0; k<4; k++) {
+				int cx = x - (k & 1), cz = z - (k >> 1);
+				if (cx >= 0 && cz >= 0 && cx < 32 && cz < 32) h = std::min(h, lowest[cz*32 + cx]);
+			}
+			verts[z*33 + x] = Vec3D(x0 + x*step, h, z0 + z*step);
+		}
+	}
+
+	tris.clear();
+	for (int z=0; z<32; z++) {
+		for (int x=0; x<32; x++) {
+			if (!show[(z >> 1)*16 + (x >> 1)] || lowest[z*32 + x] == FLT_MAX) continue;
+			unsigned short a = (unsigned short)(z*33 + x), b = a + 1, c = a + 33, d = a + 34;
+			unsigned short t[6] = {a, c, b, b, c, d};
+			tris.insert(tris.end(), t, t + 6);
+		}
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef HEIGHTFIELD_H
+#define HEIGHTFIELD_H
+
+#include "tiledata.h"
+
+// The terrain heights of one tile, kept on the CPU for queries.
+//
+// The chunks share their edges, so a tile is a 129x129 grid of outer
+// vertices plus the 128x128 inner ones in the middle of each cell, each
+// in a flat array of its own. Every cell is drawn as four triangles
+// fanned around its inner vertex, and height() interpolates on the same
+// triangles so that it agrees with what is on screen.
+class HeightField {
+	float outer[129*129];
+	float inner[128*128];
+	unsigned short holes[16*16];
+	// lowest point of every 4x4 cells, FLT_MAX where there are holes
+	float lowest[32*32];
+
+public:
+	HeightField();
+
+	// copies chunk (i,j) of the tile
+	void set(int i, int j, const ChunkData &d);
+
+	// u and v in units (UNITSIZE) from the tile corner along x and z;
+	// false outside the tile and over holes
+	bool height(float u, float v, float &h) const;
+
+	// First hit of o + d*t with the triangles of chunk (i,j); t comes in as
+	// the farthest hit wanted. tmin is where the ray enters the chunk's
+	// bounds, the cells it has passed over before that are not looked at.
+	// x0 and z0 are the tile corner in world coordinates
+	bool raycast(int i, int j, const Vec3D &o, const Vec3D &d, float x0, float z0, float tmin, float &t) const;
+
+	// Triangles that never rise above the ground, to occlude with: a grid
+	// of 4x4 cells whose corners are at the lowest height of the cells
+	// around them. Cells with holes are left out, and so are the chunks
+	// whose show[j*16+i] is false. Facing up
+	void occluder(float x0, float z0, const bool *show, std::vector<Vec3D> &verts, std::vector<unsigned short> &tris) const;
+};
+
+#endif
@@ -132,30 +132,42 @@ char pkware_copyright[] = "PKWARE Data Compression Library for Win32\r\n"
 			  "PKWARE Data Compression Library Reg. U.S. Pat. and Tm. Off.\r\n"
 			  "Version 1.11\r\n";
 
-/* skips given number of bits. */
-static int32_t skip_bit(pkzip_cmp_s *mpq_pkzip, uint32_t bits) {
+/* load whole bytes into the bit buffer while there is room for them. */
+static void fill_bits(pkzip_cmp_s *mpq_pkzip) {
 
-	/* check if number of bits required is less than number of bits in the buffer. */
-	if (bits <= mpq_pkzip->extra_bits) {
-		mpq_pkzip->extra_bits  -= bits;
-		mpq_pkzip->bit_buf    >>= bits;
-		return 0;
+	/* some common variables. */
+	uint64_t next;
+
+	/* most of the time there is a whole word left, load it in one go. */
+	if ((size_t)(mpq_pkzip->in_end - mpq_pkzip->in_pos) >= sizeof(next)) {
+		memcpy(&next, mpq_pkzip->in_pos, sizeof(next));
+		mpq_pkzip->bit_buf |= next << mpq_pkzip->bits;
+		mpq_pkzip->in_pos  += (63 - mpq_pkzip->bits) >> 3;
+		mpq_pkzip->bits    |= 56;
+		return;
+	}
+
+	/* load the tail byte by byte. */
+	while (mpq_pkzip->bits <= 56 && mpq_pkzip->in_pos < mpq_pkzip->in_end) {
+		mpq_pkzip->bit_buf |= (uint64_t)*mpq_pkzip->in_pos++ << mpq_pkzip->bits;
+		mpq_pkzip->bits    += 8;
 	}
+}
+
+/* skips given number of bits, fails if that would leave less than a byte to look at. */
+static int32_t skip_bit(pkzip_cmp_s *mpq_pkzip, uint32_t bits) {
 
 	/* load input buffer if necessary. */
-	mpq_pkzip->bit_buf >>= mpq_pkzip->extra_bits;
-	if (mpq_pkzip->in_pos == mpq_pkzip->in_bytes) {
-		mpq_pkzip->in_pos = sizeof(mpq_pkzip->in_buf);
-		if ((mpq_pkzip->in_bytes = mpq_pkzip->read_buf((char *)mpq_pkzip->in_buf, &mpq_pkzip->in_pos, mpq_pkzip->param)) == 0) {
+	if (mpq_pkzip->bits < bits + 8) {
+		fill_bits(mpq_pkzip);
+		if (mpq_pkzip->bits < bits + 8) {
 			return 1;
 		}
-		mpq_pkzip->in_pos = 0;
 	}
 
 	/* update bit buffer. */
-	mpq_pkzip->bit_buf     |= (mpq_pkzip->in_buf[mpq_pkzip->in_pos++] << 8);
-	mpq_pkzip->bit_buf    >>= (bits - mpq_pkzip->extra_bits);
-	mpq_pkzip->extra_bits   = (mpq_pkzip->extra_bits - bits) + 8;
+	mpq_pkzip->bit_buf >>= bits;
+	mpq_pkzip->bits     -= bits;
 
 	/* if no error was found, return zero. */
 	return 0;
@@ -399,86 +411,64 @@ static uint32_t decode_distance(pkzip_cmp_s *mpq_pkzip, uint32_t length) {
 }
 
 /*
- *  function loads data from the input buffer used by mpq_pkzip
- *  "implode" and "explode" function as user defined callback and
- *  returns number of bytes loaded.
- *
- *  char		*buf	- pointer to a buffer where to store loaded data.
- *  uint32_t		*size	- maximum number of bytes to read.
- *  void		*param	- custom pointer, parameter of implode/explode.
+ *  copy a previous block of copy_length bytes starting move_back bytes
+ *  behind the output position. matches which are at least a word away
+ *  are copied a word at a time, the last word may run past the block
+ *  but never past the output buffer.
  */
-static uint32_t data_read_input(char *buf, uint32_t *size, void *param) {
+static void copy_block(pkzip_cmp_s *mpq_pkzip, uint32_t copy_length, uint32_t move_back) {
 
 	/* some common variables. */
-	pkzip_data_s *info   = (pkzip_data_s *)param;
-	uint32_t max_avail = (info->in_bytes - info->in_pos);
-	uint32_t to_read   = *size;
-
-	/* check the case when not enough data available. */
-	if (to_read > max_avail) {
-		to_read = max_avail;
+	uint8_t *target = mpq_pkzip->out_pos;
+	uint8_t *source = target - move_back;
+	uint8_t *end    = target + copy_length;
+	uint64_t word;
+
+	/* fast path, source and target don't overlap within a word. */
+	if (move_back >= sizeof(word) &&
+	    move_back <= (uint32_t)(target - mpq_pkzip->out_buf) &&
+	    (size_t)(mpq_pkzip->out_end - target) >= copy_length + sizeof(word)) {
+		do {
+			memcpy(&word, source, sizeof(word));
+			memcpy(target, &word, sizeof(word));
+			source += sizeof(word);
+			target += sizeof(word);
+		} while (target < end);
+
+		mpq_pkzip->out_pos = end;
+		return;
 	}
 
-	/* load data and increment offsets. */
-	memcpy(buf, info->in_buf + info->in_pos, to_read);
-	info->in_pos += to_read;
-
-	/* return bytes read. */
-	return to_read;
-}
-
-/*
- *  function for store output data used by mpq_pkzip "implode" and
- *  "explode" as userdefined callback.
- *
- *  char		*buf	- pointer to data to be written.
- *  uint32_t		*size	- number of bytes to write.
- *  void		*param	- custom pointer, parameter of implode/explode.
- */
-static void data_write_output(char *buf, uint32_t *size, void *param) {
-
-	/* some common variables. */
-	pkzip_data_s *info   = (pkzip_data_s *)param;
-	uint32_t max_write = (info->max_out - info->out_pos);
-	uint32_t to_write  = *size;
+	/* limit to the space left in the output buffer. */
+	if (end > mpq_pkzip->out_end) {
+		end = mpq_pkzip->out_end;
+	}
 
-	/* check the case when not enough space in the output buffer. */
-	if (to_write > max_write) {
-		to_write = max_write;
+	/* copy until nothing left, data in front of the output start reads as zero. */
+	for (; target < end; target++, source++) {
+		*target = (source < mpq_pkzip->out_buf) ? 0 : *source;
 	}
 
-	/* write output data and increments offsets. */
-	memcpy(info->out_buf + info->out_pos, buf, to_write);
-	info->out_pos += to_write;
+	mpq_pkzip->out_pos = end;
 }
 
 /* this function extract the data from input stream. */
 static uint32_t expand(pkzip_cmp_s *mpq_pkzip) {
 
-	/* number of bytes to copy. */
-	uint32_t copy_bytes;
-
 	/* one byte from compressed file. */
 	uint32_t one_byte;
 
 	/* some common variables. */
-	uint32_t result;
+	uint32_t result = 0;
 
-	/* initialize output buffer position. */
-	mpq_pkzip->out_pos = 0x1000;
-
-	/* check if end of data or error, so terminate decompress. */
+	/* check if end of data or error, so terminate decompress. a full output
+	 * buffer keeps decoding to the end marker, so that a broken stream is
+	 * still reported as one. */
 	while ((result = one_byte = decode_literal(mpq_pkzip)) < 0x305) {
 
 		/* check if one byte is greater than 0x100, which means 'repeat n - 0xFE bytes'. */
 		if (one_byte >= 0x100) {
 
-			/* ECX */
-			uint8_t *source;
-
-			/* EDX */
-			uint8_t *target;
-
 			/* some common variables. */
 			uint32_t copy_length = one_byte - 0xFE;
 			uint32_t move_back;
@@ -489,39 +479,18 @@ static uint32_t expand(pkzip_cmp_s *mpq_pkzip) {
 				break;
 			}
 
-			/* target and source pointer. */
-			target              = &mpq_pkzip->out_buf[mpq_pkzip->out_pos];
-			source              = target - move_back;
-			mpq_pkzip->out_pos += copy_length;
-
-			/* copy until nothing left. */
-			while (copy_length-- > 0) {
-				*target++ = *source++;
-			}
+			/* copy previous block. */
+			copy_block(mpq_pkzip, copy_length, move_back);
 		} else {
 
-			/* byte is 0x100 great, so add one byte. */
-			mpq_pkzip->out_buf[mpq_pkzip->out_pos++] = (uint8_t)one_byte;
-		}
-
-		/* check if number of extracted bytes has reached 1/2 of output buffer, so flush output buffer. */
-		if (mpq_pkzip->out_pos >= 0x2000) {
-
-			/* copy decompressed data into user buffer. */
-			copy_bytes = 0x1000;
-			mpq_pkzip->write_buf((char *)&mpq_pkzip->out_buf[0x1000], &copy_bytes, mpq_pkzip->param);
-
-			/* check if there are some data left, keep them alive. */
-			memcpy(mpq_pkzip->out_buf, &mpq_pkzip->out_buf[0x1000], mpq_pkzip->out_pos - 0x1000);
-			mpq_pkzip->out_pos -= 0x1000;
+			/* byte is 0x100 great, so add one byte if there is room. */
+			if (mpq_pkzip->out_pos < mpq_pkzip->out_end) {
+				*mpq_pkzip->out_pos++ = (uint8_t)one_byte;
+			}
 		}
 	}
 
-	/* copy the rest. */
-	copy_bytes = mpq_pkzip->out_pos - 0x1000;
-	mpq_pkzip->write_buf((char *)&mpq_pkzip->out_buf[0x1000], &copy_bytes, mpq_pkzip->param);
-
-	/* return copied bytes. */
+	/* return last decoded value. */
 	return result;
 }
 
@@ -530,36 +499,33 @@ uint32_t libmpq__do_decompress_pkzip(uint8_t *work_buf, void *param) {
 
 	/* some common variables. */
 	pkzip_cmp_s *mpq_pkzip = (pkzip_cmp_s *)work_buf;
+	pkzip_data_s *info     = (pkzip_data_s *)param;
+	uint32_t result;
 
 	/* set the whole work buffer to zeros. */
 	memset(mpq_pkzip, 0, sizeof(pkzip_cmp_s));
 
-	/* initialize work struct and load compressed data. */
-	mpq_pkzip->read_buf   = data_read_input;
-	mpq_pkzip->write_buf  = data_write_output;
-	mpq_pkzip->param      = param;
-	mpq_pkzip->in_pos     = sizeof(mpq_pkzip->in_buf);
-	mpq_pkzip->in_bytes   = mpq_pkzip->read_buf((char *)mpq_pkzip->in_buf, &mpq_pkzip->in_pos, mpq_pkzip->param);
+	/* initialize work struct, data is decoded straight into the caller's buffer. */
+	mpq_pkzip->in_pos     = info->in_buf + info->in_pos;
+	mpq_pkzip->in_end     = info->in_buf + info->in_bytes;
+	mpq_pkzip->out_buf    = info->out_buf + info->out_pos;
+	mpq_pkzip->out_pos    = mpq_pkzip->out_buf;
+	mpq_pkzip->out_end    = info->out_buf + info->max_out;
 
 	/* check if we have pkzip data. */
-	if (mpq_pkzip->in_bytes <= 4) {
+	if (mpq_pkzip->in_end - mpq_pkzip->in_pos <= 4) {
 		return LIBMPQ_PKZIP_CMP_BAD_DATA;
 	}
 
 	/* get the compression type. */
-	mpq_pkzip->cmp_type   = mpq_pkzip->in_buf[0];
+	mpq_pkzip->cmp_type   = mpq_pkzip->in_pos[0];
 
 	/* get the dictionary size. */
-	mpq_pkzip->dsize_bits = mpq_pkzip->in_buf[1];
+	mpq_pkzip->dsize_bits = mpq_pkzip->in_pos[1];
 
-	/* initialize 16-bit bit buffer. */
-	mpq_pkzip->bit_buf    = mpq_pkzip->in_buf[2];
-
-	/* extra (over 8) bits. */
-	mpq_pkzip->extra_bits = 0;
-
-	/* position in input buffer. */
-	mpq_pkzip->in_pos     = 3;
+	/* initialize bit buffer, it always holds at least the current byte. */
+	mpq_pkzip->in_pos    += 2;
+	fill_bits(mpq_pkzip);
 
 	/* check if valid dictionary size. */
 	if (4 > mpq_pkzip->dsize_bits || mpq_pkzip->dsize_bits > 6) {
@@ -592,8 +558,14 @@ uint32_t libmpq__do_decompress_pkzip(uint8_t *work_buf, void *param) {
 	memcpy(mpq_pkzip->dist_bits, pkzip_dist_bits, sizeof(mpq_pkzip->dist_bits));
 	generate_tables_decode(0x40, mpq_pkzip->dist_bits, pkzip_dist_code, mpq_pkzip->pos1);
 
+	/* extract the data. */
+	result = expand(mpq_pkzip);
+
+	/* save position in output buffer. */
+	info->out_pos = (uint32_t)(mpq_pkzip->out_pos - info->out_buf);
+
 	/* check if data extraction works. */
-	if (expand(mpq_pkzip) != 0x306) {
+	if (result != 0x306) {
 		return LIBMPQ_PKZIP_CMP_NO_ERROR;
 	}
 
@@ -41,30 +41,26 @@
 typedef struct {
 	uint32_t	offs0000;		/* 0000 - start. */
 	uint32_t	cmp_type;		/* 0004 - compression type (binary or ascii). */
-	uint32_t	out_pos;		/* 0008 - position in output buffer. */
-	uint32_t	dsize_bits;		/* 000C - dict size (4, 5, 6 for 0x400, 0x800, 0x1000). */
-	uint32_t	dsize_mask;		/* 0010 - dict size bitmask (0x0F, 0x1F, 0x3F for 0x400, 0x800, 0x1000). */
-	uint32_t	bit_buf;		/* 0014 - 16-bit buffer for processing input data. */
-	uint32_t	extra_bits;		/* 0018 - number of extra (above 8) bits in bit buffer. */
-	uint32_t	in_pos;			/* 001C - position in in_buf. */
-	uint32_t	in_bytes;		/* 0020 - number of bytes in input buffer. */
-	void		*param;			/* 0024 - custom parameter. */
-	uint32_t	(*read_buf)(char *buf, uint32_t *size, void *param);	/* 0028 offset.*/
-	void		(*write_buf)(char *buf, uint32_t *size, void *param);	/* 002C offset. */
-	uint8_t		out_buf[0x2000];	/* 0030 - output circle buffer, starting position is 0x1000. */
-	uint8_t		offs_2030[0x204];	/* 2030 - whats that? */
-	uint8_t		in_buf[0x800];		/* 2234 - buffer for data to be decompressed. */
-	uint8_t		pos1[0x100];		/* 2A34 - positions in buffers. */
-	uint8_t		pos2[0x100];		/* 2B34 - positions in buffers. */
-	uint8_t		offs_2c34[0x100];	/* 2C34 - buffer. */
-	uint8_t		offs_2d34[0x100];	/* 2D34 - buffer. */
-	uint8_t		offs_2e34[0x80];	/* 2EB4 - buffer. */
-	uint8_t		offs_2eb4[0x100];	/* 2EB4 - buffer. */
-	uint8_t		bits_asc[0x100];	/* 2FB4 - buffer. */
-	uint8_t		dist_bits[0x40];	/* 30B4 - numbers of bytes to skip copied block length. */
-	uint8_t		slen_bits[0x10];	/* 30F4 - numbers of bits for skip copied block length. */
-	uint8_t		clen_bits[0x10];	/* 3104 - number of valid bits for copied block. */
-	uint16_t	len_base[0x10];		/* 3114 - buffer. */
+	uint32_t	dsize_bits;		/* 0008 - dict size (4, 5, 6 for 0x400, 0x800, 0x1000). */
+	uint32_t	dsize_mask;		/* 000C - dict size bitmask (0x0F, 0x1F, 0x3F for 0x400, 0x800, 0x1000). */
+	uint64_t	bit_buf;		/* 0010 - 64-bit buffer for processing input data, next bit is the lowest one. */
+	uint32_t	bits;			/* 0018 - number of valid bits in bit buffer. */
+	uint8_t		*in_pos;		/* 001C - next byte to load into bit buffer. */
+	uint8_t		*in_end;		/* 0020 - end of input data. */
+	uint8_t		*out_buf;		/* 0024 - start of the caller's output buffer. */
+	uint8_t		*out_pos;		/* 0028 - position in output buffer. */
+	uint8_t		*out_end;		/* 002C - end of output buffer. */
+	uint8_t		pos1[0x100];		/* 0030 - positions in buffers. */
+	uint8_t		pos2[0x100];		/* 0130 - positions in buffers. */
+	uint8_t		offs_2c34[0x100];	/* 0230 - buffer. */
+	uint8_t		offs_2d34[0x100];	/* 0330 - buffer. */
+	uint8_t		offs_2e34[0x80];	/* 0430 - buffer. */
+	uint8_t		offs_2eb4[0x100];	/* 04B0 - buffer. */
+	uint8_t		bits_asc[0x100];	/* 05B0 - buffer. */
+	uint8_t		dist_bits[0x40];	/* 06B0 - numbers of bytes to skip copied block length. */
+	uint8_t		slen_bits[0x10];	/* 06F0 - numbers of bits for skip copied block length. */
+	uint8_t		clen_bits[0x10];	/* 0700 - number of valid bits for copied block. */
+	uint16_t	len_base[0x10];		/* 0710 - buffer. */
 } PACK_STRUCT pkzip_cmp_s;
 #include "pack_end.h"
 
@@ -67,11 +67,9 @@ int32_t libmpq__decompress_huffman(uint8_t *in_buf, uint32_t in_size, uint8_t *o
 	memset(ht, 0, sizeof(struct huffman_tree_s));
 	memset(is, 0, sizeof(struct huffman_input_stream_s));
 
-	/* initialize input stream. */
-	is->bit_buf  = *(uint32_t *)in_buf;
-	in_buf      += sizeof(int32_t);
-	is->in_buf   = (uint8_t *)in_buf;
-	is->bits     = 32;
+	/* initialize input stream, bits are loaded on demand. */
+	is->in_buf   = in_buf;
+	is->in_end   = in_buf + in_size;
 
 // TODO: add all the mallocs to init function and add function libmpq__huffman_tree_free() */
 //	if ((result = libmpq__huffman_tree_init(ht, LIBMPQ_HUFF_DECOMPRESS)) < 0) {
@@ -122,7 +120,8 @@ int32_t libmpq__decompress_zlib(uint8_t *in_buf, uint32_t in_size, uint8_t *out_
 	/* call zlib to decompress the data. */
 	if ((result = inflate(&z, Z_FINISH)) != Z_STREAM_END) {
 
-		/* something on zlib decompression failed. */
+		/* something on zlib decompression failed, free the state anyway. */
+		inflateEnd(&z);
 		return result;
 	}
 
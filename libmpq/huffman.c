@@ -373,57 +373,50 @@ struct huffman_tree_item_s *libmpq__huffman_previous_item(struct huffman_tree_it
 	return hi->prev + value;
 }
 
-/* get one bit from input stream. */
-uint32_t libmpq__huffman_get_1bit(struct huffman_input_stream_s *is) {
+/* top up the bit buffer to at least 57 bits, past the end of input the stream reads as zero bits. */
+static void libmpq__huffman_fill(struct huffman_input_stream_s *is) {
 
 	/* some common variables. */
-	uint32_t bit = (is->bit_buf & 1);
-
-	/* shift bit right by one. */
-	is->bit_buf >>= 1;
-
-	/* check if we should extract bits. */
-	if (--is->bits == 0) {
-		is->bit_buf  = *(uint32_t *)is->in_buf;
-		is->in_buf  += sizeof(int32_t);
-		is->bits     = 32;
+	uint64_t next;
+
+	/* most of the time there is a whole word left, load it in one go. */
+	if ((size_t)(is->in_end - is->in_buf) >= sizeof(next)) {
+		memcpy(&next, is->in_buf, sizeof(next));
+		is->bit_buf |= next << is->bits;
+		is->in_buf  += (63 - is->bits) >> 3;
+		is->bits    |= 56;
+		return;
 	}
 
-	/* return the bit. */
-	return bit;
-}
-
-/* get 7 bits from the input stream. */
-uint32_t libmpq__huffman_get_7bit(struct huffman_input_stream_s *is) {
-
-	/* check if we should extract bits. */
-	if (is->bits <= 7) {
-		is->bit_buf |= *(uint16_t *)is->in_buf << is->bits;
-		is->in_buf  += sizeof(int16_t);
-		is->bits    += 16;
+	/* load the tail byte by byte, then pad with zeros. */
+	while (is->bits <= 56) {
+		if (is->in_buf < is->in_end) {
+			is->bit_buf |= (uint64_t)*is->in_buf++ << is->bits;
+		}
+		is->bits += 8;
 	}
+}
 
-	/* get 7 bits from input stream. */
-	return (is->bit_buf & 0x7F);
+/* drop bits from the bit buffer, the caller made sure that many are loaded. */
+static void libmpq__huffman_skip(struct huffman_input_stream_s *is, uint32_t bits) {
+	is->bit_buf >>= bits;
+	is->bits     -= bits;
 }
 
 /* get the whole byte from the input stream. */
-uint32_t libmpq__huffman_get_8bit(struct huffman_input_stream_s *is) {
+static uint32_t libmpq__huffman_get_8bit(struct huffman_input_stream_s *is) {
 
 	/* some common variables. */
 	uint32_t one_byte;
 
 	/* check if we should extract bits. */
-	if (is->bits <= 8) {
-		is->bit_buf |= *(uint16_t *)is->in_buf << is->bits;
-		is->in_buf  += sizeof(int16_t);
-		is->bits    += 16;
+	if (is->bits < 8) {
+		libmpq__huffman_fill(is);
 	}
 
 	/* fill values. */
-	one_byte      = (is->bit_buf & 0xFF);
-	is->bit_buf >>= 8;
-	is->bits     -= 8;
+	one_byte = (uint32_t)(is->bit_buf & 0xFF);
+	libmpq__huffman_skip(is, 8);
 
 	/* return the 8 bits. */
 	return one_byte;
@@ -945,11 +938,8 @@ int32_t libmpq__do_decompress_huffman(struct huffman_tree_s *ht, struct huffman_
 	/* 8 bits loaded from input stream. */
 	uint32_t n8bits;
 
-	/* 7 bits loaded from input stream. */
-	uint32_t n7bits;
-
-	/* thats needed to replace the goto stuff from original source. :) */
-	uint32_t found;
+	/* next LIBMPQ_HUFF_QD_BITS bits of the input stream. */
+	uint32_t index;
 
 	/* can we use quick decompression */
 	uint32_t has_qd;
@@ -971,73 +961,81 @@ int32_t libmpq__do_decompress_huffman(struct huffman_tree_s *ht, struct huffman_
 	/* loop until break. */
 	for(;;) {
 
-		/* get 7 bits from input stream. */
-		n7bits = libmpq__huffman_get_7bit(is);
-
-		/* try to use quick decompression, check huffman decompress struct for corresponding item. */
-		qd = &ht->qd3474[n7bits];
-
-		/* if there is a quick-pass possible (ebx). */
+		/* peek the next bits, this is enough for any code the quick decompression table resolves. */
+		if (is->bits < LIBMPQ_HUFF_QD_BITS) {
+			libmpq__huffman_fill(is);
+		}
+		index = (uint32_t)is->bit_buf & (LIBMPQ_HUFF_QD_SIZE - 1);
+
+		/*
+		 * try to use quick decompression, entries are stamped with the
+		 * tree generation they were built for, so any change to the tree
+		 * invalidates the whole table by bumping offs0004.
+		 */
+		qd     = &ht->qd3474[index];
 		has_qd = (qd->offs00 >= ht->offs0004) ? TRUE : FALSE;
 
-		/* if we can use quick decompress, use it. */
-		if (has_qd) {
-			found = 0;
-			if (qd->bits > 7) {
-				is->bit_buf >>= 7;
-				is->bits     -= 7;
-				p_item1       = qd->p_item;
-				found         = 1;
-			}
-			if (found == 0) {
-				is->bit_buf >>= qd->bits;
-				is->bits     -= qd->bits;
-				dcmp_byte     = qd->dcmp_byte;
-			}
+		/* if the code is short enough, the table entry already holds the byte. */
+		if (has_qd && qd->bits <= LIBMPQ_HUFF_QD_BITS) {
+			libmpq__huffman_skip(is, qd->bits);
+			dcmp_byte = qd->dcmp_byte;
 		} else {
-			found = 1;
-			p_item1 = ht->first->next->prev;
-			if (PTR_INT(p_item1) <= 0) {
-				p_item1 = NULL;
+
+			/* longer code, continue the walk where the table left off. */
+			if (has_qd) {
+				libmpq__huffman_skip(is, LIBMPQ_HUFF_QD_BITS);
+				p_item1 = qd->p_item;
+			} else {
+				p_item1 = ht->first->next->prev;
+				if (PTR_INT(p_item1) <= 0) {
+					p_item1 = NULL;
+				}
 			}
-		}
 
-		/* check if item was found. */
-		if (found == 1) {
 			bit_count = 0;
 			p_item2   = NULL;
 
-			/* loop until tree has no deeper level. */
+			/* loop until tree has no deeper level, bits are taken straight from the bit buffer. */
 			do {
 
+				/* refill only when the buffer ran dry, codes rarely get this long. */
+				if (is->bits == 0) {
+					libmpq__huffman_fill(is);
+				}
+
 				/* move down by one level. */
 				p_item1 = p_item1->child;
 
 				/* check if current bit is set, move to previous. */
-				if (libmpq__huffman_get_1bit(is)) {
+				if (is->bit_buf & 1) {
 					p_item1 = p_item1->prev;
 				}
+				libmpq__huffman_skip(is, 1);
 
-				/* check if we are at 7th bit, save current huffman tree item. */
-				if (++bit_count == 7) {
+				/* check if we are at the table depth, save current huffman tree item. */
+				if (++bit_count == LIBMPQ_HUFF_QD_BITS) {
 					p_item2 = p_item1;
 				}
 			} while (p_item1->child != NULL);
 
-			/* no quick decompression. :( */
-			if (has_qd == FALSE) {
+			/*
+			 * no quick decompression, remember the walk for the next time
+			 * these bits show up. the adaptive tree changes after nearly
+			 * every byte, so filling the table there is wasted work.
+			 */
+			if (has_qd == FALSE && ht->cmp0 == FALSE) {
 
 				/* check bit counter. */
-				if (bit_count > 7) {
+				if (bit_count > LIBMPQ_HUFF_QD_BITS) {
 					qd->offs00 = ht->offs0004;
 					qd->bits   = bit_count;
 					qd->p_item = p_item2;
 				} else {
-					uint32_t index = n7bits & (0xFFFFFFFF >> (32 - bit_count));
-					uint32_t add   = (1 << bit_count);
+					uint32_t add = (1 << bit_count);
 
-					/* loop through compression. */
-					for (qd = &ht->qd3474[index]; index <= 0x7F; index += add, qd += add) {
+					/* every index that starts with this code resolves to the same byte. */
+					index &= (add - 1);
+					for (qd = &ht->qd3474[index]; index < LIBMPQ_HUFF_QD_SIZE; index += add, qd += add) {
 						qd->offs00    = ht->offs0004;
 						qd->bits      = bit_count;
 						qd->dcmp_byte = p_item1->dcmp_byte;
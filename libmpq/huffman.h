@@ -30,6 +30,10 @@
 /* define huffman compression and decompression values. */
 #define LIBMPQ_HUFF_DECOMPRESS			0		/* we want to decompress using huffman trees. */
 
+/* define quick decompression lookup size, codes up to this length are resolved by a single table lookup. */
+#define LIBMPQ_HUFF_QD_BITS			9
+#define LIBMPQ_HUFF_QD_SIZE			(1 << LIBMPQ_HUFF_QD_BITS)
+
 /* define pointer conversions. */
 #define PTR_NOT(ptr)				(struct huffman_tree_item_s *)(~(unsigned long)(ptr))
 #define PTR_PTR(ptr)				((struct huffman_tree_item_s *)(ptr))
@@ -42,8 +46,9 @@
 /* input stream for huffman decompression. */
 struct huffman_input_stream_s {
 	uint8_t		*in_buf;				/* 00 - input data. */
-	uint32_t	bit_buf;				/* 04 - input bit buffer. */
-	uint32_t	bits;					/* 08 - number of bits remaining in byte. */
+	uint8_t		*in_end;				/* 04 - end of input data. */
+	uint64_t	bit_buf;				/* 08 - input bit buffer, next bit is the lowest one. */
+	uint32_t	bits;					/* 10 - number of bits loaded into bit buffer. */
 };
 
 /* huffman tree item. */
@@ -61,8 +66,8 @@ struct huffman_decompress_s {
 	uint32_t	offs00;					/* 00 - 1 if resolved. */
 	uint32_t	bits;					/* 04 - bit count. */
 	union {
-		uint32_t	dcmp_byte;			/* 08 - byte value for decompress (if bitCount <= 7). */
-		struct		huffman_tree_item_s *p_item;	/* 08 - huffman tree item (if number of bits is greater than 7). */
+		uint32_t	dcmp_byte;			/* 08 - byte value for decompress (if bit count <= LIBMPQ_HUFF_QD_BITS). */
+		struct		huffman_tree_item_s *p_item;	/* 08 - huffman tree item (if bit count is greater than LIBMPQ_HUFF_QD_BITS). */
 	};
 };
 
@@ -79,7 +84,7 @@ struct huffman_tree_s {
 	struct		huffman_tree_item_s *last;		/* 3064 - pointer to bottom (last) huffman tree item (< 0 if invalid). */
 	uint32_t	items;					/* 3068 - number of used huffman tree items. */
 	struct		huffman_tree_item_s *items306C[0x102];	/* 306C - huffman tree item pointer array. */
-	struct		huffman_decompress_s qd3474[0x80];	/* 3474 - array for quick decompression. */
+	struct		huffman_decompress_s qd3474[LIBMPQ_HUFF_QD_SIZE];	/* 3474 - array for quick decompression, indexed by the next input bits. */
 	uint8_t		table_1502A630[];			/* some table to make struct size flexible. */
 };
 
@@ -102,21 +107,6 @@ struct huffman_tree_item_s *libmpq__huffman_previous_item(
 	long		value
 );
 
-/* get one bit from stream. */
-uint32_t libmpq__huffman_get_1bit(
-	struct		huffman_input_stream_s *is
-);
-
-/* get seven bit from stream. */
-uint32_t libmpq__huffman_get_7bit(
-	struct		huffman_input_stream_s *is
-);
-
-/* get eight bit from stream. */
-uint32_t libmpq__huffman_get_8bit(
-	struct		huffman_input_stream_s *is
-);
-
 /* call 1500E740. */
 struct huffman_tree_item_s *libmpq__huffman_call_1500E740(
 	struct		huffman_tree_s *ht
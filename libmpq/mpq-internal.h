@@ -26,6 +26,9 @@
 #include <stdint.h>
 #include <stdio.h>
 
+/* platform specific includes. */
+#include "platform.h"
+
 /* define return value if nothing failed. */
 #define LIBMPQ_SUCCESS				0		/* return value for all functions which success. */
 
@@ -123,7 +126,11 @@ typedef struct {
 struct mpq_archive {
 
 	/* generic file information. */
-	FILE		*fp;			/* file handle. */
+	FILE		*fp;			/* file handle, only used sequentially while opening, file data is read positionally. */
+	libmpq__mutex_t	lock;			/* guards mpq_file and flag updates done while opening blocks. */
+	uint8_t		*map_base;		/* whole archive file mapped read-only, or NULL. */
+	libmpq__off_t	map_size;		/* size of the mapping. */
+	void		*map_handle;		/* file mapping object on windows. */
 
 	/* generic size information. */
 	uint32_t	block_size;		/* size of the mpq block. */
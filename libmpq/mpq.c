@@ -72,6 +72,58 @@ const char *libmpq__strerror(int32_t return_code) {
 	return __libmpq_error_strings[-return_code];
 }
 
+/* this function read size bytes at the given absolute file position. it never touches the shared
+ * file position, so any number of threads may read from the same archive at once. */
+static int32_t libmpq__read_at(mpq_archive_s *mpq_archive, void *buf, libmpq__off_t size, libmpq__off_t offset) {
+
+	/* copy from the mapping if the archive is mapped. */
+	if (mpq_archive->map_base != NULL) {
+
+		/* check if the requested range is inside the file. */
+		if (offset < 0 || offset + size > mpq_archive->map_size) {
+			return LIBMPQ_ERROR_READ;
+		}
+
+		memcpy(buf, mpq_archive->map_base + offset, size);
+
+		/* if no error was found, return zero. */
+		return LIBMPQ_SUCCESS;
+	}
+
+#ifdef _WIN32
+
+	/* some common variables. */
+	HANDLE handle = (HANDLE)_get_osfhandle(_fileno(mpq_archive->fp));
+	OVERLAPPED overlapped;
+	DWORD transferred = 0;
+
+	/* the offset in an overlapped structure is honoured by synchronous handles too. */
+	memset(&overlapped, 0, sizeof(overlapped));
+	overlapped.Offset     = (DWORD)(offset & 0xFFFFFFFF);
+	overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+	if (!ReadFile(handle, buf, (DWORD)size, &transferred, &overlapped) || transferred != size) {
+		return LIBMPQ_ERROR_READ;
+	}
+#else
+
+	/* some common variables. */
+	ssize_t transferred;
+	libmpq__off_t done = 0;
+
+	/* pread may return short counts, so loop until everything is there. */
+	while (done < size) {
+		if ((transferred = pread(fileno(mpq_archive->fp), (uint8_t *)buf + done, size - done, offset + done)) <= 0) {
+			return LIBMPQ_ERROR_READ;
+		}
+		done += transferred;
+	}
+#endif
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
 /* this function read a file and verify if it is a valid mpq archive, then it read and decrypt the hash table. */
 int32_t libmpq__archive_open(mpq_archive_s **mpq_archive, const char *mpq_filename, libmpq__off_t archive_offset) {
 
@@ -92,6 +144,9 @@ int32_t libmpq__archive_open(mpq_archive_s **mpq_archive, const char *mpq_filena
 		return LIBMPQ_ERROR_MALLOC;
 	}
 
+	/* create the lock for concurrent block access. */
+	libmpq__mutex_init(&(*mpq_archive)->lock);
+
 	/* check if file exists and is readable */
 	if (((*mpq_archive)->fp = fopen(mpq_filename, "rb")) == NULL) {
 
@@ -296,6 +351,7 @@ error:
 	free((*mpq_archive)->mpq_hash);
 	free((*mpq_archive)->mpq_block);
 	free((*mpq_archive)->mpq_block_ex);
+	libmpq__mutex_destroy(&(*mpq_archive)->lock);
 	free(*mpq_archive);
 
 	*mpq_archive = NULL;
@@ -303,9 +359,96 @@ error:
 	return result;
 }
 
+/* this function maps the whole archive file into memory, blocks are then read from the mapping. */
+int32_t libmpq__archive_map(mpq_archive_s *mpq_archive) {
+
+#ifdef _WIN32
+
+	/* some common variables. */
+	HANDLE file = (HANDLE)_get_osfhandle(_fileno(mpq_archive->fp));
+	LARGE_INTEGER file_size;
+	HANDLE mapping;
+	void *view;
+
+	/* already mapped, nothing to do. */
+	if (mpq_archive->map_base != NULL) {
+		return LIBMPQ_SUCCESS;
+	}
+
+	/* the whole file has to fit into the address space. */
+	if (!GetFileSizeEx(file, &file_size) || (uint64_t)file_size.QuadPart > (uint64_t)SIZE_MAX) {
+		return LIBMPQ_ERROR_SIZE;
+	}
+
+	if ((mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL) {
+		return LIBMPQ_ERROR_OPEN;
+	}
+
+	if ((view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) == NULL) {
+		CloseHandle(mapping);
+		return LIBMPQ_ERROR_MALLOC;
+	}
+
+	mpq_archive->map_handle = mapping;
+	mpq_archive->map_base   = (uint8_t *)view;
+	mpq_archive->map_size   = file_size.QuadPart;
+#else
+
+	/* some common variables. */
+	struct stat st;
+	void *view;
+
+	/* already mapped, nothing to do. */
+	if (mpq_archive->map_base != NULL) {
+		return LIBMPQ_SUCCESS;
+	}
+
+	/* the whole file has to fit into the address space. */
+	if (fstat(fileno(mpq_archive->fp), &st) < 0 || (uint64_t)st.st_size > (uint64_t)SIZE_MAX || st.st_size == 0) {
+		return LIBMPQ_ERROR_SIZE;
+	}
+
+	if ((view = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(mpq_archive->fp), 0)) == MAP_FAILED) {
+		return LIBMPQ_ERROR_MALLOC;
+	}
+
+	mpq_archive->map_base = (uint8_t *)view;
+	mpq_archive->map_size = st.st_size;
+#endif
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
+/* this function releases the mapping, reads go through the file again. */
+int32_t libmpq__archive_unmap(mpq_archive_s *mpq_archive) {
+
+	/* nothing mapped. */
+	if (mpq_archive->map_base == NULL) {
+		return LIBMPQ_SUCCESS;
+	}
+
+#ifdef _WIN32
+	UnmapViewOfFile(mpq_archive->map_base);
+	CloseHandle(mpq_archive->map_handle);
+	mpq_archive->map_handle = NULL;
+#else
+	munmap(mpq_archive->map_base, mpq_archive->map_size);
+#endif
+
+	mpq_archive->map_base = NULL;
+	mpq_archive->map_size = 0;
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
 /* this function close the file descriptor, free the decryption buffer and the file list. */
 int32_t libmpq__archive_close(mpq_archive_s *mpq_archive) {
 
+	/* release the mapping before the file goes away. */
+	libmpq__archive_unmap(mpq_archive);
+
 	/* try to close the file */
 	if ((fclose(mpq_archive->fp)) < 0) {
 
@@ -321,6 +464,7 @@ int32_t libmpq__archive_close(mpq_archive_s *mpq_archive) {
 	free(mpq_archive->mpq_hash);
 	free(mpq_archive->mpq_block);
 	free(mpq_archive->mpq_block_ex);
+	libmpq__mutex_destroy(&mpq_archive->lock);
 	free(mpq_archive);
 
 	/* if no error was found, return zero. */
@@ -491,17 +635,24 @@ int32_t libmpq__file_imploded(mpq_archive_s *mpq_archive, uint32_t file_number,
 /* this function return filenumber by the given name. */
 int32_t libmpq__file_number(mpq_archive_s *mpq_archive, const char *filename, uint32_t *number) {
 
-	/* some common variables. */
-	uint32_t i, hash1, hash2, hash3, ht_count;
-
 	/* if the list of file names doesn't include this one, we'll have
 	 * to figure out the file number the "hard" way.
 	 */
-	ht_count = mpq_archive->mpq_header.hash_table_count;
+	return libmpq__file_number_hash(mpq_archive,
+		libmpq__hash_string (filename, 0x0),
+		libmpq__hash_string (filename, 0x100),
+		libmpq__hash_string (filename, 0x200),
+		number);
+}
 
-	hash1 = libmpq__hash_string (filename, 0x0) & (ht_count - 1);
-	hash2 = libmpq__hash_string (filename, 0x100);
-	hash3 = libmpq__hash_string (filename, 0x200);
+/* this function returns the file number for the name hashes from libmpq__file_hash(), for callers that hash their names once. */
+int32_t libmpq__file_number_hash(mpq_archive_s *mpq_archive, uint32_t hash1, uint32_t hash2, uint32_t hash3, uint32_t *number) {
+
+	/* some common variables. */
+	uint32_t i, ht_count;
+
+	ht_count = mpq_archive->mpq_header.hash_table_count;
+	hash1 &= ht_count - 1;
 
 	/* loop through all files in mpq archive.
 	 * hash1 gives us a clue about the starting position of this
@@ -530,6 +681,55 @@ int32_t libmpq__file_number(mpq_archive_s *mpq_archive, const char *filename, ui
 	return LIBMPQ_ERROR_EXIST;
 }
 
+/* this function return the three name hashes of the given filename, hash1 is not masked by the hash table size. */
+int32_t libmpq__file_hash(const char *filename, uint32_t *hash1, uint32_t *hash2, uint32_t *hash3) {
+
+	/* compute the hashes like libmpq__file_number() does. */
+	*hash1 = libmpq__hash_string (filename, 0x0);
+	*hash2 = libmpq__hash_string (filename, 0x100);
+	*hash3 = libmpq__hash_string (filename, 0x200);
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
+/* this function return the number of entries in the hash table. */
+int32_t libmpq__archive_hashes(mpq_archive_s *mpq_archive, uint32_t *count) {
+
+	/* return hash table size. */
+	*count = mpq_archive->mpq_header.hash_table_count;
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
+/* this function return the name hashes and file number stored in the given hash table entry. */
+int32_t libmpq__hash_entry(mpq_archive_s *mpq_archive, uint32_t hash_index, uint32_t *hash2, uint32_t *hash3, uint32_t *number) {
+
+	/* some common variables. */
+	uint32_t block_index;
+
+	/* check if hash index is valid. */
+	if (hash_index >= mpq_archive->mpq_header.hash_table_count) {
+		return LIBMPQ_ERROR_EXIST;
+	}
+
+	/* free or deleted entries and entries pointing to removed blocks do not name a file. */
+	block_index = mpq_archive->mpq_hash[hash_index].block_table_index;
+	if (block_index >= mpq_archive->mpq_header.block_table_count ||
+	    (mpq_archive->mpq_block[block_index].flags & LIBMPQ_FLAG_EXISTS) == 0) {
+		return LIBMPQ_ERROR_EXIST;
+	}
+
+	/* return the hashes and the file number. */
+	*hash2  = mpq_archive->mpq_hash[hash_index].hash_a;
+	*hash3  = mpq_archive->mpq_hash[hash_index].hash_b;
+	*number = block_index - mpq_archive->mpq_map[block_index].block_table_diff;
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
 /* this function read the given file from archive into a buffer. */
 int32_t libmpq__file_read(mpq_archive_s *mpq_archive, uint32_t file_number, uint8_t *out_buf, libmpq__off_t out_size, libmpq__off_t *transferred) {
 
@@ -605,6 +805,47 @@ int32_t libmpq__file_read(mpq_archive_s *mpq_archive, uint32_t file_number, uint
 	return LIBMPQ_SUCCESS;
 }
 
+/* this function returns a pointer to the file data inside the mapping, only possible for mapped archives and plain stored files. */
+int32_t libmpq__file_mapped(mpq_archive_s *mpq_archive, uint32_t file_number, const uint8_t **data) {
+
+	/* some common variables. */
+	uint32_t flags;
+	libmpq__off_t file_offset = 0;
+	libmpq__off_t unpacked_size = 0;
+	libmpq__off_t packed_size = 0;
+
+	/* check if given file number is not out of range. */
+	CHECK_FILE_NUM(file_number, mpq_archive)
+
+	/* check if the archive is mapped. */
+	if (mpq_archive->map_base == NULL) {
+		return LIBMPQ_ERROR_OPEN;
+	}
+
+	flags = mpq_archive->mpq_block[mpq_archive->mpq_map[file_number].block_table_indices].flags;
+	libmpq__file_offset(mpq_archive, file_number, &file_offset);
+	libmpq__file_size_unpacked(mpq_archive, file_number, &unpacked_size);
+	libmpq__file_size_packed(mpq_archive, file_number, &packed_size);
+
+	/* only files stored as they are can be used in place, either without compression at all or as
+	 * a single sector which turned out not to be smaller when compressed. */
+	if ((flags & LIBMPQ_FLAG_ENCRYPTED) != 0 ||
+	    ((flags & LIBMPQ_FLAG_COMPRESSED) != 0 && ((flags & LIBMPQ_FLAG_SINGLE) == 0 || packed_size != unpacked_size))) {
+		return LIBMPQ_ERROR_EXIST;
+	}
+
+	/* check if the file is inside the mapping. */
+	if (file_offset + mpq_archive->archive_offset + unpacked_size > mpq_archive->map_size) {
+		return LIBMPQ_ERROR_SIZE;
+	}
+
+	/* return pointer into mapping. */
+	*data = mpq_archive->map_base + file_offset + mpq_archive->archive_offset;
+
+	/* if no error was found, return zero. */
+	return LIBMPQ_SUCCESS;
+}
+
 /* this function open a file in the given archive and caches the block offset information. */
 int32_t libmpq__block_open_offset(mpq_archive_s *mpq_archive, uint32_t file_number) {
 
@@ -616,10 +857,14 @@ int32_t libmpq__block_open_offset(mpq_archive_s *mpq_archive, uint32_t file_numb
 	/* check if given file number is not out of range. */
 	CHECK_FILE_NUM(file_number, mpq_archive)
 
+	/* the open table and the block flags are shared between threads. */
+	libmpq__mutex_lock(&mpq_archive->lock);
+
 	if (mpq_archive->mpq_file[file_number]) {
 
 		/* file already opened, so increment counter */
 		mpq_archive->mpq_file[file_number]->open_count++;
+		libmpq__mutex_unlock(&mpq_archive->lock);
 		return LIBMPQ_SUCCESS;
 	}
 
@@ -664,16 +909,8 @@ int32_t libmpq__block_open_offset(mpq_archive_s *mpq_archive, uint32_t file_numb
 	if ((mpq_archive->mpq_block[mpq_archive->mpq_map[file_number].block_table_indices].flags & LIBMPQ_FLAG_COMPRESSED) != 0 &&
 	    (mpq_archive->mpq_block[mpq_archive->mpq_map[file_number].block_table_indices].flags & LIBMPQ_FLAG_SINGLE) == 0) {
 
-		/* seek to block position. */
-		if (fseeko(mpq_archive->fp, mpq_archive->mpq_block[mpq_archive->mpq_map[file_number].block_table_indices].offset + (((long long)mpq_archive->mpq_block_ex[mpq_archive->mpq_map[file_number].block_table_indices].offset_high) << 32) + mpq_archive->archive_offset, SEEK_SET) < 0) {
-
-			/* seek in file failed. */
-			result = LIBMPQ_ERROR_SEEK;
-			goto error;
-		}
-
 		/* read block positions from begin of file. */
-		if (fread(mpq_archive->mpq_file[file_number]->packed_offset, 1, packed_size, mpq_archive->fp) != packed_size) {
+		if (libmpq__read_at(mpq_archive, mpq_archive->mpq_file[file_number]->packed_offset, packed_size, mpq_archive->mpq_block[mpq_archive->mpq_map[file_number].block_table_indices].offset + (((long long)mpq_archive->mpq_block_ex[mpq_archive->mpq_map[file_number].block_table_indices].offset_high) << 32) + mpq_archive->archive_offset) < 0) {
 
 			/* something on read from archive failed. */
 			result = LIBMPQ_ERROR_READ;
@@ -744,14 +981,23 @@ int32_t libmpq__block_open_offset(mpq_archive_s *mpq_archive, uint32_t file_numb
 		}
 	}
 
+	libmpq__mutex_unlock(&mpq_archive->lock);
+
 	/* if no error was found, return zero. */
 	return LIBMPQ_SUCCESS;
 
 error:
 
 	/* free packed block offset table and file pointer. */
-	free(mpq_archive->mpq_file[file_number]->packed_offset);
-	free(mpq_archive->mpq_file[file_number]);
+	if (mpq_archive->mpq_file[file_number]) {
+		free(mpq_archive->mpq_file[file_number]->packed_offset);
+		free(mpq_archive->mpq_file[file_number]);
+	}
+
+	/* mark it as unopened, otherwise the next open would pick up the freed entry. */
+	mpq_archive->mpq_file[file_number] = NULL;
+
+	libmpq__mutex_unlock(&mpq_archive->lock);
 
 	/* return error constant. */
 	return result;
@@ -763,9 +1009,12 @@ int32_t libmpq__block_close_offset(mpq_archive_s *mpq_archive, uint32_t file_num
 	/* check if given file number is not out of range. */
 	CHECK_FILE_NUM(file_number, mpq_archive)
 
+	libmpq__mutex_lock(&mpq_archive->lock);
+
 	if (mpq_archive->mpq_file[file_number] == NULL) {
 
 		/* packed block offset table is not opened. */
+		libmpq__mutex_unlock(&mpq_archive->lock);
 		return LIBMPQ_ERROR_OPEN;
 	}
 
@@ -774,6 +1023,7 @@ int32_t libmpq__block_close_offset(mpq_archive_s *mpq_archive, uint32_t file_num
 	if (mpq_archive->mpq_file[file_number]->open_count != 0) {
 
 		/* still in use */
+		libmpq__mutex_unlock(&mpq_archive->lock);
 		return LIBMPQ_SUCCESS;
 	}
 
@@ -784,6 +1034,8 @@ int32_t libmpq__block_close_offset(mpq_archive_s *mpq_archive, uint32_t file_num
 	/* mark it as unopened - libmpq__block_open_offset checks for this to decide whether to increment the counter */
 	mpq_archive->mpq_file[file_number] = NULL;
 
+	libmpq__mutex_unlock(&mpq_archive->lock);
+
 	/* if no error was found, return zero. */
 	return LIBMPQ_SUCCESS;
 }
@@ -860,6 +1112,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 
 	/* some common variables. */
 	uint8_t *in_buf;
+	uint8_t *in_alloc           = NULL;
 	uint32_t seed               = 0;
 	uint32_t encrypted          = 0;
 	uint32_t compressed         = 0;
@@ -897,32 +1150,35 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 	block_offset = mpq_archive->mpq_block[mpq_archive->mpq_map[file_number].block_table_indices].offset + (((long long)mpq_archive->mpq_block_ex[mpq_archive->mpq_map[file_number].block_table_indices].offset_high) << 32) + mpq_archive->mpq_file[file_number]->packed_offset[block_number];
 	in_size = mpq_archive->mpq_file[file_number]->packed_offset[block_number + 1] - mpq_archive->mpq_file[file_number]->packed_offset[block_number];
 
-	/* seek in file. */
-	if (fseeko(mpq_archive->fp, block_offset + mpq_archive->archive_offset, SEEK_SET) < 0) {
+	/* get encryption status. */
+	libmpq__file_encrypted(mpq_archive, file_number, &encrypted);
 
-		/* something with seek in file failed. */
-		return LIBMPQ_ERROR_SEEK;
-	}
+	/* a mapped block can be decompressed straight from the mapping, unless it has to be decrypted first. */
+	if (mpq_archive->map_base != NULL && !encrypted &&
+	    block_offset + mpq_archive->archive_offset + in_size <= mpq_archive->map_size) {
 
-	/* allocate memory for the read buffer. */
-	if ((in_buf = calloc(1, in_size)) == NULL) {
+		/* point into the mapping, nothing to read. */
+		in_buf = mpq_archive->map_base + block_offset + mpq_archive->archive_offset;
+	} else {
 
-		/* memory allocation problem. */
-		return LIBMPQ_ERROR_MALLOC;
-	}
+		/* allocate memory for the read buffer, it is private to this call. */
+		if ((in_alloc = calloc(1, in_size)) == NULL) {
 
-	/* read block from file. */
-	if (fread(in_buf, 1, in_size, mpq_archive->fp) != in_size) {
+			/* memory allocation problem. */
+			return LIBMPQ_ERROR_MALLOC;
+		}
+		in_buf = in_alloc;
 
-		/* free buffers. */
-		free(in_buf);
+		/* read block from file. */
+		if (libmpq__read_at(mpq_archive, in_buf, in_size, block_offset + mpq_archive->archive_offset) < 0) {
 
-		/* something on reading block failed. */
-		return LIBMPQ_ERROR_READ;
-	}
+			/* free buffers. */
+			free(in_alloc);
 
-	/* get encryption status. */
-	libmpq__file_encrypted(mpq_archive, file_number, &encrypted);
+			/* something on reading block failed. */
+			return LIBMPQ_ERROR_READ;
+		}
+	}
 
 	/* check if file is encrypted. */
 	if (encrypted) {
@@ -934,7 +1190,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 		if (libmpq__decrypt_block((uint32_t *)in_buf, in_size, seed) < 0) {
 
 			/* free buffers. */
-			free(in_buf);
+			free(in_alloc);
 
 			/* something on decrypting block failed. */
 			return LIBMPQ_ERROR_DECRYPT;
@@ -951,7 +1207,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 		if ((tb = libmpq__decompress_block(in_buf, in_size, out_buf, out_size, LIBMPQ_FLAG_COMPRESS_MULTI)) < 0) {
 
 			/* free temporary buffer. */
-			free(in_buf);
+			free(in_alloc);
 
 			/* something on decompressing block failed. */
 			return LIBMPQ_ERROR_UNPACK;
@@ -968,7 +1224,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 		if ((tb = libmpq__decompress_block(in_buf, in_size, out_buf, out_size, LIBMPQ_FLAG_COMPRESS_PKZIP)) < 0) {
 
 			/* free temporary buffer. */
-			free(in_buf);
+			free(in_alloc);
 
 			/* something on decompressing block failed. */
 			return LIBMPQ_ERROR_UNPACK;
@@ -978,7 +1234,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 	/* files should not be compressed and imploded */
 	if (compressed && imploded) {
 		/* free temporary buffer. */
-		free(in_buf);
+		free(in_alloc);
 
 		/* something on decompressing block failed. */
 		return LIBMPQ_ERROR_UNPACK;
@@ -991,7 +1247,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 		if ((tb = libmpq__decompress_block(in_buf, in_size, out_buf, out_size, LIBMPQ_FLAG_COMPRESS_NONE)) < 0) {
 
 			/* free temporary buffer. */
-			free(in_buf);
+			free(in_alloc);
 
 			/* something on decompressing block failed. */
 			return LIBMPQ_ERROR_UNPACK;
@@ -999,7 +1255,7 @@ int32_t libmpq__block_read(mpq_archive_s *mpq_archive, uint32_t file_number, uin
 	}
 
 	/* free read buffer. */
-	free(in_buf);
+	free(in_alloc);
 
 	/* check for null pointer. */
 	if (transferred != NULL) {
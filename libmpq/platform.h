@@ -25,4 +25,27 @@
   #define fseeko _fseeki64
 #endif
 
+/* archive lock, guards the shared per-file block offset tables. */
+#ifdef _WIN32
+  #ifndef WIN32_LEAN_AND_MEAN
+    #define WIN32_LEAN_AND_MEAN
+  #endif
+  #include <windows.h>
+  #include <io.h>
+  typedef CRITICAL_SECTION libmpq__mutex_t;
+  #define libmpq__mutex_init(m)		InitializeCriticalSection(m)
+  #define libmpq__mutex_destroy(m)	DeleteCriticalSection(m)
+  #define libmpq__mutex_lock(m)		EnterCriticalSection(m)
+  #define libmpq__mutex_unlock(m)	LeaveCriticalSection(m)
+#else
+  #include <pthread.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+  typedef pthread_mutex_t libmpq__mutex_t;
+  #define libmpq__mutex_init(m)		pthread_mutex_init(m, NULL)
+  #define libmpq__mutex_destroy(m)	pthread_mutex_destroy(m)
+  #define libmpq__mutex_lock(m)		pthread_mutex_lock(m)
+  #define libmpq__mutex_unlock(m)	pthread_mutex_unlock(m)
+#endif
+
 #endif								/* _PLATFORM_H */
@@ -7,7 +7,7 @@ struct LiquidVertex {
 };
 
 
-void Liquid::initFromTerrain(MPQFile &f, int flags)
+void Liquid::initFromTerrain(const char *data, int flags)
 {
 	texRepeats = 4.0f;
 	/*
@@ -36,7 +36,7 @@ void Liquid::initFromTerrain(MPQFile &f, int flags)
 		*/
 		type = 2;
 	}
-	initGeometry(f);
+	initGeometry(data);
 	trans = false;
 }
 
@@ -45,7 +45,7 @@ void Liquid::initFromWMO(MPQFile &f, WMOMaterial &mat, bool indoor)
 	texRepeats = 4.0f;
 	ydir = -1.0f;
 
-	initGeometry(f);
+	initGeometry(f.getPointer());
 
 	trans = false;
 
@@ -73,7 +73,7 @@ void Liquid::initFromWMO(MPQFile &f, WMOMaterial &mat, bool indoor)
 	/*
 	// HACK: this is just...wrong
 	// TODO: figure out proper way to identify liquid types
-	const char *texname = video.textures.items[mat.tex]->name.c_str();
+	const char *texname = video.textures.item(mat.tex)->name.c_str();
 	char *pos = strstr(texname, "Slime");
 	if (pos!=0) {
 		// slime
@@ -96,30 +96,30 @@ void Liquid::initFromWMO(MPQFile &f, WMOMaterial &mat, bool indoor)
 }
 
 
-void Liquid::initGeometry(MPQFile& f) {
-	LiquidVertex* map = (LiquidVertex*)f.getPointer();
+void Liquid::initGeometry(const char *data) {
+	LiquidVertex* map = (LiquidVertex*)data;
 
 	// Validate pointer and check for obvious corruption
 	if (!map || reinterpret_cast<uintptr_t>(map) & 0x3) {
-		gLog("Error: Invalid or misaligned liquid vertex map pointer: %p\n", map);
+		gLogError("Error: Invalid or misaligned liquid vertex map pointer: %p\n", map);
 		return;
 	}
 
 	size_t flagsOffset = (xtiles + 1) * (ytiles + 1) * sizeof(LiquidVertex);
 	if (flagsOffset != 648) { // Expected size based on 8x8 tiles
-		gLog("Error: Invalid flags offset %zu (expected 648)\n", flagsOffset);
+		gLogError("Error: Invalid flags offset %zu (expected 648)\n", flagsOffset);
 		return;
 	}
 
 	// Validate tiles dimensions
 	if (xtiles != 8 || ytiles != 8) {
-		gLog("Error: Invalid tile dimensions: %dx%d\n", xtiles, ytiles);
+		gLogError("Error: Invalid tile dimensions: %dx%d\n", xtiles, ytiles);
 		return;
 	}
 
-	unsigned char* flags = (unsigned char*)(f.getPointer() + flagsOffset);
+	unsigned char* flags = (unsigned char*)(data + flagsOffset);
 	if (!flags) {
-		gLog("Error: Invalid flags pointer\n");
+		gLogError("Error: Invalid flags pointer\n");
 		return;
 	}
 
@@ -131,7 +131,7 @@ void Liquid::initGeometry(MPQFile& f) {
 
 			// Check array bounds
 			if (p >= (xtiles + 1) * (ytiles + 1)) {
-				gLog("Error: Vertex index out of bounds\n");
+				gLogError("Error: Vertex index out of bounds\n");
 				delete[] verts;
 				return;
 			}
@@ -258,7 +258,7 @@ void Liquid::initGeometry(MPQFile& f) {
 	*/
 }
 
-void Liquid::draw()
+void Liquid::draw(float dist)
 {
 	// First validate the this pointer - if the memory pattern shows 0xCD, 
 	// this is likely uninitialized memory
@@ -283,6 +283,7 @@ void Liquid::draw()
 		}
 
 		glBindTexture(GL_TEXTURE_2D, textures[texidx]);
+		video.textures.use(textures[texidx], dist);
 
 		const float tcol = trans ? 0.9f : 1.0f;
 		if (trans) {
@@ -21,7 +21,8 @@ class Liquid {
 	float ydir;
 	float texRepeats;
 
-	void initGeometry(MPQFile &f);
+	// (xtiles+1)*(ytiles+1) vertices followed by the tile flags
+	void initGeometry(const char *data);
 	void initTextures(char *basename, int first, int last);
 
 	int type;
@@ -40,10 +41,11 @@ public:
 	~Liquid();
 
 	//void init(MPQFile &f);
-	void initFromTerrain(MPQFile &f, int flags);
+	void initFromTerrain(const char *data, int flags);
 	void initFromWMO(MPQFile &f, WMOMaterial &mat, bool indoor);
 
-	void draw();
+	// dist from the camera, for the textures as in MapChunk::draw
+	void draw(float dist);
 
 	std::vector<GLuint> textures;
 
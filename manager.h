@@ -2,7 +2,9 @@
 #define MANAGER_H
 
 #include <string>
-#include <map>
+#include <vector>
+#include <string.h>
+#include "assetpath.h"
 
 // base class for manager objects
 
@@ -10,7 +12,7 @@ class ManagedItem {
 	int refcount;
 public:
 	std::string name;
-	ManagedItem(std::string n): name(n), refcount(0) {}
+	ManagedItem(std::string n): refcount(0), name(n) {}
 	virtual ~ManagedItem() {}
 
 	void addref()
@@ -22,73 +24,302 @@ public:
 	{
 		return --refcount==0;
 	}
-	
+
+};
+
+
+// Open addressing hash table with linear probing. Deleted slots are left
+// as tombstones and cleared out when the table grows.
+template <class KEY, class VALUE, class TRAITS>
+class FlatMap {
+	enum { EMPTY, USED, DELETED };
+
+	struct Slot {
+		KEY key;
+		VALUE value;
+		unsigned int hash;
+		unsigned char state;
+	};
+
+	std::vector<Slot> slots;
+	size_t used, tombstones;
+
+	size_t lookup(const KEY &key, unsigned int hash) const
+	{
+		size_t mask = slots.size() - 1;
+		for (size_t i = hash & mask; ; i = (i+1) & mask) {
+			const Slot &s = slots[i];
+			if (s.state == EMPTY)
+				return (size_t)-1;
+			if (s.state == USED && s.hash == hash && TRAITS::equal(s.key, key))
+				return i;
+		}
+	}
+
+	void grow()
+	{
+		std::vector<Slot> old;
+		old.swap(slots);
+		slots.resize(old.empty() ? 64 : (used*2 > old.size() ? old.size()*2 : old.size()));
+		for (size_t i=0; i<slots.size(); i++)
+			slots[i].state = EMPTY;
+		tombstones = 0;
+
+		size_t mask = slots.size() - 1;
+		for (size_t i=0; i<old.size(); i++) {
+			if (old[i].state != USED)
+				continue;
+			size_t j = old[i].hash & mask;
+			while (slots[j].state != EMPTY)
+				j = (j+1) & mask;
+			slots[j] = old[i];
+		}
+	}
+
+public:
+	FlatMap(): used(0), tombstones(0) {}
+
+	size_t size() const { return used; }
+
+	const VALUE *find(const KEY &key) const
+	{
+		return find(key, TRAITS::hash(key));
+	}
+
+	// for callers that already know TRAITS::hash(key)
+	const VALUE *find(const KEY &key, unsigned int hash) const
+	{
+		if (slots.empty())
+			return 0;
+		size_t i = lookup(key, hash);
+		return i == (size_t)-1 ? 0 : &slots[i].value;
+	}
+
+	// key must not be in the table yet
+	void insert(const KEY &key, const VALUE &value)
+	{
+		insert(key, value, TRAITS::hash(key));
+	}
+
+	void insert(const KEY &key, const VALUE &value, unsigned int hash)
+	{
+		// keep probes short: at most 3/4 full, counting tombstones
+		if ((used + tombstones + 1) * 4 > slots.size() * 3)
+			grow();
+
+		size_t mask = slots.size() - 1;
+		size_t i = hash & mask;
+		while (slots[i].state == USED)
+			i = (i+1) & mask;
+		if (slots[i].state == DELETED)
+			tombstones--;
+
+		slots[i].key = key;
+		slots[i].value = value;
+		slots[i].hash = hash;
+		slots[i].state = USED;
+		used++;
+	}
+
+	bool erase(const KEY &key)
+	{
+		return erase(key, TRAITS::hash(key));
+	}
+
+	bool erase(const KEY &key, unsigned int hash)
+	{
+		if (slots.empty())
+			return false;
+		size_t i = lookup(key, hash);
+		if (i == (size_t)-1)
+			return false;
+		slots[i].state = DELETED;
+		used--;
+		tombstones++;
+		return true;
+	}
+
+	// f(key, value) for every entry; the table must not change meanwhile
+	template <class F>
+	void forEach(F f) const
+	{
+		for (size_t i=0; i<slots.size(); i++) {
+			if (slots[i].state == USED)
+				f(slots[i].key, slots[i].value);
+		}
+	}
 };
 
+// Names are hashed with FNV-1a. The table keeps no copy of them: keys point
+// at the name of the item they belong to, or at the interned AssetPath
+// string for items added by path, so those mostly match on the address.
+struct ManagerNameTraits {
+	static unsigned int hash(const char *s) { return assetNameHash(s); }
+	static bool equal(const char *a, const char *b) { return a == b || !strcmp(a, b); }
+};
+
+template <class IDTYPE>
+struct ManagerIdTraits {
+	static unsigned int hash(IDTYPE id)
+	{
+		unsigned int h = (unsigned int)id * 0x9E3779B1u;
+		return h ^ (h >> 16);
+	}
+	static bool equal(IDTYPE a, IDTYPE b) { return a == b; }
+};
 
 
 template <class IDTYPE>
 class Manager {
-public:
-	std::map<std::string, IDTYPE> names;
-	std::map<IDTYPE, ManagedItem*> items;
+	FlatMap<const char*, IDTYPE, ManagerNameTraits> names;
+	FlatMap<IDTYPE, ManagedItem*, ManagerIdTraits<IDTYPE> > items;
 
+public:
 	Manager()
 	{
 	}
 
-	virtual IDTYPE add(std::string name) = 0;
+	virtual ~Manager() {}
+
+	virtual IDTYPE add(const std::string &name) = 0;
 
 	virtual void del(IDTYPE id)
 	{
-		if (items[id]->delref()) {
-			ManagedItem *i = items[id];
+		ManagedItem *i = item(id);
+		if (i && i->delref()) {
 			doDelete(id);
-			names.erase(names.find(i->name));
-			items.erase(items.find(id));
+			names.erase(i->name.c_str());
+			items.erase(id);
 			delete i;
 		}
 	}
 
-	void delbyname(std::string name)
+	void delbyname(const std::string &name)
 	{
-		if (has(name)) del(get(name));
+		const IDTYPE *id = names.find(name.c_str());
+		if (id) del(*id);
+	}
+
+	void delbyname(const AssetPath &path)
+	{
+		const IDTYPE *id = names.find(path.c_str(), path.nameHash());
+		if (id) del(*id);
 	}
 
 	virtual void doDelete(IDTYPE id) {}
 
-	bool has(std::string name)
+	bool has(const std::string &name) const
+	{
+		return names.find(name.c_str()) != 0;
+	}
+
+	bool has(const AssetPath &path) const
+	{
+		return names.find(path.c_str(), path.nameHash()) != 0;
+	}
+
+	// IDTYPE() when nothing by that name is loaded
+	IDTYPE get(const std::string &name) const
+	{
+		const IDTYPE *id = names.find(name.c_str());
+		return id ? *id : IDTYPE();
+	}
+
+	IDTYPE get(const AssetPath &path) const
 	{
-		return (names.find(name) != names.end());
+		const IDTYPE *id = names.find(path.c_str(), path.nameHash());
+		return id ? *id : IDTYPE();
 	}
 
-	IDTYPE get(std::string name)
+	// NULL for ids that were never handed out or have been deleted
+	ManagedItem *item(IDTYPE id) const
 	{
-		return names[name];
+		ManagedItem * const *i = items.find(id);
+		return i ? *i : 0;
+	}
+
+	size_t count() const { return items.size(); }
+
+	// f(id, item) for everything loaded
+	template <class F>
+	void forEach(F f) const
+	{
+		items.forEach(f);
 	}
 
 protected:
-	void do_add(std::string name, IDTYPE id, ManagedItem* item)
+	// one lookup for the common case of adding something already loaded
+	bool addref(const std::string &name, IDTYPE &id)
+	{
+		const IDTYPE *found = names.find(name.c_str());
+		if (!found)
+			return false;
+		id = *found;
+		item(id)->addref();
+		return true;
+	}
+
+	bool addref(const AssetPath &path, IDTYPE &id)
+	{
+		const IDTYPE *found = names.find(path.c_str(), path.nameHash());
+		if (!found)
+			return false;
+		id = *found;
+		item(id)->addref();
+		return true;
+	}
+
+	void do_add(const std::string &name, IDTYPE id, ManagedItem* item)
 	{
-		names[name] = id;
 		item->addref();
-		items[id] = item;
+		items.insert(id, item);
+		names.insert(item->name.c_str(), id);
+	}
+
+	// keyed on the interned string, which outlives the item
+	void do_add(const AssetPath &path, IDTYPE id, ManagedItem* item)
+	{
+		item->addref();
+		items.insert(id, item);
+		names.insert(path.c_str(), id, path.nameHash());
 	}
 };
 
+// Hands out generational ids: the low bits pick a slot that is reused after
+// a delete, the high bits count how often it was, so an id kept past its
+// del() never finds the item that took over the slot. 0 is never an id.
 class SimpleManager : public Manager<int> {
-	int baseid;
+	enum { SLOT_BITS = 20, SLOT_MASK = (1 << SLOT_BITS) - 1, MAX_GENERATION = 0x7ff };
+
+	std::vector<int> generations;
+	std::vector<int> freeSlots;
+
 public:
-	SimpleManager() : baseid(0)
+	SimpleManager()
 	{
 	}
 
+	// subclasses overriding this have to call it
+	virtual void doDelete(int id)
+	{
+		int slot = id & SLOT_MASK;
+		generations[slot] = generations[slot] == MAX_GENERATION ? 1 : generations[slot] + 1;
+		freeSlots.push_back(slot);
+	}
+
 protected:
 	int nextID()
 	{
-		return baseid++;
+		int slot;
+		if (!freeSlots.empty()) {
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		} else {
+			slot = (int)generations.size();
+			generations.push_back(1);
+		}
+		return (generations[slot] << SLOT_BITS) | slot;
 	}
 };
 
 #endif
-
@@ -1,30 +1,27 @@
 #include "maptile.h"
 #include "world.h"
+#include "raycast.h"
 #include "vec3d.h"
 #include <cassert>
 #include <algorithm>
+#include <chrono>
 using namespace std;
 
 
-MapTile::MapTile(int x0, int z0, char* filename): x(x0), z(z0), topnode(0,0,16)
+void MapTile::textureNames(const char *filename, std::vector<std::string> &names)
 {
-	xbase = x0 * TILESIZE;
-	zbase = z0 * TILESIZE;
-
-	gLog("Loading tile %d,%d\n",x0,z0);
+	assetNames(filename, &names, 0, 0);
+}
 
+void MapTile::assetNames(const char *filename, std::vector<std::string> *textures,
+	std::vector<std::string> *models, std::vector<std::string> *wmos)
+{
 	MPQFile f(filename);
-	ok = !f.isEof();
-	if (!ok) {
-		gLog("-> Error loading %s\n",filename);
-		return;
-	}
+	if (f.isEof()) return;
 
 	char fourcc[5];
 	size_t size;
 
-	size_t mcnk_offsets[256], mcnk_sizes[256];
-
 	while (!f.isEof()) {
 		f.read(fourcc,4);
 		f.read(&size, 4);
@@ -34,196 +31,211 @@ MapTile::MapTile(int x0, int z0, char* filename): x(x0), z(z0), topnode(0,0,16)
 
 		size_t nextpos = f.getPos() + size;
 
-		if (!strcmp(fourcc,"MCIN")) {
-			// mapchunk offsets/sizes
-			for (int i=0; i<256; i++) {
-				f.read(&mcnk_offsets[i],4);
-				f.read(&mcnk_sizes[i],4);
-				f.seekRelative(8);
-			}
-		}
-		else if (!strcmp(fourcc,"MTEX")) {
-			// texture lists
+		std::vector<std::string> *names = 0;
+		if (!strcmp(fourcc,"MTEX")) names = textures;
+		else if (!strcmp(fourcc,"MMDX")) names = models;
+		else if (!strcmp(fourcc,"MWMO")) names = wmos;
+
+		if (names && size) {
 			char *buf = new char[size];
 			f.read(buf, size);
 			char *p=buf;
-			int t=0;
 			while (p<buf+size) {
-				string texpath(p);
+				string path(p);
 				p+=strlen(p)+1;
-				fixname(texpath);
-				video.textures.add(texpath);
-				textures.push_back(texpath);
+				fixname(path);
+				names->push_back(path);
 			}
 			delete[] buf;
 		}
-		else if (!strcmp(fourcc,"MMDX")) {
-			// models ...
-			// MMID would be relative offsets for MMDX filenames
-			if (size) {
-				char *buf = new char[size];
-				f.read(buf, size);
-				char *p=buf;
-				int t=0;
-				while (p<buf+size) {
-					string path(p);
-					p+=strlen(p)+1;
-					fixname(path);
-
-					gWorld->modelmanager.add(path);
-					models.push_back(path);
-				}
-				delete[] buf;
-			}
+		// the name lists come before the chunks
+		else if (!strcmp(fourcc,"MCNK")) {
+			break;
 		}
-		/*else if (!strcmp(fourcc, "MWMO")) {
-			// map objects
-			// MWID would be relative offsets for MWMO filenames
-			if (size) {
-				char *buf = new char[size];
-				f.read(buf, size);
-				char *p=buf;
-				while (p<buf+size) {
-					string path(p);
-					p+=strlen(p)+1;
-					fixname(path);
-					// World\wmo\Azeroth\Buildings\Stormwind\Stormwind.wmo
+		f.seek((int)nextpos);
+	}
+
+	f.close();
+}
+
+float MapTile::commitBudgetMs = 4.0f;
+
+// what MapChunk::init uploads for d
+static void addChunkMemory(MapTile::Memory &mem, const ChunkData &d)
+{
+	mem.vertex += 2 * mapbufsize * 3 * sizeof(float);
+	if (d.holes) mem.vertex += 256 * sizeof(short);
+	// the display list is about as big as what it was built from
+	if (d.haswater) mem.vertex += liquidDataSize;
+
+	if (d.nTextures > 1) mem.texture += (d.nTextures - 1) * 64 * 64;
+	if (d.hasShadow) mem.texture += 64 * 64;
+}
+
+MapTile::MapTile(int x0, int z0, char* filename): topnode(0,0,16)
+{
+	TileData *d = new TileData;
+	d->parse(x0, z0, filename);
+	init(d);
+	commit(0);
+}
+
+MapTile::MapTile(TileData *d): topnode(0,0,16)
+{
+	init(d);
+}
+
+void MapTile::init(TileData *d)
+{
+	data = d;
+	x = d->x;
+	z = d->z;
+	xbase = x * TILESIZE;
+	zbase = z * TILESIZE;
+	ok = d->ok;
+	nWMO = 0;
+	nMDX = 0;
+	commitStage = COMMIT_TEXTURES;
+	commitNext = 0;
+	releaseNext = 0;
+
+	mem.vertex = sizeof(HeightField);
+	mem.texture = mem.object = 0;
+	mem.pending = sizeof(TileData);
+
+	if (!ok) {
+		mem.vertex = mem.pending = 0;
+		delete data;
+		data = 0;
+	}
+}
+
+bool MapTile::commit(float budgetMs)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// models, WMOs and chunks one at a time, the clock is checked in between
+	while (data) {
+		switch (commitStage) {
+		case COMMIT_TEXTURES:
+			// just names, the decoding happens elsewhere
+			for (size_t i=0; i<data->textures.size(); i++) {
+				AssetPath path(data->textures[i]);
+				video.textures.add(path);
+				textures.push_back(path);
+			}
+			commitStage = COMMIT_MODELS;
+			break;
+		case COMMIT_MODELS:
+			if (commitNext < data->models.size()) {
+				AssetPath path(data->models[commitNext++]);
+				gWorld->modelmanager.add(path);
+				models.push_back(path);
+			} else {
+				commitStage = COMMIT_WMOS;
+				commitNext = 0;
+			}
+			break;
+		case COMMIT_WMOS:
+			if (commitNext < data->wmos.size()) {
+				const std::string &name = data->wmos[commitNext++];
+				if (!name.empty()) {
+					AssetPath path(name);
 					gWorld->wmomanager.add(path);
 					wmos.push_back(path);
 				}
-				delete[] buf;
-			}
-		}*/
-		/*else if (!strcmp(fourcc, "MWMO")) {
-			// map objects
-			// MWID would be relative offsets for MWMO filenames
-			if (size) {
-				char* buf = new char[size];
-				f.read(buf, size);
-				char* p = buf;
-				while (p < buf + size)
-				{
-					// First get the original path exactly as it appears in the MPQ
-					string path = string(p);
-					p += strlen(p) + 1;
-
-					// Test if file exists in MPQ
-					MPQFile test(path.c_str());
-					if (!test.isEof()) {
-						fixname(path);
-						gWorld->wmomanager.add(path);
-						wmos.push_back(path);
-						gLog("Adding WMO: %s\n", path.c_str());
-					}
-					else {
-						gLog("Skipping missing WMO: %s\n", path.c_str());
-					}
-					test.close();
-				}
-				delete[] buf;
+			} else {
+				commitStage = COMMIT_INSTANCES;
 			}
-		}*/
-		else if (!strcmp(fourcc, "MWMO")) {
-			if (size) {
-				char* buf = new char[size];
-				f.read(buf, size);
-				char* p = buf;
-
-				while (p < buf + size) {
-					std::string path(p);
-
-					// Get plain name and fix it
-					char* s = GetPlainName(p);
-					fixnamen(s, strlen(s));
-					fixname2(s, strlen(s));
-
-					// Advance pointer past current string
-					p += strlen(p) + 1;
-
-					// Test if WMO file exists in MPQ
-					MPQFile test(path.c_str());
-					if (!test.isEof()) {
-						fixname(path);
-						gWorld->wmomanager.add(path);
-						wmos.push_back(path);
-						gLog("Adding WMO: %s\n", path.c_str());
-					}
-					else {
-						gLog("Skipping missing WMO: %s\n", path.c_str());
-					}
-					test.close();
-				}
-
-				delete[] buf;
+			break;
+		case COMMIT_INSTANCES:
+			for (size_t i=0; i<data->modelPlacements.size(); i++) {
+				const ModelPlacement &p = data->modelPlacements[i];
+				if (p.name < 0 || p.name >= (int)data->models.size()) continue;
+				Model *model = (Model*)gWorld->modelmanager.item(gWorld->modelmanager.get(AssetPath(data->models[p.name])));
+				modelis.push_back(ModelInstance(model, p));
 			}
-		}
-		else if (!strcmp(fourcc,"MDDF")) {
-			// model instance data
-			nMDX = (int)size / 36;
-			for (int i=0; i<nMDX; i++) {
-				int id;
-				f.read(&id, 4);
-				Model *model = (Model*)gWorld->modelmanager.items[gWorld->modelmanager.get(models[id])];
-				ModelInstance inst(model, f);
-				modelis.push_back(inst);
+			for (size_t i=0; i<data->wmoPlacements.size(); i++) {
+				const WMOPlacement &p = data->wmoPlacements[i];
+				if (p.name < 0 || p.name >= (int)data->wmos.size() || data->wmos[p.name].empty()) continue;
+				WMO *wmo = (WMO*)gWorld->wmomanager.item(gWorld->wmomanager.get(AssetPath(data->wmos[p.name])));
+				wmois.push_back(WMOInstance(wmo, p));
 			}
-		}
-		else if (!strcmp(fourcc,"MODF")) {
-			// wmo instance data
-			nWMO = (int)size / 64;
-			for (int i=0; i<nWMO; i++) {
-				int id;
-				f.read(&id, 4);
-				WMO *wmo = (WMO*)gWorld->wmomanager.items[gWorld->wmomanager.get(wmos[id])];
-				WMOInstance inst(wmo, f);
-				wmois.push_back(inst);
+			nMDX = (int)modelis.size();
+			nWMO = (int)wmois.size();
+			mem.object = modelis.size() * sizeof(ModelInstance) + wmois.size() * sizeof(WMOInstance);
+			commitStage = COMMIT_CHUNKS;
+			commitNext = 0;
+			break;
+		case COMMIT_CHUNKS:
+			if (commitNext < 256) {
+				int i = (int)(commitNext % 16), j = (int)(commitNext / 16);
+				chunks[j][i].init(this, data->chunks[j][i]);
+				heightfield.set(i, j, data->chunks[j][i]);
+				addChunkMemory(mem, data->chunks[j][i]);
+				commitNext++;
+			} else {
+				// init quadtree
+				topnode.setup(this);
+				delete data;
+				data = 0;
+				mem.pending = 0;
+				return true;
 			}
+			break;
 		}
 
-		// MCNK data will be processed separately ^_^
-
-		f.seek((int)nextpos);
-	}
-
-	// read individual map chunks
-	for (int j=0; j<16; j++) {
-		for (int i=0; i<16; i++) {
-			f.seek((int)mcnk_offsets[j*16+i]);
-			chunks[j][i].init(this, f);
-		}
+		if (budgetMs > 0 && std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+			return false;
 	}
-
-	// init quadtree
-	topnode.setup(this);
-
-	f.close();
+	return true;
 }
 
 MapTile::~MapTile()
 {
-	if (!ok) return;
+	release(0);
+}
 
-	gLog("Unloading tile %d,%d\n", x, z);
+bool MapTile::release(float budgetMs)
+{
+	if (!ok || releaseNext > 256) return true;
 
-	topnode.cleanup();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-	for (int j=0; j<16; j++) {
-		for (int i=0; i<16; i++) {
-			chunks[j][i].destroy();
+	if (releaseNext == 0) {
+		gLog("Unloading tile %d,%d\n", x, z);
+
+		// a tile dropped halfway through commit() has no quadtree yet, and
+		// only the chunks it got to hold GL objects
+		if (data) {
+			delete data;
+			data = 0;
 		}
+		else topnode.cleanup();
+	}
+
+	while (releaseNext < 256) {
+		chunks[releaseNext / 16][releaseNext % 16].destroy();
+		releaseNext++;
+		if (budgetMs > 0 && std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+			return false;
 	}
 
-	for (vector<string>::iterator it = textures.begin(); it != textures.end(); ++it) {
+	for (vector<AssetPath>::iterator it = textures.begin(); it != textures.end(); ++it) {
         video.textures.delbyname(*it);
 	}
 
-	for (vector<string>::iterator it = wmos.begin(); it != wmos.end(); ++it) {
+	for (vector<AssetPath>::iterator it = wmos.begin(); it != wmos.end(); ++it) {
 		gWorld->wmomanager.delbyname(*it);
 	}
 
-	for (vector<string>::iterator it = models.begin(); it != models.end(); ++it) {
+	for (vector<AssetPath>::iterator it = models.begin(); it != models.end(); ++it) {
 		gWorld->modelmanager.delbyname(*it);
 	}
+
+	releaseNext++;
+	mem.vertex = mem.texture = mem.object = mem.pending = 0;
+	return true;
 }
 
 void MapTile::draw()
@@ -238,7 +250,7 @@ void MapTile::draw()
 		}
 	}
 	
-	topnode.draw();
+	if (gWorld->frustum.intersects(topnode.vmin, topnode.vmax)) topnode.draw();
 
 }
 
@@ -287,8 +299,16 @@ void MapTile::drawModels()
 {
 	if (!ok) return;
 
+	if (modelbounds.size() != modelis.size()) {
+		modelbounds.clear();
+		for (size_t i=0; i<modelis.size(); i++) {
+			modelbounds.add(modelis[i].pos, modelis[i].model->rad * modelis[i].sc);
+		}
+	}
+	gWorld->frustum.cull(modelbounds);
+
 	for (int i=0; i<nMDX; i++) {
-		modelis[i].draw();
+		if (modelbounds.isVisible(i) && gWorld->occlusion.visibleSphere(modelis[i].pos, modelbounds.r[i])) modelis[i].draw();
 	}
 }
 
@@ -306,270 +326,53 @@ int indexMapBuf(int x, int y)
 	return ((y+1)/2)*9 + (y/2)*8 + x;
 }
 
-struct MapChunkHeader {
-	uint32 flags;
-	uint32 ix;
-	uint32 iy;
-	uint32 nLayers;
-	uint32 nDoodadRefs;
-	uint32 ofsHeight;
-	uint32 ofsNormal;
-	uint32 ofsLayer;
-	uint32 ofsRefs;
-	uint32 ofsAlpha;
-	uint32 sizeAlpha;
-	uint32 ofsShadow;
-	uint32 sizeShadow;
-	uint32 areaid;
-	uint32 nMapObjRefs;
-	uint32 holes;
-	uint16 s1;
-	uint16 s2;
-	uint32 d1;
-	uint32 d2;
-	uint32 d3;
-	uint32 predTex;
-	uint32 nEffectDoodad;
-	uint32 ofsSndEmitters;
-	uint32 nSndEmitters;
-	uint32 ofsLiquid;
-	uint32 sizeLiquid;
-	float  zpos;
-	float  xpos;
-	float  ypos;
-	uint32 textureId;
-	uint32 props;
-	uint32 effectId;
-};
-
-void MapChunk::init(MapTile* mt, MPQFile &f)
+void MapChunk::init(MapTile* mt, const ChunkData &d)
 {
-	Vec3D tn[mapbufsize], tv[mapbufsize];
-
-    f.seekRelative(4);
-	char fcc[5];
-	size_t size;
-	f.read(&size, 4);
-
-	// okay here we go ^_^
-	size_t lastpos = f.getPos() + size;
-
-	//char header[0x80];
-	MapChunkHeader header;
-	f.read(&header, 0x80);
-
-	areaID = header.areaid;
-	
-    zbase = header.zpos;
-    xbase = header.xpos;
-    ybase = header.ypos;
-
-	int holes = header.holes;
-	int chunkflags = header.flags;
-
-	hasholes = (holes != 0);
-
-	/*
-	if (hasholes) {
-		gLog("Holes: %d\n", holes);
-		int k=1;
-		for (int j=0; j<4; j++) {
-			for (int i=0; i<4; i++) {
-				gLog((holes & k)?"1":"0");
-				k <<= 1;
-			}
-			gLog("\n");
-		}
-	}
-	*/
-
-	// correct the x and z values ^_^
-	zbase = zbase*-1.0f + ZEROPOINT;
-	xbase = xbase*-1.0f + ZEROPOINT;
-
-	vmin = Vec3D( 9999999.0f, 9999999.0f, 9999999.0f);
-	vmax = Vec3D(-9999999.0f,-9999999.0f,-9999999.0f);
-	
-	while (f.getPos() < lastpos) {
-		f.read(fcc,4);
-		f.read(&size, 4);
-
-		flipcc(fcc);
-		fcc[4] = 0;
-
-		size_t nextpos = f.getPos() + size;
-
-		if (!strcmp(fcc,"MCNR")) {
-			nextpos = f.getPos() + 0x1C0; // size fix
-			// normal vectors
-			char nor[3];
-			Vec3D *ttn = tn;
-			for (int j=0; j<17; j++) {
-				for (int i=0; i<((j%2)?8:9); i++) {
-					f.read(nor,3);
-					// order Z,X,Y ?
-					//*ttn++ = Vec3D((float)nor[0]/127.0f, (float)nor[2]/127.0f, (float)nor[1]/127.0f);
-					*ttn++ = Vec3D(-(float)nor[1]/127.0f, (float)nor[2]/127.0f, -(float)nor[0]/127.0f);
-				}
-			}
-		}
-		else if (!strcmp(fcc,"MCVT")) {
-			Vec3D *ttv = tv;
-
-			// vertices
-			for (int j=0; j<17; j++) {
-				for (int i=0; i<((j%2)?8:9); i++) {
-					float h,xpos,zpos;
-					f.read(&h,4);
-					xpos = i * UNITSIZE;
-					zpos = j * 0.5f * UNITSIZE;
-					if (j%2) {
-                        xpos += UNITSIZE*0.5f;
-					}
-					Vec3D v = Vec3D(xbase+xpos, ybase+h, zbase+zpos);
-					*ttv++ = v;
-					if (v.y < vmin.y) vmin.y = v.y;
-					if (v.y > vmax.y) vmax.y = v.y;
-				}
-			}
-
-			vmin.x = xbase;
-			vmin.z = zbase;
-			vmax.x = xbase + 8 * UNITSIZE;
-			vmax.z = zbase + 8 * UNITSIZE;
-			r = (vmax - vmin).length() * 0.5f;
-
-		}
-		else if (!strcmp(fcc,"MCLY")) {
-			// texture info
-			nTextures = (int)size / 16;
-			//gLog("=\n");
-			for (int i=0; i<nTextures; i++) {
-				int tex, flags;
-				f.read(&tex,4);
-				f.read(&flags, 4);
-
-				f.seekRelative(8);
-
-				flags &= ~0x100;
-
-				if (flags & 0x80) {
-                    animated[i] = flags;
-				} else {
-					animated[i] = 0;
-				}
-
-				/*
-				if (flags != 0) {
-					gLog("Texture layer flags: %x ", flags);
-					int v = 0x80;
-					for (int i=0; i<8; i++,v>>=1) {
-						gLog("%c%s", (flags&v)?'1':'-', i==3?" ":"");
-					}
-
-					gLog(" %s\n", mt->textures[tex].c_str());
-				}
-				*/
-
-				/*
-				if (mt->textures[tex]=="Tileset\\BurningStepps\\BurningSteppsLavatest02.blp") {
-					gLog("Lava tex:\t%d\t%d\t%d\n", unk[0], unk[1], unk[2]);
-				} else {
-					gLog("---- tex:\t%d\t%d\t%d\n", unk[0], unk[1], unk[2]);
-				}
-				*/
-
-				textures[i] = video.textures.get(mt->textures[tex]);
-			}
-		}
-		else if (!strcmp(fcc,"MCSH")) {
-			// shadow map 64 x 64
-			unsigned char sbuf[64*64], *p, c[8];
-			p = sbuf;
-			for (int j=0; j<64; j++) {
-				f.read(c,8);
-				for (int i=0; i<8; i++) {
-					for (int b=0x01; b!=0x100; b<<=1) {
-						*p++ = (c[i] & b) ? 85 : 0;
-					}
-				}
-			}
-			glGenTextures(1, &shadow);
-			glBindTexture(GL_TEXTURE_2D, shadow);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, 64, 64, 0, GL_ALPHA, GL_UNSIGNED_BYTE, sbuf);
+	areaID = d.areaID;
+	xbase = d.xbase;
+	ybase = d.ybase;
+	zbase = d.zbase;
+	vmin = d.vmin;
+	vmax = d.vmax;
+	r = d.r;
+	hasholes = (d.holes != 0);
+
+	nTextures = d.nTextures;
+	for (int i=0; i<nTextures; i++) {
+		int tex = d.textures[i];
+		textures[i] = (tex >= 0 && tex < (int)mt->textures.size()) ? video.textures.get(mt->textures[tex]) : 0;
+		animated[i] = d.animated[i];
+	}
+
+	if (d.hasShadow) {
+		glGenTextures(1, &shadow);
+		glBindTexture(GL_TEXTURE_2D, shadow);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, 64, 64, 0, GL_ALPHA, GL_UNSIGNED_BYTE, d.shadow);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// alpha maps  64 x 64
+	if (nTextures > 1) {
+		glGenTextures(nTextures-1, alphamaps);
+		for (int i=0; i<nTextures-1; i++) {
+			glBindTexture(GL_TEXTURE_2D, alphamaps[i]);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, 64, 64, 0, GL_ALPHA, GL_UNSIGNED_BYTE, d.alphamaps[i]);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-		}
-		else if (!strcmp(fcc,"MCAL")) {
-			// alpha maps  64 x 64
-			if (nTextures>0) {
-				glGenTextures(nTextures-1, alphamaps);
-				for (int i=0; i<nTextures-1; i++) {
-					glBindTexture(GL_TEXTURE_2D, alphamaps[i]);
-					unsigned char amap[64*64], *p;
-					char *abuf = f.getPointer();
-					p = amap;
-					for (int j=0; j<64; j++) {
-						for (int i=0; i<32; i++) {
-							unsigned char c = *abuf++;
-							*p++ = (c & 0x0f) << 4;
-							*p++ = (c & 0xf0);
-						}
-
-					}
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_ALPHA, 64, 64, 0, GL_ALPHA, GL_UNSIGNED_BYTE, amap);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-					f.seekRelative(0x800);
-				}
-			} else {
-				// some MCAL chunks have incorrect sizes! :(
-                continue;
-			}
 		}
-		else if (!strcmp(fcc,"MCLQ")) {
-			// liquid / water level
-			char fcc1[5];
-			f.read(fcc1,4);
-			flipcc(fcc1);
-			fcc1[4]=0;
-			if (!strcmp(fcc1,"MCSE")) {
-				haswater = false;
-			}
-			else {
-				haswater = true;
-				f.seekRelative(-4);
-				f.read(&waterlevel,4);
-
-				if (waterlevel > vmax.y) vmax.y = waterlevel;
-				if (waterlevel < vmin.y) haswater = false;
-
-				f.seekRelative(4);
-
-				lq = new Liquid(8, 8, Vec3D(xbase, waterlevel, zbase));
-				//lq->init(f);
-				lq->initFromTerrain(f, chunkflags);
-
-				/*
-				// let's output some debug info! ( '-')b
-				string lq = "";
-				if (flags & 4) lq.append(" river");
-				if (flags & 8) lq.append(" ocean");
-				if (flags & 16) lq.append(" magma");
-				if (flags & 32) lq.append(" slime?");
-				gLog("LQ%s (base:%f)\n", lq.c_str(), waterlevel);
-				*/
+	}
 
-			}
-			// we're done here!
-			break;
-		}
-		f.seek((int)nextpos);
+	// liquid / water level
+	haswater = d.haswater;
+	waterlevel = d.waterlevel;
+	if (haswater) {
+		lq = new Liquid(8, 8, Vec3D(xbase, waterlevel, zbase));
+		lq->initFromTerrain(&d.liquid[0], d.flags);
 	}
 
 	// create vertex buffers
@@ -577,12 +380,12 @@ void MapChunk::init(MapTile* mt, MPQFile &f)
 	glGenBuffersARB(1,&normals);
 
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB, vertices);
-	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mapbufsize*3*sizeof(float), tv, GL_STATIC_DRAW_ARB);
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mapbufsize*3*sizeof(float), d.vertices, GL_STATIC_DRAW_ARB);
 
 	glBindBufferARB(GL_ARRAY_BUFFER_ARB, normals);
-	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mapbufsize*3*sizeof(float), tn, GL_STATIC_DRAW_ARB);
+	glBufferDataARB(GL_ARRAY_BUFFER_ARB, mapbufsize*3*sizeof(float), d.normals, GL_STATIC_DRAW_ARB);
 
-	if (hasholes) initStrip(holes);
+	if (hasholes) initStrip(d.holes);
 	/*
 	else {
 		strip = gWorld->mapstrip;
@@ -629,7 +432,7 @@ void MapChunk::initStrip(int holes)
 void MapChunk::destroy()
 {
 	// unload alpha maps
-	glDeleteTextures(nTextures - 1, alphamaps);
+	if (nTextures > 1) glDeleteTextures(nTextures - 1, alphamaps);
 	// shadow maps, too
 	glDeleteTextures(1, &shadow);
 
@@ -680,7 +483,6 @@ void MapChunk::drawPass(int anim)
 
 void MapChunk::draw()
 {
-	if (!gWorld->frustum.intersects(vmin,vmax)) return;
 	float mydist = (gWorld->camera - vcenter).length() - r;
 	//if (mydist > gWorld->mapdrawdistance2) return;
 	if (mydist > gWorld->culldistance) {
@@ -691,6 +493,10 @@ void MapChunk::draw()
 
 	if (nTextures==0) return;
 
+	for (int i=0; i<nTextures; i++) {
+		video.textures.use(textures[i], mydist);
+	}
+
 	if (!hasholes) {
 		bool highres = gWorld->drawhighres;
 		if (highres) {
@@ -872,7 +678,7 @@ void MapChunk::drawWater()
 		return;
 
 	try {
-		lq->draw();
+		lq->draw((gWorld->camera - vcenter).length() - r);
 	}
 	catch (...) {
 		// Silently fail if something goes wrong with water rendering
@@ -884,8 +690,10 @@ void MapChunk::drawWater()
 
 void MapNode::draw()
 {
-	if (!gWorld->frustum.intersects(vmin,vmax)) return;
-	for (int i=0; i<4; i++) children[i]->draw();
+	unsigned int in = gWorld->frustum.intersects4(childbounds, cullhint);
+	for (int i=0; i<4; i++) {
+		if (in & (1 << i)) children[i]->draw();
+	}
 }
 
 void MapNode::setup(MapTile *t)
@@ -916,7 +724,26 @@ void MapNode::setup(MapTile *t)
 		if (children[i]->vmax.x > vmax.x) vmax.x = children[i]->vmax.x;
 		if (children[i]->vmax.y > vmax.y) vmax.y = children[i]->vmax.y;
 		if (children[i]->vmax.z > vmax.z) vmax.z = children[i]->vmax.z;
+		childbounds.set(i, children[i]->vmin, children[i]->vmax);
+	}
+}
+
+bool MapNode::intersect(const Vec3D &o, const Vec3D &d, const Vec3D &invDir, float &t)
+{
+	float tnear = 0, tfar = t;
+	if (!rayBox(o, invDir, vmin, vmax, tnear, tfar)) return false;
+
+	if (size == 0) {
+		// a chunk, its triangles are in the tile's heightfield
+		int k = (int)((MapChunk*)this - &mt->chunks[0][0]);
+		return mt->heightfield.raycast(k % 16, k / 16, o, d, mt->xbase, mt->zbase, tnear, t);
+	}
+
+	bool hit = false;
+	for (int i=0; i<4; i++) {
+		if (children[i]->intersect(o, d, invDir, t)) hit = true;
 	}
+	return hit;
 }
 
 void MapNode::cleanup()
@@ -1,16 +1,14 @@
 #ifndef MAPTILE_H
 #define MAPTILE_H
 
-#define TILESIZE (533.33333f)
-#define CHUNKSIZE ((TILESIZE) / 16.0f)
-#define UNITSIZE (CHUNKSIZE / 8.0f)
-#define ZEROPOINT (32.0f * (TILESIZE))
-
+#include "tiledata.h"
 #include "video.h"
+#include "frustum.h"
 #include "mpq.h"
 #include "wmo.h"
 #include "model.h"
 #include "liquid.h"
+#include "heightfield.h"
 #include <vector>
 #include <string>
 
@@ -19,12 +17,10 @@ class MapChunk;
 
 class World;
 
-const int mapbufsize = 9*9 + 8*8;
-
 class MapNode {
 public:
 
-	MapNode(int x, int y, int s):px(x),py(y),size(s) {}
+	MapNode(int x, int y, int s):px(x),py(y),size(s),cullhint(0) {}
 
 	int px, py, size;
 
@@ -33,9 +29,17 @@ public:
 	MapNode *children[4];
 	MapTile *mt;
 
+	// the children's boxes, they are culled together
+	Boxes4 childbounds;
+	unsigned char cullhint;
+
+	// only called once the node is known to be in the frustum
 	virtual void draw();
 	void setup(MapTile *t);
 	void cleanup();
+	// first hit with the terrain under this node, down the quadtree
+	// through the boxes; t as for rayTriangle
+	bool intersect(const Vec3D &o, const Vec3D &d, const Vec3D &invDir, float &t);
 
 };
 
@@ -66,9 +70,10 @@ public:
 
 	Liquid *lq;
 
-	MapChunk():MapNode(0,0,0) {}
+	MapChunk():MapNode(0,0,0), nTextures(0), haswater(false), hasholes(false), shadow(0),
+		vertices(0), normals(0), strip(0), lq(0) {}
 
-	void init(MapTile* mt, MPQFile &f);
+	void init(MapTile* mt, const ChunkData &d);
 	void destroy();
 	void initStrip(int holes);
 
@@ -81,12 +86,15 @@ public:
 
 class MapTile {
 public:
-	std::vector<std::string> textures;
-	std::vector<std::string> wmos;
-	std::vector<std::string> models;
+	// interned once here, the managers and MPQFile reuse the hashes
+	std::vector<AssetPath> textures;
+	std::vector<AssetPath> wmos;
+	std::vector<AssetPath> models;
 
 	std::vector<WMOInstance> wmois;
 	std::vector<ModelInstance> modelis;
+	// bounding spheres of modelis, filled on the first draw
+	SphereList modelbounds;
 	int nWMO;
 	int nMDX;
 
@@ -101,9 +109,47 @@ public:
 
 	MapNode topnode;
 
+	// filled in as the chunks are committed
+	HeightField heightfield;
+
+	// loads the whole tile right away
 	MapTile(int x0, int z0, char* filename);
+	// takes over data; nothing is drawable until commit() returns true
+	MapTile(TileData *data);
 	~MapTile();
 
+	// Makes the GL objects and loads the textures, models and WMOs of a
+	// parsed tile, stopping once budgetMs have passed (0 = no limit).
+	// Returns true when the tile is complete.
+	bool commit(float budgetMs);
+	bool isReady() const { return data == 0; }
+
+	// per frame time World gives commit() and the release of dropped tiles
+	static float commitBudgetMs;
+
+	// Undoes commit() a step at a time, chunks first and then the
+	// references to shared textures, models and WMOs. Returns true when
+	// nothing is left; the destructor finishes whatever is not.
+	bool release(float budgetMs);
+
+	// What the tile holds on its own. Textures, models and WMOs are shared
+	// through the managers and budgeted there, only the instances count
+	struct Memory {
+		size_t vertex;	// VBOs, strips, liquid and the heightfield
+		size_t texture;	// alpha and shadow maps
+		size_t object;	// model and WMO instances
+		size_t pending;	// parsed data commit() hasn't got to
+		size_t total() const { return vertex + texture + object + pending; }
+	};
+	const Memory &memory() const { return mem; }
+
+	// the MTEX list of an ADT, without loading the tile
+	static void textureNames(const char *filename, std::vector<std::string> &names);
+	// MTEX, MMDX and MWMO lists, for the ones that are not NULL. Safe to
+	// call from worker threads
+	static void assetNames(const char *filename, std::vector<std::string> *textures,
+		std::vector<std::string> *models, std::vector<std::string> *wmos);
+
 	void draw();
 	void drawWater();
 	void drawObjects();
@@ -113,6 +159,20 @@ public:
 
 	/// Get chunk for sub offset x,z
 	MapChunk *getChunk(unsigned int x, unsigned int z);
+
+private:
+	enum { COMMIT_TEXTURES, COMMIT_MODELS, COMMIT_WMOS, COMMIT_INSTANCES, COMMIT_CHUNKS };
+
+	TileData *data;
+	// commit() progress: stage and the next item in it
+	int commitStage;
+	size_t commitNext;
+	// release() progress: chunks destroyed, 257 once the assets are let go
+	int releaseNext;
+
+	Memory mem;
+
+	void init(TileData *d);
 };
 
 int indexMapBuf(int x, int y);
@@ -1,11 +1,12 @@
 #include "model.h"
 #include "world.h"
+#include "raycast.h"
 #include <cassert>
 #include <algorithm>
 
 int globalTime = 0;
 
-Model::Model(std::string name, bool forceAnim) : ManagedItem(name), forceAnim(forceAnim)
+Model::Model(std::string name, bool forceAnim) : ManagedItem(name), forceAnim(forceAnim), texDist(0)
 {
 	// replace .MDX with .M2
 	char tempname[256];
@@ -22,7 +23,7 @@ Model::Model(std::string name, bool forceAnim) : ManagedItem(name), forceAnim(fo
 	ok = !f.isEof();
 
 	if (!ok) {
-		gLog("Error loading model [%s]\n", tempname);
+		gLogError("Error loading model [%s]\n", tempname);
 		return;
 	}
 
@@ -72,7 +73,7 @@ Model::~Model()
 		if (header.nTextures) {
 			for (size_t i=0; i<header.nTextures; i++) {
 				if (textures[i]!=0) {
-					//Texture *tex = (Texture*)video.textures.items[textures[i]];
+					//Texture *tex = (Texture*)video.textures.item(textures[i]);
 					video.textures.del(textures[i]);
 				}
 			}
@@ -238,8 +239,9 @@ void Model::initCommon(MPQFile &f)
 		normals = new Vec3D[header.nVertices];
 	}
 
-	//Vec3D vmin = Vec3D( 9999999.0f, 9999999.0f, 9999999.0f);
-	//Vec3D vmax = Vec3D(-9999999.0f,-9999999.0f,-9999999.0f);
+	rad = 0;
+	vmin = Vec3D( 9999999.0f, 9999999.0f, 9999999.0f);
+	vmax = Vec3D(-9999999.0f,-9999999.0f,-9999999.0f);
 	// vertices, normals
 	for (size_t i=0; i<header.nVertices; i++) {
 		origVertices[i].pos = fixCoordSystem(origVertices[i].pos);
@@ -254,14 +256,12 @@ void Model::initCommon(MPQFile &f)
 		if (len > rad){ 
 			rad = len;
 		}
-		/*
 		if (origVertices[i].pos.x < vmin.x) vmin.x = origVertices[i].pos.x;
 		if (origVertices[i].pos.y < vmin.y) vmin.y = origVertices[i].pos.y;
 		if (origVertices[i].pos.z < vmin.z) vmin.z = origVertices[i].pos.z;
 		if (origVertices[i].pos.x > vmax.x) vmax.x = origVertices[i].pos.x;
 		if (origVertices[i].pos.y > vmax.y) vmax.y = origVertices[i].pos.y;
 		if (origVertices[i].pos.z > vmax.z) vmax.z = origVertices[i].pos.z;
-		*/
 	}
 	rad = sqrtf(rad);
 	//rad = std::max(vmin.length(),vmax.length());
@@ -451,7 +451,10 @@ void Model::initCommon(MPQFile &f)
 
 void Model::initStatic(MPQFile &f)
 {
-	origVertices = (ModelVertex*)(f.getBuffer() + header.ofsVertices);
+	// initCommon fixes up the coordinate system in place, and the file buffer
+	// may be shared with other readers, so work on a copy
+	origVertices = new ModelVertex[header.nVertices];
+	memcpy(origVertices, f.getBuffer() + header.ofsVertices, header.nVertices * sizeof(ModelVertex));
 
 	initCommon(f);
 
@@ -466,6 +469,8 @@ void Model::initStatic(MPQFile &f)
 	delete[] vertices;
 	delete[] normals;
 	delete[] indices;
+	delete[] origVertices;
+	origVertices = 0;
 
 	if (colors) delete[] colors;
 	if (transparency) delete[] transparency;
@@ -1077,6 +1082,14 @@ void Bone::calcMatrix(Bone *allbones, int anim, int time)
 
 }
 
+void Model::useTextures(float dist)
+{
+	texDist = dist;
+	if (!HasTextures()) return;
+	for (size_t i=0; i<header.nTextures; i++) {
+		if (textures[i]) video.textures.use(textures[i], dist);
+	}
+}
 
 void Model::draw()
 {
@@ -1132,33 +1145,36 @@ void Model::updateEmitters(float dt)
 	}
 }
 
-int ModelManager::add(std::string name)
+int ModelManager::add(const std::string &name)
+{
+	return add(AssetPath(name));
+}
+
+int ModelManager::add(const AssetPath &path)
 {
 	int id;
-	if (names.find(name) != names.end()) {
-		id = names[name];
-		items[id]->addref();
+	if (addref(path, id)) {
 		return id;
 	}
 	// load new
-	Model *model = new Model(name);
+	Model *model = new Model(path.str());
 	id = nextID();
-    do_add(name, id, model);
+    do_add(path, id, model);
     return id;
 }
 
 void ModelManager::resetAnim()
 {
-	for (std::map<int, ManagedItem*>::iterator it = items.begin(); it != items.end(); ++it) {
-		((Model*)it->second)->animcalc = false;
-	}
+	forEach([](int, ManagedItem *item) {
+		((Model*)item)->animcalc = false;
+	});
 }
 
 void ModelManager::updateEmitters(float dt)
 {
-	for (std::map<int, ManagedItem*>::iterator it = items.begin(); it != items.end(); ++it) {
-		((Model*)it->second)->updateEmitters(dt);
-	}
+	forEach([dt](int, ManagedItem *item) {
+		((Model*)item)->updateEmitters(dt);
+	});
 }
 
 ModelInstance::ModelInstance(Model *m, MPQFile &f) : model (m)
@@ -1174,6 +1190,15 @@ ModelInstance::ModelInstance(Model *m, MPQFile &f) : model (m)
 	sc = scale / 1024.0f;
 }
 
+ModelInstance::ModelInstance(Model *m, const ModelPlacement &p) : model (m)
+{
+	d1 = p.d1;
+	pos = p.pos;
+	dir = p.dir;
+	scale = p.scale;
+	sc = scale / 1024.0f;
+}
+
 void ModelInstance::init2(Model *m, MPQFile &f)
 {
 	model = m;
@@ -1198,7 +1223,8 @@ void ModelInstance::draw()
 	//if ((pos - gWorld->camera).lengthSquared() > (gWorld->modeldrawdistance2+(model->rad*model->rad*sc))) return;
 	float dist = (pos - gWorld->camera).length() - model->rad;
 	if (dist > gWorld->modeldrawdistance) return;
-	if (!gWorld->frustum.intersectsSphere(pos, model->rad*sc)) return;
+
+	model->useTextures(dist);
 
 	glPushMatrix();
 	glTranslatef(pos.x, pos.y, pos.z);
@@ -1213,6 +1239,23 @@ void ModelInstance::draw()
 	glPopMatrix();
 }
 
+bool ModelInstance::intersect(const Vec3D &o, const Vec3D &d, float &t)
+{
+	if (!model->ok || model->vmin.x > model->vmax.x) return false;
+	if (!raySphere(o, d, pos, model->rad * sc, t)) return false;
+
+	// into model space; dividing both by the scale keeps t the same
+	Vec3D lo = unrotate(o - pos, dir) * (1.0f / sc);
+	Vec3D ld = unrotate(d, dir) * (1.0f / sc);
+	Vec3D inv(1.0f / ld.x, 1.0f / ld.y, 1.0f / ld.z);
+
+	float tnear = 0, tfar = t;
+	if (!rayBox(lo, inv, model->vmin, model->vmax, tnear, tfar)) return false;
+	// from inside the box it is the way out that counts
+	t = tnear > 0 ? tnear : tfar;
+	return true;
+}
+
 void glQuaternionRotate(const Vec3D& vdir, float w)
 {
 	Matrix m;
@@ -1226,7 +1269,8 @@ void ModelInstance::draw2(const Vec3D& ofs, const float rot)
 	Vec3D tpos(ofs + pos);
 	rotate(ofs.x,ofs.z,&tpos.x,&tpos.z,rot*PI/180.0f);
 	if ( (tpos - gWorld->camera).lengthSquared() > (gWorld->doodaddrawdistance2*model->rad*sc) ) return;
-	if (!gWorld->frustum.intersectsSphere(tpos, model->rad*sc)) return;
+
+	model->useTextures((tpos - gWorld->camera).length() - model->rad*sc);
 
 	glPushMatrix();
 
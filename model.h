@@ -9,6 +9,7 @@ Vec3D fixCoordSystem(Vec3D v);
 
 #include "manager.h"
 #include "mpq.h"
+#include "tiledata.h"
 #include "video.h"
 
 #include "modelheaders.h"
@@ -176,13 +177,18 @@ public:
 	bool ind;
 
 	float rad;
+	// box around the vertices at rest
+	Vec3D vmin, vmax;
 	float trans;
 	bool animcalc;
 	int anim, animtime;
+	// what the last useTextures() was given, for the emitters' textures
+	float texDist;
 
 	Model(std::string name, bool forceAnim=false);
 	~Model();
 	void draw();
+	void useTextures(float dist);
 	void updateEmitters(float dt);
 
 	friend struct ModelRenderPass;
@@ -190,7 +196,8 @@ public:
 
 class ModelManager: public SimpleManager {
 public:
-	int add(std::string name);
+	int add(const std::string &name);
+	int add(const AssetPath &path);
 
 	ModelManager() : v(0) {}
 
@@ -219,9 +226,12 @@ public:
 
 	ModelInstance() {}
 	ModelInstance(Model *m, MPQFile &f);
+	ModelInstance(Model *m, const ModelPlacement &p);
     void init2(Model *m, MPQFile &f);
 	void draw();
 	void draw2(const Vec3D& ofs, const float rot);
+	// ray against the model's box, placed like draw() does; t as for rayTriangle
+	bool intersect(const Vec3D &o, const Vec3D &d, float &t);
 
 };
 
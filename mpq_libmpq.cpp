@@ -18,41 +18,63 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 #include "mpq_libmpq.h"
 #include "wowmapview.h"
+#include "threadpool.h"
 #include <deque>
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
 #include <stdio.h>
 
 ArchiveSet gOpenArchives;
+bool MPQArchive::mapFiles = false;
+MPQIndex gMPQIndex;
+MPQCache gMPQCache(128 * 1024 * 1024);
+MPQDiskCache gMPQDiskCache;
+MPQCatalog gMPQCatalog;
 
-MPQArchive::MPQArchive(const char* filename)
+MPQArchive::MPQArchive(const char* filename):
+    filename(filename)
 {
     int result = libmpq__archive_open(&mpq_a, filename, -1);
-    printf("Opening %s\n", filename);
+    gLog("Opening %s\n", filename);
     if (result)
     {
         switch (result)
         {
             case LIBMPQ_ERROR_MALLOC:                   /* error on file operation */
-                printf("Error opening archive '%s': Run off free RAM memory\n", filename);
+                gLogError("Error opening archive '%s': Run off free RAM memory\n", filename);
                 break;
             case LIBMPQ_ERROR_OPEN:
-                printf("Error opening archive '%s': Can't open archive\n", filename);
+                gLogError("Error opening archive '%s': Can't open archive\n", filename);
                 break;
             case LIBMPQ_ERROR_SEEK:
-                printf("Error opening archive '%s': Can't seek begin of archive. File corrupt?\n", filename);
+                gLogError("Error opening archive '%s': Can't seek begin of archive. File corrupt?\n", filename);
                 break;
             case LIBMPQ_ERROR_FORMAT:
-                printf("Error opening archive '%s': Invalid MPQ format. File corrupt?\n", filename);
+                gLogError("Error opening archive '%s': Invalid MPQ format. File corrupt?\n", filename);
                 break;
             case LIBMPQ_ERROR_READ:
-                printf("Error opening archive '%s': Can't read MPQ file. File corrupt?\n", filename);
+                gLogError("Error opening archive '%s': Can't read MPQ file. File corrupt?\n", filename);
                 break;
         }
         return;
     }
+    if (mapFiles)
+    {
+        result = libmpq__archive_map(mpq_a);
+        if (result)
+            gLogNotice("Could not map archive '%s', reading it instead: %s\n", filename, libmpq__strerror(result));
+    }
     gOpenArchives.push_front(this);
 }
 
@@ -61,82 +83,764 @@ void MPQArchive::close()
     libmpq__archive_close(mpq_a);
 }
 
-void MPQArchive::ListFiles() {
-    vector<string> files;
-    GetFileListTo(files);
+void MPQIndex::build()
+{
+    entries.clear();
+
+    for (ArchiveSet::iterator i = gOpenArchives.begin(); i != gOpenArchives.end(); ++i)
+    {
+        mpq_archive* mpq_a = (*i)->mpq_a;
+
+        uint32 count;
+        libmpq__archive_hashes(mpq_a, &count);
+
+        for (uint32 h = 0; h < count; h++)
+        {
+            uint32 hash2, hash3, filenum;
+            if (libmpq__hash_entry(mpq_a, h, &hash2, &hash3, &filenum))
+                continue;
 
-    printf("Files in archive %p:\n", mpq_a);
-    for (const auto& file : files) {
-        printf("  %s\n", file.c_str());
+            Entry e;
+            e.archive = *i;
+            e.filenum = filenum;
+            // emplace keeps the first entry, i.e. the highest priority archive
+            entries.emplace(((uint64)hash2 << 32) | hash3, e);
+        }
     }
+
+    built = true;
+    gLog("MPQ index: %zu files in %zu archives\n", entries.size(), gOpenArchives.size());
 }
 
-MPQFile::MPQFile(const char* filename):
-    eof(false),
-    buffer(0),
-    pointer(0),
-    size(0)
+void MPQIndex::clear()
+{
+    entries.clear();
+    built = false;
+}
+
+const MPQIndex::Entry* MPQIndex::find(const char* filename) const
 {
-    printf("Attempting to open MPQ file: %s\n", filename);
+    uint32 hash1, hash2, hash3;
+    libmpq__file_hash(filename, &hash1, &hash2, &hash3);
+    return find(hash2, hash3);
+}
+
+const MPQIndex::Entry* MPQIndex::find(uint32 hash2, uint32 hash3) const
+{
+    std::unordered_map<uint64, Entry>::const_iterator it = entries.find(((uint64)hash2 << 32) | hash3);
+    if (it == entries.end())
+        return 0;
+    return &it->second;
+}
+
+MPQCache::MPQCache(size_t budget):
+    budget(budget),
+    bytes(0),
+    hits(0),
+    misses(0),
+    evictions(0)
+{
+}
+
+std::string MPQCache::normalize(const char* filename)
+{
+    std::string key(filename);
+    for (size_t i = 0; i < key.length(); i++)
+    {
+        if (key[i] == '/')
+            key[i] = '\\';
+        else
+            key[i] = toupper((unsigned char)key[i]);
+    }
+    return key;
+}
+
+bool MPQCache::find(const std::string& key, MPQBuffer& data, libmpq__off_t& size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::unordered_map<std::string, std::list<Entry>::iterator>::iterator it = entries.find(key);
+    if (it == entries.end())
+    {
+        misses++;
+        return false;
+    }
+
+    // move to the front of the LRU list
+    lru.splice(lru.begin(), lru, it->second);
+    data = it->second->data;
+    size = it->second->size;
+    hits++;
+    return true;
+}
+
+void MPQCache::insert(const std::string& key, const MPQBuffer& data, libmpq__off_t size)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // a file that would take a large part of the budget only thrashes the rest
+    if ((size_t)size > budget / 4 || entries.find(key) != entries.end())
+        return;
+
+    Entry e;
+    e.key = key;
+    e.data = data;
+    e.size = (size_t)size;
+    lru.push_front(e);
+    entries[key] = lru.begin();
+    bytes += e.size;
+
+    trim();
+}
+
+void MPQCache::trim()
+{
+    std::list<Entry>::iterator it = lru.end();
+    while (bytes > budget && it != lru.begin())
+    {
+        --it;
+        // still referenced by an open MPQFile, evicting would free nothing
+        if (it->data.use_count() > 1)
+            continue;
+
+        bytes -= it->size;
+        entries.erase(it->key);
+        it = lru.erase(it);
+        evictions++;
+    }
+}
+
+void MPQCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    entries.clear();
+    bytes = 0;
+}
+
+void MPQCache::setBudget(size_t newBudget)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = newBudget;
+    trim();
+}
+
+MPQCache::Stats MPQCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats st;
+    st.hits = hits;
+    st.misses = misses;
+    st.evictions = evictions;
+    st.bytes = bytes;
+    st.entries = entries.size();
+    return st;
+}
+
+MPQDiskCache::MPQDiskCache():
+    hits(0),
+    misses(0),
+    writes(0),
+    tempCounter(0)
+{
+}
+
+uint64 MPQDiskCache::fingerprint()
+{
+    // FNV-1a over name, size and mtime of every archive, in priority order
+    uint64 h = 14695981039346656037ULL;
+    auto mix = [&h](const void* p, size_t n)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            h ^= ((const unsigned char*)p)[i];
+            h *= 1099511628211ULL;
+        }
+    };
 
     for (ArchiveSet::iterator i = gOpenArchives.begin(); i != gOpenArchives.end(); ++i)
     {
-        mpq_archive* mpq_a = (*i)->mpq_a;
+        std::error_code ec;
+        uint64 fsize = (uint64)std::filesystem::file_size((*i)->filename, ec);
+        int64 mtime = (int64)std::filesystem::last_write_time((*i)->filename, ec).time_since_epoch().count();
+
+        mix((*i)->filename.c_str(), (*i)->filename.length() + 1);
+        mix(&fsize, sizeof(fsize));
+        mix(&mtime, sizeof(mtime));
+    }
+    return h;
+}
+
+bool MPQDiskCache::open(const std::string& dir)
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)fingerprint());
+
+    std::error_code ec;
+    std::filesystem::path base(dir);
+    std::filesystem::create_directories(base / name, ec);
+    if (ec)
+    {
+        gLogError("Disk cache: can't create %s: %s\n", (base / name).string().c_str(), ec.message().c_str());
+        return false;
+    }
+
+    // whatever was extracted from another set of archives is stale now;
+    // only touch directories that look like one of ours
+    for (std::filesystem::directory_iterator it(base, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::string other = it->path().filename().string();
+        if (!it->is_directory() || other.length() != 16 || other == name ||
+            other.find_first_not_of("0123456789abcdef") != std::string::npos)
+            continue;
+
+        gLog("Disk cache: removing stale %s\n", other.c_str());
+        std::error_code rmec;
+        std::filesystem::remove_all(it->path(), rmec);
+    }
+
+    root = (base / name).string();
+    gLog("Disk cache: %s\n", root.c_str());
+    return true;
+}
+
+void MPQDiskCache::close()
+{
+    root.clear();
+}
+
+std::string MPQDiskCache::path(const std::string& key) const
+{
+    // keys are normalized archive paths; refuse anything that could climb
+    // out of the cache directory
+    if (key.empty() || key.find("..") != std::string::npos || key.find(':') != std::string::npos)
+        return std::string();
+
+    std::string p = root;
+    p += '/';
+    for (size_t i = 0; i < key.length(); i++)
+        p += (key[i] == '\\') ? '/' : key[i];
+    return p;
+}
+
+bool MPQDiskCache::find(const std::string& key, MPQBuffer& data, libmpq__off_t& size)
+{
+    std::string file = path(key);
+    if (root.empty() || file.empty())
+        return false;
+
+#ifdef _WIN32
+    HANDLE fh = CreateFileA(file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fh == INVALID_HANDLE_VALUE)
+    {
+        misses++;
+        return false;
+    }
+
+    LARGE_INTEGER fsize;
+    HANDLE mh = NULL;
+    void* view = NULL;
+    if (GetFileSizeEx(fh, &fsize) && fsize.QuadPart > 0)
+        mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mh)
+        view = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+
+    // the view keeps the file mapped after both handles are gone
+    if (mh)
+        CloseHandle(mh);
+    CloseHandle(fh);
+
+    if (!view)
+    {
+        misses++;
+        return false;
+    }
 
+    data = MPQBuffer((char*)view, [](char* p) { UnmapViewOfFile(p); });
+    size = (libmpq__off_t)fsize.QuadPart;
+#else
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        misses++;
+        return false;
+    }
+
+    struct stat st;
+    void* view = MAP_FAILED;
+    if (!fstat(fd, &st) && st.st_size > 0)
+        view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+
+    if (view == MAP_FAILED)
+    {
+        misses++;
+        return false;
+    }
+
+    size_t length = (size_t)st.st_size;
+    data = MPQBuffer((char*)view, [length](char* p) { munmap(p, length); });
+    size = (libmpq__off_t)st.st_size;
+#endif
+
+    hits++;
+    return true;
+}
+
+void MPQDiskCache::store(const std::string& key, const MPQBuffer& data, libmpq__off_t size)
+{
+    std::string file = path(key);
+    if (root.empty() || file.empty() || (size < MIN_FILE_SIZE && key.compare(0, 9, "blpcache\\") != 0))
+        return;
+
+    // write under a temporary name and rename, so that a crash or a second
+    // thread storing the same file never leaves a truncated entry behind
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%llu.tmp", (unsigned long long)tempCounter++);
+    std::string temp = file + suffix;
+
+    gThreadPool.push([this, file, temp, data, size]
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+
+        {
+            std::ofstream out(temp.c_str(), std::ios::binary | std::ios::trunc);
+            if (!out.write(data.get(), size))
+            {
+                out.close();
+                std::filesystem::remove(temp, ec);
+                return;
+            }
+        }
+
+        std::filesystem::rename(temp, file, ec);
+        if (ec)
+            std::filesystem::remove(temp, ec);
+        else
+            writes++;
+    });
+}
+
+MPQDiskCache::Stats MPQDiskCache::getStats() const
+{
+    Stats st;
+    st.hits = hits;
+    st.misses = misses;
+    st.writes = writes;
+    return st;
+}
+
+namespace
+{
+    // names found in one archive's listfile, with the index keys to drop
+    // the ones a higher priority archive already listed
+    struct ListfileNames
+    {
+        std::vector<char> names;
+        std::vector<uint32> offsets;
+        std::vector<uint64> keys;
+    };
+
+    void parseListfile(mpq_archive_s* mpq_a, ListfileNames& out)
+    {
         uint32 filenum;
+        libmpq__off_t size = 0, transferred;
+        if (libmpq__file_number(mpq_a, "(listfile)", &filenum) ||
+            libmpq__file_size_unpacked(mpq_a, filenum, &size) || size <= 0)
+            return;
 
-        printf("Searching archive %p for file...\n", mpq_a);
+        std::vector<char> text((size_t)size);
+        if (libmpq__file_read(mpq_a, filenum, (unsigned char*)&text[0], size, &transferred))
+            return;
+        text.resize((size_t)transferred);
+
+        out.names.reserve(text.size() + 1);
 
-        if (libmpq__file_number(mpq_a, filename, &filenum))
+        // entries are separated by line breaks or, in some archives, by ';'
+        size_t start = 0;
+        for (size_t i = 0; i <= text.size(); i++)
         {
-            printf("File not found in this archive\n");
-            continue;
+            if (i < text.size() && text[i] != '\r' && text[i] != '\n' && text[i] != ';')
+                continue;
+
+            if (i > start)
+            {
+                out.offsets.push_back((uint32)out.names.size());
+                out.names.insert(out.names.end(), text.begin() + start, text.begin() + i);
+                out.names.push_back(0);
+
+                uint32 hash1, hash2, hash3;
+                libmpq__file_hash(&out.names[out.offsets.back()], &hash1, &hash2, &hash3);
+                out.keys.push_back(((uint64)hash2 << 32) | hash3);
+            }
+            start = i + 1;
         }
+    }
+}
 
-        libmpq__off_t transferred;
-        //libmpq__off_t size;
-        libmpq__file_size_unpacked(mpq_a, filenum, &size);
+void MPQCatalog::build()
+{
+    clear();
 
-        // HACK: in patch.mpq some files don't want to open and give 1 for filesize
-        if (size <= 1)
+    std::string file;
+    if (gMPQDiskCache.isOpen())
+    {
+        file = gMPQDiskCache.getRoot() + "/catalog.bin";
+        if (load(file))
         {
-            // printf("info: file %s has size %d; considered dummy file.\n", filename, size);
-            eof = true;
-            buffer = 0;
+            gLog("MPQ catalog: %zu files (cached)\n", offsets.size());
             return;
         }
-        buffer = new char[size];
+    }
+
+    std::vector<MPQArchive*> archives(gOpenArchives.begin(), gOpenArchives.end());
+    std::vector<ListfileNames> lists(archives.size());
+
+    gThreadPool.parallelFor(archives.size(), [&](size_t i)
+    {
+        parseListfile(archives[i]->mpq_a, lists[i]);
+    });
+
+    // merge in priority order
+    size_t total = 0;
+    for (size_t i = 0; i < lists.size(); i++)
+        total += lists[i].names.size();
+    names.reserve(total);
+
+    std::unordered_set<uint64> seen;
+    for (size_t i = 0; i < lists.size(); i++)
+    {
+        const ListfileNames& list = lists[i];
+        for (size_t n = 0; n < list.offsets.size(); n++)
+        {
+            if (!seen.insert(list.keys[n]).second)
+                continue;
+
+            const char* name = &list.names[list.offsets[n]];
+            offsets.push_back((uint32)names.size());
+            names.insert(names.end(), name, name + strlen(name) + 1);
+        }
+    }
+    names.shrink_to_fit();
 
-        //libmpq_file_getdata
-        libmpq__file_read(mpq_a, filenum, (unsigned char*)buffer, size, &transferred);
-        /*libmpq_file_getdata(&mpq_a, hash, fileno, (unsigned char*)buffer);*/
+    gLog("MPQ catalog: %zu files in %zu archives\n", offsets.size(), archives.size());
 
-        printf("Successfully read file. Size: %lu, Transferred: %lu\n", (unsigned long)size, (unsigned long)transferred);
+    if (!file.empty())
+        save(file);
+}
 
+void MPQCatalog::clear()
+{
+    names.clear();
+    offsets.clear();
+}
+
+bool MPQCatalog::load(const std::string& file)
+{
+    FILE* f = fopen(file.c_str(), "rb");
+    if (!f)
+        return false;
+
+    char magic[4];
+    uint32 count = 0, bytes = 0;
+    bool ok = fread(magic, 4, 1, f) == 1 && !memcmp(magic, "MCAT", 4) &&
+              fread(&count, sizeof(count), 1, f) == 1 &&
+              fread(&bytes, sizeof(bytes), 1, f) == 1;
+
+    if (ok)
+    {
+        offsets.resize(count);
+        names.resize(bytes);
+        ok = (!count || fread(&offsets[0], sizeof(uint32), count, f) == count) &&
+             (!bytes || fread(&names[0], 1, bytes, f) == bytes);
+    }
+    fclose(f);
+
+    // every offset has to start a string inside the table
+    for (size_t i = 0; ok && i < offsets.size(); i++)
+        ok = offsets[i] < bytes;
+    ok = ok && (!bytes || names[bytes - 1] == 0);
+
+    if (!ok)
+        clear();
+    return ok;
+}
+
+bool MPQCatalog::save(const std::string& file) const
+{
+    std::string temp = file + ".tmp";
+    FILE* f = fopen(temp.c_str(), "wb");
+    if (!f)
+        return false;
+
+    uint32 count = (uint32)offsets.size(), bytes = (uint32)names.size();
+    bool ok = fwrite("MCAT", 4, 1, f) == 1 &&
+              fwrite(&count, sizeof(count), 1, f) == 1 &&
+              fwrite(&bytes, sizeof(bytes), 1, f) == 1 &&
+              (!count || fwrite(&offsets[0], sizeof(uint32), count, f) == count) &&
+              (!bytes || fwrite(&names[0], 1, bytes, f) == bytes);
+    ok = !fclose(f) && ok;
+
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(temp, file, ec);
+    if (!ok || ec)
+    {
+        std::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+MPQFile::MPQFile(const char* filename, bool lazy):
+    eof(false),
+    buffer(0),
+    pointer(0),
+    size(0),
+    lazyArchive(0),
+    lazyFile(0),
+    sectorSize(0)
+{
+    uint32 hash1, hash2, hash3;
+    libmpq__file_hash(filename, &hash1, &hash2, &hash3);
+    init(filename, MPQCache::normalize(filename), hash1, hash2, hash3, lazy);
+}
+
+MPQFile::MPQFile(const AssetPath& path, bool lazy):
+    eof(false),
+    buffer(0),
+    pointer(0),
+    size(0),
+    lazyArchive(0),
+    lazyFile(0),
+    sectorSize(0)
+{
+    init(path.c_str(), path.key(), path.hash1(), path.hash2(), path.hash3(), lazy);
+}
+
+void MPQFile::init(const char* filename, const std::string& key, uint32 hash1, uint32 hash2, uint32 hash3, bool lazy)
+{
+    gLogDebug("Attempting to open MPQ file: %s\n", filename);
+
+    if (gMPQCache.find(key, data, size))
+    {
+        buffer = data.get();
+        return;
+    }
+
+    if (gMPQDiskCache.isOpen() && gMPQDiskCache.find(key, data, size))
+    {
+        buffer = data.get();
+        gMPQCache.insert(key, data, size);
         return;
+    }
 
+    if (gMPQIndex.isBuilt())
+    {
+        const MPQIndex::Entry* e = gMPQIndex.find(hash2, hash3);
+        if (e)
+        {
+            open(e->archive->mpq_a, e->filenum, key, lazy);
+            return;
+        }
+    }
+    else
+    {
+        for (ArchiveSet::iterator i = gOpenArchives.begin(); i != gOpenArchives.end(); ++i)
+        {
+            mpq_archive* mpq_a = (*i)->mpq_a;
+
+            uint32 filenum;
+
+            gLogDebug("Searching archive %p for file...\n", mpq_a);
+
+            if (libmpq__file_number_hash(mpq_a, hash1, hash2, hash3, &filenum))
+            {
+                gLogDebug("File not found in this archive\n");
+                continue;
+            }
+
+            open(mpq_a, filenum, key, lazy);
+            return;
+        }
     }
-    printf("Error: File %s not found in any open archive\n", filename);
+    gLog("Error: File %s not found in any open archive\n", filename);
     eof = true;
     buffer = 0;
 }
 
+void MPQFile::open(mpq_archive_s* mpq_a, uint32 filenum, const std::string& key, bool lazy)
+{
+    libmpq__off_t transferred;
+    libmpq__file_size_unpacked(mpq_a, filenum, &size);
+
+    // HACK: in patch.mpq some files don't want to open and give 1 for filesize
+    if (size <= 1)
+    {
+        // printf("info: file %s has size %d; considered dummy file.\n", filename, size);
+        eof = true;
+        buffer = 0;
+        return;
+    }
+    // stored files of a mapped archive need no copy at all
+    const uint8* mapped;
+    if (!libmpq__file_mapped(mpq_a, filenum, &mapped))
+    {
+        data = MPQBuffer((char*)mapped, [](char*) {});
+        buffer = data.get();
+        return;
+    }
+
+    data = MPQBuffer(new char[size], std::default_delete<char[]>());
+    buffer = data.get();
+
+    uint32 blocks = 0;
+    libmpq__file_blocks(mpq_a, filenum, &blocks);
+
+    // nothing to gain from streaming a file that is a single sector
+    if (lazy && blocks > 1 && !libmpq__block_open_offset(mpq_a, filenum))
+    {
+        libmpq__block_size_unpacked(mpq_a, filenum, 0, &sectorSize);
+        lazyArchive = mpq_a;
+        lazyFile = filenum;
+        sectorLoaded.assign(blocks, false);
+        cacheKey = key;
+        return;
+    }
+
+    int result;
+    if (blocks >= MIN_PARALLEL_SECTORS && gThreadPool.size() > 0)
+        result = readParallel(mpq_a, filenum, blocks, &transferred);
+    else
+        result = libmpq__file_read(mpq_a, filenum, (unsigned char*)buffer, size, &transferred);
+
+    //libmpq_file_getdata
+    if (!result)
+    {
+        gMPQCache.insert(key, data, size);
+        gMPQDiskCache.store(key, data, size);
+    }
+    /*libmpq_file_getdata(&mpq_a, hash, fileno, (unsigned char*)buffer);*/
+
+    gLogDebug("Successfully read file. Size: %lu, Transferred: %lu\n", (unsigned long)size, (unsigned long)transferred);
+}
+
+int MPQFile::readParallel(mpq_archive_s* mpq_a, uint32 filenum, uint32 blocks, libmpq__off_t* transferred)
+{
+    int result = libmpq__block_open_offset(mpq_a, filenum);
+    if (result)
+        return result;
+
+    // every sector but the last has the same size, so each one has a fixed
+    // slot in the output buffer
+    libmpq__off_t sectorBytes = 0;
+    libmpq__block_size_unpacked(mpq_a, filenum, 0, &sectorBytes);
+
+    std::atomic<int> error(0);
+    std::atomic<libmpq__off_t> total(0);
+
+    gThreadPool.parallelFor(blocks, [&](size_t i)
+    {
+        libmpq__off_t bytes = 0, done = 0;
+        libmpq__block_size_unpacked(mpq_a, filenum, (uint32)i, &bytes);
+        int r = libmpq__block_read(mpq_a, filenum, (uint32)i, (unsigned char*)buffer + i * sectorBytes, bytes, &done);
+        if (r)
+            error = r;
+        else
+            total += done;
+    });
+
+    libmpq__block_close_offset(mpq_a, filenum);
+
+    *transferred = total;
+    return error;
+}
+
+bool MPQFile::ensure(libmpq__off_t offset, libmpq__off_t bytes)
+{
+    if (!lazyArchive || bytes <= 0 || offset >= size)
+        return true;
+
+    uint32 first = (uint32)(offset / sectorSize);
+    uint32 last = (uint32)((std::min(offset + bytes, size) - 1) / sectorSize);
+
+    for (uint32 i = first; i <= last; i++)
+    {
+        if (sectorLoaded[i])
+            continue;
+
+        libmpq__off_t sectorBytes = 0, transferred;
+        libmpq__block_size_unpacked(lazyArchive, lazyFile, i, &sectorBytes);
+        int result = libmpq__block_read(lazyArchive, lazyFile, i, (unsigned char*)buffer + i * sectorSize, sectorBytes, &transferred);
+        if (result)
+        {
+            gLogError("MPQFile::ensure - Error reading sector %u of %s: %s\n", i, cacheKey.c_str(), libmpq__strerror(result));
+            return false;
+        }
+        sectorLoaded[i] = true;
+    }
+    return true;
+}
+
+bool MPQFile::exists(const char* filename)
+{
+    uint32 hash1, hash2, hash3;
+    libmpq__file_hash(filename, &hash1, &hash2, &hash3);
+    return exists(hash1, hash2, hash3);
+}
+
+bool MPQFile::exists(const AssetPath& path)
+{
+    return exists(path.hash1(), path.hash2(), path.hash3());
+}
+
+bool MPQFile::exists(uint32 hash1, uint32 hash2, uint32 hash3)
+{
+    mpq_archive* mpq_a = 0;
+    uint32 filenum;
+
+    if (gMPQIndex.isBuilt())
+    {
+        const MPQIndex::Entry* e = gMPQIndex.find(hash2, hash3);
+        if (!e)
+            return false;
+        mpq_a = e->archive->mpq_a;
+        filenum = e->filenum;
+    }
+    else
+    {
+        for (ArchiveSet::iterator i = gOpenArchives.begin(); i != gOpenArchives.end() && !mpq_a; ++i)
+        {
+            if (!libmpq__file_number_hash((*i)->mpq_a, hash1, hash2, hash3, &filenum))
+                mpq_a = (*i)->mpq_a;
+        }
+        if (!mpq_a)
+            return false;
+    }
+
+    // same rule as the constructor: files of size 0 or 1 are dummies
+    libmpq__off_t fsize;
+    libmpq__file_size_unpacked(mpq_a, filenum, &fsize);
+    return fsize > 1;
+}
+
 size_t MPQFile::read(void* dest, size_t bytes)
 {
     if (eof || !dest || !buffer || bytes == 0 || size == 0) {
-        gLog("MPQFile::read - Invalid state: eof=%d dest=%p buffer=%p bytes=%zu size=%zu\n",
+        gLogError("MPQFile::read - Invalid state: eof=%d dest=%p buffer=%p bytes=%zu size=%zu\n",
             eof, dest, buffer, bytes, size);
         return 0;
     }
 
 #ifdef _WIN32
     if (IsBadReadPtr(buffer, size)) {
-        gLog("MPQFile::read - Invalid buffer pointer %p for size %zu\n", buffer, size);
+        gLogError("MPQFile::read - Invalid buffer pointer %p for size %zu\n", buffer, size);
         eof = true;
         return 0;
     }
     if (IsBadWritePtr(dest, bytes)) {
-        gLog("MPQFile::read - Invalid destination pointer %p for size %zu\n", dest, bytes);
+        gLogError("MPQFile::read - Invalid destination pointer %p for size %zu\n", dest, bytes);
         return 0;
     }
 #endif
@@ -149,6 +853,11 @@ size_t MPQFile::read(void* dest, size_t bytes)
     size_t remaining = size - pointer;
     size_t bytesToRead = min(bytes, remaining);
 
+    if (!ensure(pointer, bytesToRead)) {
+        eof = true;
+        return 0;
+    }
+
     memcpy(dest, &buffer[pointer], bytesToRead);
     pointer += bytesToRead;
 
@@ -173,7 +882,19 @@ void MPQFile::seekRelative(int offset)
 
 void MPQFile::close()
 {
-    if (buffer) delete[] buffer;
+    if (lazyArchive)
+    {
+        // a streamed file that ended up fully read is as good as an eager one
+        if (std::find(sectorLoaded.begin(), sectorLoaded.end(), false) == sectorLoaded.end())
+        {
+            gMPQCache.insert(cacheKey, data, size);
+            gMPQDiskCache.store(cacheKey, data, size);
+        }
+        libmpq__block_close_offset(lazyArchive, lazyFile);
+        lazyArchive = 0;
+        sectorLoaded.clear();
+    }
+    data.reset();
     buffer = 0;
     eof = true;
 }
@@ -22,11 +22,18 @@
 
 #include "loadlib/loadlib.h"
 #include "libmpq/mpq.h"
+#include "assetpath.h"
 #include <string.h>
 #include <ctype.h>
 #include <vector>
 #include <iostream>
 #include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
 
 using namespace std;
 
@@ -35,10 +42,14 @@ class MPQArchive
 
     public:
         mpq_archive_s* mpq_a;
+        std::string filename;
+
+        // map archives into memory on open: stored files are then served in
+        // place and compressed sectors inflate straight from the mapping
+        static bool mapFiles;
 
         MPQArchive(const char* filename);
         void close();
-        void ListFiles();
 
         void GetFileListTo(vector<string>& filelist)
         {
@@ -71,25 +82,197 @@ class MPQArchive
 };
 typedef std::deque<MPQArchive*> ArchiveSet;
 
+// Maps the MPQ name hashes of every file in gOpenArchives to the archive
+// that serves it. Built once after all archives are open; archives earlier
+// in gOpenArchives (patches) shadow later ones, like the linear search does.
+class MPQIndex
+{
+    public:
+        struct Entry
+        {
+            MPQArchive* archive;
+            uint32 filenum;
+        };
+
+        MPQIndex() : built(false) {}
+
+        void build();
+        void clear();
+        bool isBuilt() const { return built; }
+        size_t size() const { return entries.size(); }
+
+        const Entry* find(const char* filename) const;
+        const Entry* find(uint32 hash2, uint32 hash3) const;
+
+    private:
+        std::unordered_map<uint64, Entry> entries;
+        bool built;
+};
+
+// Decompressed contents of one archive file. Shared between every MPQFile
+// that opened the same path, so treat it as read-only.
+typedef std::shared_ptr<char> MPQBuffer;
+
+// Byte-budgeted LRU of decompressed files keyed by normalized path. Buffers
+// still held by an MPQFile are never evicted; they stay cached until the last
+// reader closes them.
+class MPQCache
+{
+    public:
+        struct Stats
+        {
+            uint64 hits, misses, evictions;
+            size_t bytes, entries;
+        };
+
+        MPQCache(size_t budget);
+
+        bool find(const std::string& key, MPQBuffer& data, libmpq__off_t& size);
+        void insert(const std::string& key, const MPQBuffer& data, libmpq__off_t size);
+        void clear();
+
+        void setBudget(size_t bytes);
+        size_t getBudget() const { return budget; }
+        Stats getStats() const;
+
+        static std::string normalize(const char* filename);
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            MPQBuffer data;
+            size_t size;
+        };
+
+        void trim();
+
+        std::list<Entry> lru;    // most recently used first
+        std::unordered_map<std::string, std::list<Entry>::iterator> entries;
+        size_t budget, bytes;
+        uint64 hits, misses, evictions;
+        mutable std::mutex mutex;
+};
+
+// Decompressed files kept on disk between runs, one file per archive path
+// below a directory named after the fingerprint of gOpenArchives. Opening
+// with a different set of archives (or one that changed size or mtime)
+// starts over and deletes the entries of other fingerprints.
+class MPQDiskCache
+{
+    public:
+        struct Stats
+        {
+            uint64 hits, misses, writes;
+        };
+
+        // smaller files inflate faster than they can be opened and mapped;
+        // decoded textures (keys under blpcache\) are kept at any size,
+        // they save a decode rather than an inflate
+        enum { MIN_FILE_SIZE = 4096 };
+
+        MPQDiskCache();
+
+        // call once all archives are open
+        bool open(const std::string& dir);
+        void close();
+        bool isOpen() const { return !root.empty(); }
+
+        // hits are memory-mapped, the buffer is read-only
+        bool find(const std::string& key, MPQBuffer& data, libmpq__off_t& size);
+        // written on gThreadPool, data is kept alive until then
+        void store(const std::string& key, const MPQBuffer& data, libmpq__off_t size);
+
+        Stats getStats() const;
+        const std::string& getRoot() const { return root; }
+
+    private:
+        std::string path(const std::string& key) const;
+        static uint64 fingerprint();
+
+        std::string root;
+        std::atomic<uint64> hits, misses, writes, tempCounter;
+};
+
+// Every name listed in the (listfile)s of gOpenArchives, once, packed back
+// to back into a single string table. Listfiles are parsed in parallel; with
+// the disk cache open the table is saved next to the extracted files and
+// loaded from there as long as the archives stay the same. Built by what
+// walks the archives (-prebuildtextures), not at every startup.
+class MPQCatalog
+{
+    public:
+        MPQCatalog() {}
+
+        void build();
+        void clear();
+
+        size_t size() const { return offsets.size(); }
+        const char* name(size_t i) const { return &names[offsets[i]]; }
+
+    private:
+        bool load(const std::string& file);
+        bool save(const std::string& file) const;
+
+        std::vector<char> names;
+        std::vector<uint32> offsets;
+};
+
+extern ArchiveSet gOpenArchives;
+extern MPQIndex gMPQIndex;
+extern MPQCache gMPQCache;
+extern MPQDiskCache gMPQDiskCache;
+extern MPQCatalog gMPQCatalog;
+
 class MPQFile
 {
         //MPQHANDLE handle;
         bool eof;
         char* buffer;
+        MPQBuffer data;
         libmpq__off_t pointer, size;
 
+        // streaming mode: the block offset table stays open and sectors are
+        // decompressed into buffer the first time they are touched
+        mpq_archive_s* lazyArchive;
+        uint32 lazyFile;
+        libmpq__off_t sectorSize;
+        std::vector<bool> sectorLoaded;
+        std::string cacheKey;
+
         // disable copying
         MPQFile(const MPQFile& f) {}
         void operator=(const MPQFile& f) {}
 
+        // files with at least this many sectors are inflated on gThreadPool
+        enum { MIN_PARALLEL_SECTORS = 16 };
+
+        void init(const char* filename, const std::string& key, uint32 hash1, uint32 hash2, uint32 hash3, bool lazy);
+        void open(mpq_archive_s* mpq_a, uint32 filenum, const std::string& key, bool lazy);
+        static bool exists(uint32 hash1, uint32 hash2, uint32 hash3);
+        int readParallel(mpq_archive_s* mpq_a, uint32 filenum, uint32 blocks, libmpq__off_t* transferred);
+        bool ensure(libmpq__off_t offset, libmpq__off_t bytes);
+        char* fail() { eof = true; return 0; }
+
     public:
-        MPQFile(const char* filename);    // filenames are not case sensitive
+        // filenames are not case sensitive. A lazy file only decompresses the
+        // sectors that read() and getPointer() actually touch.
+        MPQFile(const char* filename, bool lazy = false);
+        // skips normalizing and hashing the name, both were done when the
+        // path was interned
+        MPQFile(const AssetPath& path, bool lazy = false);
+        static bool exists(const char* filename);
+        static bool exists(const AssetPath& path);
         ~MPQFile() { close(); }
         size_t read(void* dest, size_t bytes);
         size_t getSize() { return size; }
         size_t getPos() { return pointer; }
-        char* getBuffer() { return buffer; }
-        char* getPointer() { return buffer + pointer; }
+        // NULL (and eof) when a lazy file fails to read a sector it needs
+        char* getBuffer() { return ensure(0, size) ? buffer : fail(); }
+        // lazy files have no idea how far the caller will look, so this loads
+        // everything up to the end; use getPointer(bytes) when the size is known
+        char* getPointer() { return ensure(pointer, size - pointer) ? buffer + pointer : fail(); }
+        char* getPointer(size_t bytes) { return ensure(pointer, bytes) ? buffer + pointer : fail(); }
         bool isEof() { return eof; }
         void seek(int offset);
         void seekRelative(int offset);
@@ -312,7 +312,7 @@ void WorldBotNodes::DrawBox(const Vec3D& pos, float size, const Vec4D& color)
 bool WorldBotNodes::LoadNodeModel()
 {
     if (!gWorld) {
-        gLog("Error: gWorld not initialized\n");
+        gLogError("Error: gWorld not initialized\n");
         return false;
     }
 
@@ -363,7 +363,7 @@ bool WorldBotNodes::LoadNodeModel()
     delete nodeModel;
     nodeModel = nullptr;
 
-    gLog("Failed to load model: %s\n", altPath.c_str());
+    gLogError("Failed to load model: %s\n", altPath.c_str());
     return false;
 }
 
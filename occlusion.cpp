@@ -0,0 +1,242 @@
+#include "occlusion.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <cmath>
+
+OcclusionBuffer::OcclusionBuffer(): depth(WIDTH * HEIGHT, 0.0f), ready(false), tested(0), hidden(0)
+{
+	for (int w=WIDTH, h=HEIGHT; h > 0; w >>= 1, h >>= 1) {
+		levels.push_back(std::vector<float>(w * h, 0.0f));
+	}
+	for (int i=0; i<16; i++) viewproj[i] = (i % 5) == 0 ? 1.0f : 0.0f;
+}
+
+void OcclusionBuffer::begin(const float *m)
+{
+	for (int i=0; i<16; i++) viewproj[i] = m[i];
+	triangles.clear();
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	ready = false;
+	tested = hidden = 0;
+}
+
+void OcclusionBuffer::clear()
+{
+	triangles.clear();
+	ready = false;
+	tested = hidden = 0;
+}
+
+void OcclusionBuffer::addTriangles(const Vec3D *verts, size_t nverts, const unsigned short *tris, size_t ntris, const float *model)
+{
+	float m[16];
+	if (model) {
+		for (int c=0; c<4; c++) {
+			for (int r=0; r<4; r++) {
+				m[c*4 + r] = viewproj[r]*model[c*4] + viewproj[4 + r]*model[c*4 + 1]
+					+ viewproj[8 + r]*model[c*4 + 2] + viewproj[12 + r]*model[c*4 + 3];
+			}
+		}
+	} else {
+		for (int i=0; i<16; i++) m[i] = viewproj[i];
+	}
+
+	clip.resize(nverts * 4);
+	for (size_t i=0; i<nverts; i++) {
+		const Vec3D &v = verts[i];
+		for (int r=0; r<4; r++) clip[i*4 + r] = m[r]*v.x + m[4 + r]*v.y + m[8 + r]*v.z + m[12 + r];
+	}
+
+	for (size_t t=0; t<ntris; t++) {
+		if (tris[t*3] >= nverts || tris[t*3 + 1] >= nverts || tris[t*3 + 2] >= nverts) continue;
+		const float *a = &clip[tris[t*3] * 4];
+		const float *b = &clip[tris[t*3 + 1] * 4];
+		const float *c = &clip[tris[t*3 + 2] * 4];
+
+		// all three beyond the same side
+		if (a[0] < -a[3] && b[0] < -b[3] && c[0] < -c[3]) continue;
+		if (a[0] >  a[3] && b[0] >  b[3] && c[0] >  c[3]) continue;
+		if (a[1] < -a[3] && b[1] < -b[3] && c[1] < -c[3]) continue;
+		if (a[1] >  a[3] && b[1] >  b[3] && c[1] >  c[3]) continue;
+		if (a[2] >  a[3] && b[2] >  b[3] && c[2] >  c[3]) continue;
+
+		// the near plane is z = -w
+		int in = (a[2] + a[3] >= 0) + (b[2] + b[3] >= 0) + (c[2] + c[3] >= 0);
+		if (in == 3) addScreen(a, b, c);
+		else if (in > 0) addClipped(a, b, c);
+	}
+}
+
+void OcclusionBuffer::addClipped(const float *a, const float *b, const float *c)
+{
+	// what is left in front of the near plane, as a fan
+	const float *src[3] = {a, b, c};
+	float poly[4][4];
+	int n = 0;
+	for (int i=0; i<3; i++) {
+		const float *p = src[i], *q = src[(i + 1) % 3];
+		float dp = p[2] + p[3], dq = q[2] + q[3];
+		if (dp >= 0) {
+			for (int k=0; k<4; k++) poly[n][k] = p[k];
+			n++;
+		}
+		if ((dp >= 0) != (dq >= 0)) {
+			float s = dp / (dp - dq);
+			for (int k=0; k<4; k++) poly[n][k] = p[k] + (q[k] - p[k]) * s;
+			n++;
+		}
+	}
+	for (int i=2; i<n; i++) addScreen(poly[0], poly[i-1], poly[i]);
+}
+
+void OcclusionBuffer::addScreen(const float *a, const float *b, const float *c)
+{
+	const float *src[3] = {a, b, c};
+	Triangle t;
+	for (int i=0; i<3; i++) {
+		// on the near plane w is still positive
+		float iw = 1.0f / src[i][3];
+		t.x[i] = (src[i][0] * iw * 0.5f + 0.5f) * WIDTH;
+		t.y[i] = (src[i][1] * iw * 0.5f + 0.5f) * HEIGHT;
+		t.z[i] = iw;
+	}
+
+	// counter-clockwise on screen faces the camera; also drops NaNs
+	float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.y[1] - t.y[0]) * (t.x[2] - t.x[0]);
+	if (!(area > 0)) return;
+
+	triangles.push_back(t);
+}
+
+void OcclusionBuffer::finish()
+{
+	gThreadPool.parallelFor(BANDS, [this](size_t band) { rasterize((int)band); });
+	buildPyramid();
+	ready = true;
+}
+
+void OcclusionBuffer::rasterize(int band)
+{
+	int top = band * HEIGHT / BANDS, bottom = (band + 1) * HEIGHT / BANDS;
+
+	for (size_t i=0; i<triangles.size(); i++) {
+		const Triangle &t = triangles[i];
+		float miny = std::min(t.y[0], std::min(t.y[1], t.y[2]));
+		float maxy = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+		// rows whose pixel centres are inside
+		int y0 = std::max(top, (int)ceilf(std::max(miny - 0.5f, -1.0f)));
+		int y1 = std::min(bottom - 1, (int)floorf(std::min(maxy - 0.5f, (float)HEIGHT)));
+		if (y0 > y1) continue;
+
+		float minx = std::min(t.x[0], std::min(t.x[1], t.x[2]));
+		float maxx = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+		int x0 = std::max(0, (int)ceilf(std::max(minx - 0.5f, -1.0f)));
+		int x1 = std::min(WIDTH - 1, (int)floorf(std::min(maxx - 0.5f, (float)WIDTH)));
+		if (x0 > x1) continue;
+
+		float ax = t.x[0], ay = t.y[0];
+		float e1x = t.x[1] - ax, e1y = t.y[1] - ay;
+		float e2x = t.x[2] - ax, e2y = t.y[2] - ay;
+		float area = e1x * e2y - e1y * e2x;
+		float dzdx = ((t.z[1] - t.z[0]) * e2y - (t.z[2] - t.z[0]) * e1y) / area;
+		float dzdy = ((t.z[2] - t.z[0]) * e1x - (t.z[1] - t.z[0]) * e2x) / area;
+
+		for (int y=y0; y<=y1; y++) {
+			float *row = &depth[y * WIDTH];
+			float py = y + 0.5f;
+			for (int x=x0; x<=x1; x++) {
+				float px = x + 0.5f;
+				// inside when left of all three edges
+				float w0 = (t.x[1] - t.x[0]) * (py - t.y[0]) - (t.y[1] - t.y[0]) * (px - t.x[0]);
+				float w1 = (t.x[2] - t.x[1]) * (py - t.y[1]) - (t.y[2] - t.y[1]) * (px - t.x[1]);
+				float w2 = (t.x[0] - t.x[2]) * (py - t.y[2]) - (t.y[0] - t.y[2]) * (px - t.x[2]);
+				if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+				float z = t.z[0] + dzdx * (px - ax) + dzdy * (py - ay);
+				if (z > row[x]) row[x] = z;
+			}
+		}
+	}
+}
+
+void OcclusionBuffer::buildPyramid()
+{
+	// a pixel only counts as covered when its neighbours are too
+	std::vector<float> &base = levels[0];
+	for (int y=0; y<HEIGHT; y++) {
+		for (int x=0; x<WIDTH; x++) {
+			float z = depth[y * WIDTH + x];
+			if (x > 0) z = std::min(z, depth[y * WIDTH + x - 1]);
+			if (x < WIDTH - 1) z = std::min(z, depth[y * WIDTH + x + 1]);
+			if (y > 0) z = std::min(z, depth[(y - 1) * WIDTH + x]);
+			if (y < HEIGHT - 1) z = std::min(z, depth[(y + 1) * WIDTH + x]);
+			base[y * WIDTH + x] = z;
+		}
+	}
+
+	for (size_t k=1; k<levels.size(); k++) {
+		const std::vector<float> &src = levels[k-1];
+		std::vector<float> &dst = levels[k];
+		int w = WIDTH >> k, h = HEIGHT >> k, sw = w * 2;
+		for (int y=0; y<h; y++) {
+			for (int x=0; x<w; x++) {
+				const float *s = &src[y*2 * sw + x*2];
+				dst[y * w + x] = std::min(std::min(s[0], s[1]), std::min(s[sw], s[sw + 1]));
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::visible(const Vec3D &vmin, const Vec3D &vmax)
+{
+	tested++;
+	if (!ready) return true;
+
+	float minx = 1e30f, miny = 1e30f, maxx = -1e30f, maxy = -1e30f, nearest = 0;
+	const float *m = viewproj;
+	for (int i=0; i<8; i++) {
+		Vec3D v((i & 1) ? vmax.x : vmin.x, (i & 2) ? vmax.y : vmin.y, (i & 4) ? vmax.z : vmin.z);
+		float x = m[0]*v.x + m[4]*v.y + m[8]*v.z + m[12];
+		float y = m[1]*v.x + m[5]*v.y + m[9]*v.z + m[13];
+		float z = m[2]*v.x + m[6]*v.y + m[10]*v.z + m[14];
+		float w = m[3]*v.x + m[7]*v.y + m[11]*v.z + m[15];
+		// reaches past the near plane, there can be nothing in front
+		if (!(z + w > 0) || !(w > 0)) return true;
+		float iw = 1.0f / w;
+		float sx = (x * iw * 0.5f + 0.5f) * WIDTH, sy = (y * iw * 0.5f + 0.5f) * HEIGHT;
+		minx = std::min(minx, sx);
+		maxx = std::max(maxx, sx);
+		miny = std::min(miny, sy);
+		maxy = std::max(maxy, sy);
+		nearest = std::max(nearest, iw);
+	}
+	// off screen is for the frustum to decide
+	if (maxx < 0 || maxy < 0 || minx >= WIDTH || miny >= HEIGHT) return true;
+
+	int x0 = std::max(0, (int)floorf(minx)), x1 = std::min(WIDTH - 1, (int)floorf(maxx));
+	int y0 = std::max(0, (int)floorf(miny)), y1 = std::min(HEIGHT - 1, (int)floorf(maxy));
+
+	// the first level where the box covers at most 4x4 texels
+	size_t k = 0;
+	while (k + 1 < levels.size() && (((x1 >> k) - (x0 >> k)) > 3 || ((y1 >> k) - (y0 >> k)) > 3)) k++;
+
+	const std::vector<float> &level = levels[k];
+	int w = WIDTH >> k;
+	// a little slack for the rounding on either side
+	float limit = nearest * 1.0001f;
+	for (int y=y0>>k; y<=(y1>>k); y++) {
+		for (int x=x0>>k; x<=(x1>>k); x++) {
+			if (level[y * w + x] <= limit) return true;
+		}
+	}
+	hidden++;
+	return false;
+}
+
+OcclusionBuffer::Stats OcclusionBuffer::getStats() const
+{
+	Stats s;
+	s.triangles = triangles.size();
+	s.tested = tested;
+	s.hidden = hidden;
+	return s;
+}
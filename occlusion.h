@@ -0,0 +1,82 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "vec3d.h"
+#include <vector>
+
+// A small depth buffer of the big occluders in view, drawn on the CPU, so
+// that what is hidden behind them never gets to GL.
+//
+// Occluders go in as triangles between begin() and finish(); finish()
+// rasterizes them in horizontal bands on the thread pool and builds the
+// pyramid the tests read. The buffer holds 1/w, which is linear across a
+// triangle on screen, larger being nearer and 0 nothing at all. Each
+// pyramid level keeps the smallest, that is farthest, value of the four
+// below it, so a box whose nearest point is farther than that everywhere
+// it covers is hidden.
+//
+// Occluders must stay inside what is really drawn: back faces are
+// skipped like GL_CULL_FACE does, and level 0 is shrunk by a pixel
+// before the pyramid is built because pixels are only sampled in their
+// centres. Every pixel belongs to one band, so the result does not depend
+// on how the bands were scheduled. Nothing here touches GL.
+class OcclusionBuffer {
+public:
+	enum { WIDTH = 256, HEIGHT = 128, BANDS = 8 };
+
+	// since begin()
+	struct Stats {
+		size_t triangles;
+		unsigned int tested, hidden;
+	};
+
+	OcclusionBuffer();
+
+	// viewproj is projection * modelview, column major like GL's
+	void begin(const float *viewproj);
+	// Adds triangles, three indices into verts each, counter-clockwise
+	// seen from the front. model places verts in the world (column major,
+	// 0 when they are there already)
+	void addTriangles(const Vec3D *verts, size_t nverts, const unsigned short *tris, size_t ntris, const float *model = 0);
+	void finish();
+	// back to an empty buffer, everything is visible
+	void clear();
+
+	// false only when the box is certainly behind the occluders
+	bool visible(const Vec3D &vmin, const Vec3D &vmax);
+	bool visibleSphere(const Vec3D &c, float r)
+	{
+		return visible(c - Vec3D(r, r, r), c + Vec3D(r, r, r));
+	}
+
+	// level 0 as drawn, before the shrinking; for looking at it
+	const float *getDepth() const { return &depth[0]; }
+	// level k of the pyramid, (WIDTH >> k) x (HEIGHT >> k)
+	const float *getLevel(size_t k) const { return &levels[k][0]; }
+	size_t getLevelCount() const { return levels.size(); }
+	Stats getStats() const;
+
+private:
+	// a triangle on screen: x, y in pixels and 1/w, per vertex
+	struct Triangle {
+		float x[3], y[3], z[3];
+	};
+
+	float viewproj[16];
+	std::vector<Triangle> triangles;
+	std::vector<float> clip;
+
+	std::vector<float> depth;
+	// level k is (WIDTH >> k) x (HEIGHT >> k)
+	std::vector<std::vector<float> > levels;
+	bool ready;
+
+	unsigned int tested, hidden;
+
+	void addClipped(const float *a, const float *b, const float *c);
+	void addScreen(const float *a, const float *b, const float *c);
+	void rasterize(int band);
+	void buildPyramid();
+};
+
+#endif
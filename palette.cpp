@@ -0,0 +1,82 @@
+#include "palette.h"
+
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PALETTE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// alpha for pixel n of a 1, 4 or 8 bit alpha plane
+inline unsigned int alphaAt(const unsigned char *a, int alphabits, int n)
+{
+	switch (alphabits) {
+	case 8:
+		return a[n];
+	case 4:
+		return ((a[n>>1] >> ((n&1)*4)) & 0x0f) * 0x11;
+	case 1:
+		return (a[n>>3] & (1 << (n&7))) ? 0xff : 0;
+	}
+	return 0;
+}
+
+#ifdef PALETTE_SSE2
+// sixteen alpha bytes, in pixel order, for pixels n..n+15 (n a multiple of 16)
+inline __m128i alpha16(const unsigned char *a, int alphabits, int n)
+{
+	if (alphabits == 8)
+		return _mm_loadu_si128((const __m128i*)(a + n));
+
+	if (alphabits == 4) {
+		const __m128i low = _mm_set1_epi8(0x0f);
+		__m128i packed = _mm_loadl_epi64((const __m128i*)(a + n/2));
+		__m128i lo = _mm_and_si128(packed, low);
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(packed, 4), low);
+		__m128i nib = _mm_unpacklo_epi8(lo, hi);
+		return _mm_or_si128(nib, _mm_slli_epi16(nib, 4));
+	}
+
+	// 1 bit: eight copies of each byte, then test one bit per lane
+	const __m128i bits = _mm_setr_epi8(1,2,4,8,16,32,64,-128, 1,2,4,8,16,32,64,-128);
+	__m128i b = _mm_unpacklo_epi64(_mm_set1_epi8((char)a[n/8]), _mm_set1_epi8((char)a[n/8+1]));
+	return _mm_cmpeq_epi8(_mm_and_si128(b, bits), bits);
+}
+#endif
+
+}
+
+void expandPalette(const unsigned int *rgba, const unsigned char *idx, const unsigned char *a, int alphabits, int count, unsigned int *out)
+{
+	int n = 0;
+
+#ifdef PALETTE_SSE2
+	if (alphabits) {
+		const __m128i zero = _mm_setzero_si128();
+		for (; n+16 <= count; n += 16) {
+			unsigned int *p = out + n;
+			for (int i=0; i<16; i++)
+				p[i] = rgba[idx[n+i]];
+
+			// move every alpha byte to the top of its pixel
+			__m128i a8 = alpha16(a, alphabits, n);
+			__m128i a16lo = _mm_unpacklo_epi8(zero, a8);
+			__m128i a16hi = _mm_unpackhi_epi8(zero, a8);
+			__m128i *v = (__m128i*)p;
+			_mm_storeu_si128(v+0, _mm_or_si128(_mm_loadu_si128(v+0), _mm_unpacklo_epi16(zero, a16lo)));
+			_mm_storeu_si128(v+1, _mm_or_si128(_mm_loadu_si128(v+1), _mm_unpackhi_epi16(zero, a16lo)));
+			_mm_storeu_si128(v+2, _mm_or_si128(_mm_loadu_si128(v+2), _mm_unpacklo_epi16(zero, a16hi)));
+			_mm_storeu_si128(v+3, _mm_or_si128(_mm_loadu_si128(v+3), _mm_unpackhi_epi16(zero, a16hi)));
+		}
+	}
+#endif
+
+	if (!alphabits) {
+		for (; n<count; n++)
+			out[n] = rgba[idx[n]];
+		return;
+	}
+
+	for (; n<count; n++)
+		out[n] = rgba[idx[n]] | (alphaAt(a, alphabits, n) << 24);
+}
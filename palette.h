@@ -0,0 +1,9 @@
+#ifndef PALETTE_H
+#define PALETTE_H
+
+// Palette lookup plus alpha plane into RGBA8, for every pixel of a mip of
+// a palettized BLP. rgba is the palette already swizzled (opaque when
+// alphabits is 0); a is the 1, 4 or 8 bit alpha plane after the indices.
+void expandPalette(const unsigned int *rgba, const unsigned char *idx, const unsigned char *a, int alphabits, int count, unsigned int *out);
+
+#endif
@@ -220,6 +220,7 @@ void ParticleSystem::draw()
 	glDepthMask(GL_FALSE);
 
 	glBindTexture(GL_TEXTURE_2D, texture);
+	video.textures.use(texture, model->texDist);
 
 	Matrix mbb;
 	mbb.unit();
@@ -483,6 +484,7 @@ void RibbonEmitter::draw()
 	*/
 
 	glBindTexture(GL_TEXTURE_2D, texture);
+	video.textures.use(texture, model->texDist);
 	glEnable(GL_BLEND);
 	glDisable(GL_LIGHTING);
 	glDisable(GL_ALPHA_TEST);
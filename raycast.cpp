@@ -0,0 +1,198 @@
+#include "raycast.h"
+#include <algorithm>
+#include <cmath>
+#include <assert.h>
+
+using namespace std;
+
+static inline float axis(const Vec3D &v, int a)
+{
+	return a == 0 ? v.x : (a == 1 ? v.y : v.z);
+}
+
+bool rayBox(const Vec3D &o, const Vec3D &invDir, const Vec3D &bmin, const Vec3D &bmax, float &tnear, float &tfar)
+{
+	float t1 = (bmin.x - o.x) * invDir.x, t2 = (bmax.x - o.x) * invDir.x;
+	tnear = max(tnear, min(t1, t2));
+	tfar = min(tfar, max(t1, t2));
+	t1 = (bmin.y - o.y) * invDir.y;
+	t2 = (bmax.y - o.y) * invDir.y;
+	tnear = max(tnear, min(t1, t2));
+	tfar = min(tfar, max(t1, t2));
+	t1 = (bmin.z - o.z) * invDir.z;
+	t2 = (bmax.z - o.z) * invDir.z;
+	tnear = max(tnear, min(t1, t2));
+	tfar = min(tfar, max(t1, t2));
+	return tnear <= tfar;
+}
+
+bool rayTriangle(const Vec3D &o, const Vec3D &d, const Vec3D &a, const Vec3D &b, const Vec3D &c, float &t)
+{
+	// Moller-Trumbore
+	Vec3D e1 = b - a, e2 = c - a;
+	Vec3D p = d % e2;
+	float det = e1 * p;
+	if (fabsf(det) < 1e-12f) return false;
+	float inv = 1.0f / det;
+
+	Vec3D s = o - a;
+	float u = (s * p) * inv;
+	if (u < 0 || u > 1) return false;
+	Vec3D q = s % e1;
+	float v = (d * q) * inv;
+	if (v < 0 || u + v > 1) return false;
+
+	float th = (e2 * q) * inv;
+	if (th < 0 || th >= t) return false;
+	t = th;
+	return true;
+}
+
+bool raySphere(const Vec3D &o, const Vec3D &d, const Vec3D &c, float r, float tmax)
+{
+	float dd = d * d;
+	float t = dd > 0 ? ((c - o) * d) / dd : 0;
+	t = max(0.0f, min(tmax, t));
+	return (c - (o + d * t)).lengthSquared() <= r * r;
+}
+
+Vec3D unrotate(const Vec3D &v, const Vec3D &dir)
+{
+	const float deg = 3.14159265358f / 180.0f;
+	float s, c;
+
+	// glRotatef(dir.y - 90, 0,1,0) * glRotatef(-dir.x, 0,0,1) * glRotatef(dir.z, 1,0,0),
+	// taken back in reverse order
+	s = sinf((90.0f - dir.y) * deg);
+	c = cosf((90.0f - dir.y) * deg);
+	Vec3D r(v.x*c + v.z*s, v.y, -v.x*s + v.z*c);
+
+	s = sinf(dir.x * deg);
+	c = cosf(dir.x * deg);
+	r = Vec3D(r.x*c - r.y*s, r.x*s + r.y*c, r.z);
+
+	s = sinf(-dir.z * deg);
+	c = cosf(-dir.z * deg);
+	return Vec3D(r.x, r.y*c - r.z*s, r.y*s + r.z*c);
+}
+
+void TriangleBVH::assign(std::vector<Vec3D> &verts, std::vector<unsigned short> &tris)
+{
+	vertices.swap(verts);
+	indices.swap(tris);
+	nodes.clear();
+}
+
+void TriangleBVH::build()
+{
+	int n = (int)indices.size() / 3;
+	std::vector<int> order(n);
+	std::vector<Vec3D> centers(n);
+	for (int i=0; i<n; i++) {
+		order[i] = i;
+		centers[i] = (vertices[indices[i*3]] + vertices[indices[i*3+1]] + vertices[indices[i*3+2]]) * (1.0f / 3.0f);
+	}
+
+	nodes.reserve(n * 2);
+	Node root;
+	root.first = 0;
+	root.count = n;
+	nodes.push_back(root);
+	split(0, order, centers);
+
+	// leaves refer to runs of triangles
+	std::vector<unsigned short> sorted(indices.size());
+	for (int i=0; i<n; i++) {
+		for (int k=0; k<3; k++) sorted[i*3+k] = indices[order[i]*3+k];
+	}
+	indices.swap(sorted);
+}
+
+void TriangleBVH::split(int n, std::vector<int> &order, std::vector<Vec3D> &centers)
+{
+	int first = nodes[n].first, count = nodes[n].count;
+
+	Vec3D bmin( 9999999.0f, 9999999.0f, 9999999.0f);
+	Vec3D bmax(-9999999.0f,-9999999.0f,-9999999.0f);
+	Vec3D cmin = bmin, cmax = bmax;
+	for (int i=first; i<first+count; i++) {
+		for (int k=0; k<3; k++) {
+			const Vec3D &v = vertices[indices[order[i]*3+k]];
+			bmin = Vec3D(min(bmin.x, v.x), min(bmin.y, v.y), min(bmin.z, v.z));
+			bmax = Vec3D(max(bmax.x, v.x), max(bmax.y, v.y), max(bmax.z, v.z));
+		}
+		const Vec3D &c = centers[order[i]];
+		cmin = Vec3D(min(cmin.x, c.x), min(cmin.y, c.y), min(cmin.z, c.z));
+		cmax = Vec3D(max(cmax.x, c.x), max(cmax.y, c.y), max(cmax.z, c.z));
+	}
+	nodes[n].bmin = bmin;
+	nodes[n].bmax = bmax;
+	if (count <= 4) return;
+
+	// halve along the longest side of where the triangles are
+	Vec3D ext = cmax - cmin;
+	int a = (ext.x >= ext.y && ext.x >= ext.z) ? 0 : (ext.y >= ext.z ? 1 : 2);
+	int mid = first + count / 2;
+	std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count,
+		[&centers, a](int l, int r) { return axis(centers[l], a) < axis(centers[r], a); });
+
+	int left = (int)nodes.size();
+	Node child;
+	child.first = first;
+	child.count = mid - first;
+	nodes.push_back(child);
+	child.first = mid;
+	child.count = first + count - mid;
+	nodes.push_back(child);
+
+	nodes[n].first = left;
+	nodes[n].count = 0;
+	split(left, order, centers);
+	split(left + 1, order, centers);
+}
+
+bool TriangleBVH::intersect(const Vec3D &o, const Vec3D &d, float &t)
+{
+	if (indices.empty()) return false;
+	if (nodes.empty()) build();
+
+	Vec3D inv(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+	bool hit = false;
+
+	int stack[64], top = 0;
+	stack[top++] = 0;
+	while (top > 0) {
+		const Node &node = nodes[stack[--top]];
+		float tnear = 0, tfar = t;
+		if (!rayBox(o, inv, node.bmin, node.bmax, tnear, tfar)) continue;
+
+		if (node.count) {
+			for (int i=node.first; i<node.first+node.count; i++) {
+				if (rayTriangle(o, d, vertices[indices[i*3]], vertices[indices[i*3+1]], vertices[indices[i*3+2]], t))
+					hit = true;
+			}
+		} else {
+			// halving leaves of 4 out of at most 65536/3 triangles is far
+			// shallower than this; dropping nodes would miss hits
+			assert(top < 62);
+			// the nearer child goes on top
+			float n0 = 0, f0 = t, n1 = 0, f1 = t;
+			bool h0 = rayBox(o, inv, nodes[node.first].bmin, nodes[node.first].bmax, n0, f0);
+			bool h1 = rayBox(o, inv, nodes[node.first+1].bmin, nodes[node.first+1].bmax, n1, f1);
+			int c0 = node.first, c1 = node.first + 1;
+			if (h0 && h1 && n1 < n0) {
+				stack[top++] = c0;
+				stack[top++] = c1;
+			} else {
+				if (h1) stack[top++] = c1;
+				if (h0) stack[top++] = c0;
+			}
+		}
+	}
+	return hit;
+}
+
+size_t TriangleBVH::memory() const
+{
+	return vertices.capacity() * sizeof(Vec3D) + indices.capacity() * sizeof(unsigned short) + nodes.capacity() * sizeof(Node);
+}
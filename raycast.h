@@ -0,0 +1,72 @@
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include "vec3d.h"
+#include <vector>
+
+class MapTile;
+class WMOInstance;
+class ModelInstance;
+
+// What World::raycast() hit first
+struct RayHit {
+	enum Kind { NONE, TERRAIN, WMO, MODEL };
+
+	Kind kind;
+	float t;
+	Vec3D point;
+
+	MapTile *tile;
+	WMOInstance *wmo;
+	ModelInstance *model;
+
+	RayHit(): kind(NONE), t(0), tile(0), wmo(0), model(0) {}
+};
+
+// Slab test against a box; tnear and tfar come in as the range to look
+// in and go out clipped to the box
+bool rayBox(const Vec3D &o, const Vec3D &invDir, const Vec3D &bmin, const Vec3D &bmax, float &tnear, float &tfar);
+
+// Both sides count. t comes in as the farthest hit wanted and is replaced
+// when the triangle is closer
+bool rayTriangle(const Vec3D &o, const Vec3D &d, const Vec3D &a, const Vec3D &b, const Vec3D &c, float &t);
+
+// Whether o + d*t for t in [0, tmax] comes within r of c; a cheap first
+// check before anything is transformed
+bool raySphere(const Vec3D &o, const Vec3D &d, const Vec3D &c, float r, float tmax);
+
+// Undoes the rotations WMOInstance::draw and ModelInstance::draw apply
+// for the MODF/MDDF angles in dir
+Vec3D unrotate(const Vec3D &v, const Vec3D &dir);
+
+// Bounding volume hierarchy over an indexed triangle list, for rays into
+// static geometry. The tree is built the first time it is asked, so
+// geometry nobody picks costs only its copy.
+class TriangleBVH {
+	struct Node {
+		Vec3D bmin, bmax;
+		// leaves: their triangles; inner nodes: count is 0 and the
+		// children are at first and first+1
+		int first, count;
+	};
+
+	std::vector<Vec3D> vertices;
+	std::vector<unsigned short> indices;
+	std::vector<Node> nodes;
+
+	void build();
+	void split(int n, std::vector<int> &order, std::vector<Vec3D> &centers);
+
+public:
+	// takes over the contents of both
+	void assign(std::vector<Vec3D> &verts, std::vector<unsigned short> &tris);
+
+	// t as for rayTriangle
+	bool intersect(const Vec3D &o, const Vec3D &d, float &t);
+
+	bool empty() const { return indices.empty(); }
+	const std::vector<Vec3D> &getVertices() const { return vertices; }
+	size_t memory() const;
+};
+
+#endif
@@ -76,7 +76,7 @@ Shader::Shader(GLenum target, const char *program, bool fromFile):id(0),target(t
 	if (glGetError() != 0) {
 		int errpos;
 		glGetIntegerv(GL_PROGRAM_ERROR_POSITION_ARB, &errpos);
-		gLog("Error loading shader: %s\nError position: %d\n", glGetString(GL_PROGRAM_ERROR_STRING_ARB), errpos);
+		gLogError("Error loading shader: %s\nError position: %d\n", glGetString(GL_PROGRAM_ERROR_STRING_ARB), errpos);
 		ok = false;
 	} else ok = true;
 
@@ -26,11 +26,11 @@ Test::Test(World *w, float ah0, float av0): world(w), ah(ah0), av(av0), guiManag
 	// Initialize GUI
 	SDL_Surface* screen = SDL_GetVideoSurface();
 	if (!screen) {
-		gLog("Error: Could not get video surface for GUI initialization\n");
+		gLogError("Error: Could not get video surface for GUI initialization\n");
 		return;
 	}
 	if (!guiManager.Init(screen)) {
-		gLog("Error: Failed to initialize GUI manager\n");
+		gLogError("Error: Failed to initialize GUI manager\n");
 		return;
 	}
 
@@ -0,0 +1,118 @@
+// Milliseconds per tile for TileData::parse and for the parse it replaced,
+// which read every value through MPQFile::read, on the ADT of
+// tiledata_test, with the file in the MPQ cache and without. Both must
+// give the same TileData, bit for bit.
+// usage: adt_bench [repeats]
+#include "check.h"
+#include "adtwriter.h"
+#include "mpqwriter.h"
+#include "baseline/baseline.h"
+#include "tiledata.h"
+#include "mpq.h"
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+const char *adtName = "World\\Maps\\Test\\Test_30_31.adt";
+
+bool sameChunk(const ChunkData &a, const ChunkData &b)
+{
+	bool same = a.areaID == b.areaID && a.flags == b.flags && a.holes == b.holes &&
+		memcmp(&a.xbase, &b.xbase, 4) == 0 && memcmp(&a.ybase, &b.ybase, 4) == 0 && memcmp(&a.zbase, &b.zbase, 4) == 0 &&
+		memcmp(&a.vmin, &b.vmin, sizeof(Vec3D)) == 0 && memcmp(&a.vmax, &b.vmax, sizeof(Vec3D)) == 0 && memcmp(&a.r, &b.r, 4) == 0 &&
+		memcmp(a.vertices, b.vertices, sizeof(a.vertices)) == 0 && memcmp(a.normals, b.normals, sizeof(a.normals)) == 0;
+	same = same && a.nTextures == b.nTextures &&
+		memcmp(a.textures, b.textures, a.nTextures * sizeof(int)) == 0 && memcmp(a.animated, b.animated, a.nTextures * sizeof(int)) == 0;
+	same = same && a.hasShadow == b.hasShadow && (!a.hasShadow || memcmp(a.shadow, b.shadow, sizeof(a.shadow)) == 0);
+	for (int k=0; same && k<a.nTextures-1; k++) same = memcmp(a.alphamaps[k], b.alphamaps[k], sizeof(a.alphamaps[k])) == 0;
+	same = same && a.haswater == b.haswater && memcmp(&a.waterlevel, &b.waterlevel, 4) == 0 && a.liquid == b.liquid;
+	return same;
+}
+
+bool samePlacements(const TileData &a, const TileData &b)
+{
+	if (a.modelPlacements.size() != b.modelPlacements.size() || a.wmoPlacements.size() != b.wmoPlacements.size()) return false;
+	for (size_t k=0; k<a.modelPlacements.size(); k++) {
+		const ModelPlacement &p = a.modelPlacements[k], &q = b.modelPlacements[k];
+		if (p.name != q.name || p.d1 != q.d1 || p.scale != q.scale ||
+			memcmp(&p.pos, &q.pos, sizeof(Vec3D)) != 0 || memcmp(&p.dir, &q.dir, sizeof(Vec3D)) != 0) return false;
+	}
+	for (size_t k=0; k<a.wmoPlacements.size(); k++) {
+		const WMOPlacement &p = a.wmoPlacements[k], &q = b.wmoPlacements[k];
+		if (p.name != q.name || p.id != q.id || p.d2 != q.d2 || p.d3 != q.d3 ||
+			memcmp(&p.pos, &q.pos, sizeof(Vec3D)) != 0 || memcmp(&p.dir, &q.dir, sizeof(Vec3D)) != 0 ||
+			memcmp(&p.pos2, &q.pos2, sizeof(Vec3D)) != 0 || memcmp(&p.pos3, &q.pos3, sizeof(Vec3D)) != 0) return false;
+	}
+	return true;
+}
+
+// parse() appends to the lists, so they are emptied between runs
+void reset(TileData &d)
+{
+	d.textures.clear();
+	d.models.clear();
+	d.wmos.clear();
+	d.modelPlacements.clear();
+	d.wmoPlacements.clear();
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 300;
+
+	static ExpectedChunk expected[256];
+	MPQWriter w;
+	w.add(adtName, makeAdt(expected));
+	w.add("World\\wmo\\Azeroth\\House.wmo", std::vector<unsigned char>(64, 'x'));
+	CHECK(w.write("adt_bench.mpq"));
+
+	{
+		MPQArchive archive("adt_bench.mpq");
+		gMPQIndex.build();
+
+		TileData *before = new TileData, *after = new TileData;
+		CHECK(baseline_parseTile(*before, 30, 31, adtName));
+		CHECK(after->parse(30, 31, adtName));
+		CHECK(before->textures == after->textures && before->models == after->models && before->wmos == after->wmos);
+		CHECK(samePlacements(*before, *after));
+		int differ = 0;
+		for (int j=0; j<16; j++) {
+			for (int i=0; i<16; i++) {
+				if (!sameChunk(before->chunks[j][i], after->chunks[j][i])) differ++;
+			}
+		}
+		CHECK(differ == 0);
+
+		// from the MPQ cache, the parse alone, then decompressing the file every time
+		size_t budget = gMPQCache.getBudget();
+		for (int cached=1; cached>=0; cached--) {
+			gMPQCache.setBudget(cached ? budget : 0);
+			double t0 = nowMs();
+			for (int r=0; r<repeats; r++) {
+				reset(*before);
+				baseline_parseTile(*before, 30, 31, adtName);
+			}
+			double t1 = nowMs();
+			for (int r=0; r<repeats; r++) {
+				reset(*after);
+				after->parse(30, 31, adtName);
+			}
+			double t2 = nowMs();
+			printf("%-12s MPQFile::read %.3f ms per tile, in place %.3f ms per tile\n", cached ? "cached:" : "not cached:",
+				(t1 - t0) / repeats, (t2 - t1) / repeats);
+		}
+
+		delete before;
+		delete after;
+
+		gMPQIndex.clear();
+		archive.close();
+		gOpenArchives.clear();
+	}
+	remove("adt_bench.mpq");
+
+	return checkFailures() != 0;
+}
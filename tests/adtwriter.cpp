@@ -0,0 +1,150 @@
+#include "adtwriter.h"
+#include "check.h"
+
+namespace {
+
+Bytes makeChunk(int i, int j, ExpectedChunk &e, TestRandom &rnd)
+{
+	int n = j*16 + i;
+	Bytes sub, d;
+
+	for (int k=0; k<mapbufsize; k++) {
+		e.heights[k] = rnd.uniform(-50, 150);
+		d.f32(e.heights[k]);
+	}
+	sub.chunk("MCVT", d);
+
+	// the size leaves out the 13 bytes of padding
+	d.clear();
+	for (int k=0; k<mapbufsize*3; k++) {
+		e.normals[k] = (signed char)rnd.next();
+		d.push_back((unsigned char)e.normals[k]);
+	}
+	d.resize(d.size() + 13);
+	sub.id("MCNR");
+	sub.u32(435);
+	sub.put(&d[0], d.size());
+
+	d.clear();
+	unsigned int layers[8] = {0, 0, 0, 0, 1, 0x80|0x100|3, 0, 0};
+	d.put(layers, sizeof(layers));
+	sub.chunk("MCLY", d);
+
+	d.clear();
+	for (int k=0; k<512; k++) d.push_back(e.shadow[k] = (unsigned char)rnd.next());
+	sub.chunk("MCSH", d);
+
+	d.clear();
+	for (int k=0; k<0x800; k++) d.push_back(e.alpha[k] = (unsigned char)rnd.next());
+	sub.chunk("MCAL", d);
+
+	e.water = n == 5;
+	d.clear();
+	if (e.water) {
+		d.f32(-10.0f);
+		d.f32(200.0f);
+		for (int k=0; k<81; k++) {
+			d.u32(0);
+			d.f32(1.0f + k);
+		}
+		for (int k=0; k<64; k++) d.push_back((unsigned char)(k % 16));
+		sub.chunk("MCLQ", d);
+	} else {
+		sub.chunk("MCLQ", d);
+		sub.chunk("MCSE", d);
+	}
+
+	Bytes h;
+	unsigned int fields[16] = {e.water ? 4u : 0u, (unsigned int)i, (unsigned int)j, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+		100u + n, 0, n == 3 ? 0x1111u : 0u};
+	h.put(fields, sizeof(fields));
+	h.u16(0);
+	h.u16(0);
+	for (int k=0; k<9; k++) h.u32(0);
+	h.f32(17066.66f - j * 33.3333f);
+	h.f32(17066.66f - i * 33.3333f);
+	h.f32((float)n);
+	for (int k=0; k<3; k++) h.u32(0);
+	CHECK(h.size() == 0x80);
+
+	h.put(&sub[0], sub.size());
+	Bytes c;
+	c.chunk("MCNK", h);
+	return c;
+}
+
+}
+
+Bytes makeAdt(ExpectedChunk *expected)
+{
+	TestRandom rnd(7);
+	std::vector<Bytes> mcnks;
+	for (int j=0; j<16; j++) {
+		for (int i=0; i<16; i++) {
+			mcnks.push_back(makeChunk(i, j, expected[j*16 + i], rnd));
+		}
+	}
+
+	const char *tex[] = {"TILESET\\ELWYNN\\ELWYNNGRASS.BLP", "Tileset\\Elwynn\\ElwynnDirt.blp"};
+	const char *mdx[] = {"World\\Azeroth\\Tree.mdx"};
+	const char *wmo[] = {"World\\wmo\\Azeroth\\House.wmo", "World\\wmo\\Missing.wmo"};
+
+	Bytes top, d;
+	d.u32(18);
+	top.chunk("MVER", d);
+	d.assign(64, 0);
+	top.chunk("MHDR", d);
+
+	Bytes pre;
+	d.clear();
+	d.names(tex, 2);
+	pre.chunk("MTEX", d);
+	d.clear();
+	d.names(mdx, 1);
+	pre.chunk("MMDX", d);
+	d.clear();
+	d.u32(0);
+	pre.chunk("MMID", d);
+	d.clear();
+	d.names(wmo, 2);
+	pre.chunk("MWMO", d);
+	d.clear();
+	d.u32(0);
+	d.u32(0);
+	pre.chunk("MWID", d);
+
+	d.clear();
+	d.u32(0);
+	d.u32(7);
+	for (int k=1; k<=6; k++) d.f32((float)k);
+	d.u32(2048);
+	pre.chunk("MDDF", d);
+
+	d.clear();
+	float modf0[12] = {10, 20, 30, 0, 0, 0, 1, 1, 1, 2, 2, 2};
+	d.u32(0);
+	d.u32(9);
+	d.put(modf0, sizeof(modf0));
+	d.u32(0x30000);
+	d.u32(0);
+	d.u32(1);
+	d.u32(11);
+	for (int k=0; k<14; k++) d.u32(0);
+	pre.chunk("MODF", d);
+
+	size_t offset = top.size() + 8 + 256*16 + pre.size();
+	Bytes mcin;
+	for (size_t k=0; k<mcnks.size(); k++) {
+		mcin.u32((unsigned int)offset);
+		mcin.u32((unsigned int)mcnks[k].size());
+		mcin.u32(0);
+		mcin.u32(0);
+		offset += mcnks[k].size();
+	}
+
+	Bytes adt = top;
+	adt.chunk("MCIN", mcin);
+	adt.put(&pre[0], pre.size());
+	for (size_t k=0; k<mcnks.size(); k++) adt.put(&mcnks[k][0], mcnks[k].size());
+	return adt;
+}
@@ -0,0 +1,40 @@
+#ifndef ADTWRITER_H
+#define ADTWRITER_H
+
+#include "tiledata.h"
+#include <string.h>
+#include <vector>
+
+// chunked files put together byte by byte
+struct Bytes: std::vector<unsigned char> {
+	void put(const void *p, size_t n) { insert(end(), (const unsigned char*)p, (const unsigned char*)p + n); }
+	void u32(unsigned int v) { put(&v, 4); }
+	void u16(unsigned short v) { put(&v, 2); }
+	void f32(float v) { put(&v, 4); }
+	// ids are stored back to front
+	void id(const char *s) { for (int i=3; i>=0; i--) push_back((unsigned char)s[i]); }
+	void chunk(const char *s, const Bytes &data)
+	{
+		id(s);
+		u32((unsigned int)data.size());
+		put(data.empty() ? 0 : &data[0], data.size());
+	}
+	void names(const char **l, int n) { for (int i=0; i<n; i++) put(l[i], strlen(l[i]) + 1); }
+};
+
+// what makeAdt put into each MCNK
+struct ExpectedChunk {
+	float heights[mapbufsize];
+	signed char normals[mapbufsize * 3];
+	unsigned char shadow[512];
+	unsigned char alpha[0x800];
+	bool water;
+};
+
+// A whole ADT: 256 MCNKs of random heights, normals, shadow and alpha
+// maps with two texture layers, water in chunk 5 and holes in chunk 3,
+// one doodad and two WMOs, the second meant to be missing. Always the
+// same bytes; what went into chunk j*16 + i is left in expected.
+Bytes makeAdt(ExpectedChunk *expected);
+
+#endif
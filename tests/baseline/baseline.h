@@ -0,0 +1,39 @@
+#ifndef BASELINE_H
+#define BASELINE_H
+
+// Decoders as they were before they were rewritten, for the tests and
+// benchmarks to compare the new ones with.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// explode.c: libmpq__decompress_pkzip, returning what
+// libmpq__do_decompress_pkzip returned and the bytes written in out_pos
+uint32_t baseline_explode(uint8_t *in_buf, uint32_t in_size, uint8_t *out_buf, uint32_t out_size, uint32_t *out_pos);
+
+// huffman.c: libmpq__decompress_huffman. It reads on past in_size until
+// out_buf is full or it meets the end code, so pad the input
+int32_t baseline_decompress_huffman(uint8_t *in_buf, uint32_t in_size, uint8_t *out_buf, uint32_t out_size);
+
+#ifdef __cplusplus
+}
+
+struct TileData;
+struct Frustum;
+class Vec3D;
+
+// tiledata.cpp: TileData::parse, reading everything through MPQFile::read
+bool baseline_parseTile(TileData &d, int x0, int z0, const char *filename);
+
+// frustum.cpp: Frustum::intersects, testing all eight corners
+bool baseline_intersects(const Frustum &f, const Vec3D &v1, const Vec3D &v2);
+
+// palette.cpp: decodeBLP's loop over the pixels of a palettized mip, for
+// 0, 1 and 8 bit alpha; the alpha plane follows the w*h indices in buf
+void baseline_expandPalette(const unsigned int *pal, unsigned char *buf, int w, int h, int alphabits, unsigned int *p);
+#endif
+
+#endif
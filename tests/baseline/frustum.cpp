@@ -0,0 +1,34 @@
+// tests/baseline: Frustum::intersects as it was before the frustum tests
+// went four at a time, kept for frustum_bench to compare against. Only the
+// member function became a free one.
+#include "baseline.h"
+#include "frustum.h"
+
+bool baseline_intersects(const Frustum &f, const Vec3D &v1, const Vec3D &v2)
+{
+	const Plane *planes = f.planes;
+	Vec3D points[8];
+	points[0] = Vec3D(v1.x,v1.y,v1.z);
+	points[1] = Vec3D(v1.x,v1.y,v2.z);
+	points[2] = Vec3D(v1.x,v2.y,v1.z);
+	points[3] = Vec3D(v1.x,v2.y,v2.z);
+	points[4] = Vec3D(v2.x,v1.y,v1.z);
+	points[5] = Vec3D(v2.x,v1.y,v2.z);
+	points[6] = Vec3D(v2.x,v2.y,v1.z);
+	points[7] = Vec3D(v2.x,v2.y,v2.z);
+
+ 	for (int i=0; i<6; i++) {
+		int numIn = 0;
+
+		for (int k=0; k<8; k++) {
+			if ((planes[i].a*points[k].x + planes[i].b*points[k].y + planes[i].c*points[k].z + planes[i].d) > 0)
+			{
+				numIn++;
+			}
+		}
+
+		if (numIn == 0) return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,103 @@
+#ifndef BASELINE_MANAGER_H
+#define BASELINE_MANAGER_H
+
+// tests/baseline: manager.h as it was before the managers moved to FlatMap,
+// kept for manager_bench to compare against. Besides the class names, the
+// manager got a virtual destructor and the item initializes its members in
+// order, so that it builds without warnings.
+
+#include <string>
+#include <map>
+
+// base class for manager objects
+
+class BaselineManagedItem {
+	int refcount;
+public:
+	std::string name;
+	BaselineManagedItem(std::string n): refcount(0), name(n) {}
+	virtual ~BaselineManagedItem() {}
+
+	void addref()
+	{
+		++refcount;
+	}
+
+	bool delref()
+	{
+		return --refcount==0;
+	}
+	
+};
+
+
+
+template <class IDTYPE>
+class BaselineManager {
+public:
+	std::map<std::string, IDTYPE> names;
+	std::map<IDTYPE, BaselineManagedItem*> items;
+
+	BaselineManager()
+	{
+	}
+
+	virtual ~BaselineManager()
+	{
+	}
+
+	virtual IDTYPE add(std::string name) = 0;
+
+	virtual void del(IDTYPE id)
+	{
+		if (items[id]->delref()) {
+			BaselineManagedItem *i = items[id];
+			doDelete(id);
+			names.erase(names.find(i->name));
+			items.erase(items.find(id));
+			delete i;
+		}
+	}
+
+	void delbyname(std::string name)
+	{
+		if (has(name)) del(get(name));
+	}
+
+	virtual void doDelete(IDTYPE id) {}
+
+	bool has(std::string name)
+	{
+		return (names.find(name) != names.end());
+	}
+
+	IDTYPE get(std::string name)
+	{
+		return names[name];
+	}
+
+protected:
+	void do_add(std::string name, IDTYPE id, BaselineManagedItem* item)
+	{
+		names[name] = id;
+		item->addref();
+		items[id] = item;
+	}
+};
+
+class BaselineSimpleManager : public BaselineManager<int> {
+	int baseid;
+public:
+	BaselineSimpleManager() : baseid(0)
+	{
+	}
+
+protected:
+	int nextID()
+	{
+		return baseid++;
+	}
+};
+
+#endif
+
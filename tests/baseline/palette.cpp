@@ -0,0 +1,36 @@
+// tests/baseline: the per pixel loop decodeBLP expanded palettized mips
+// with before expandPalette, kept for palette_bench to compare against.
+// Only the loop became a function, and alpha starts out as 0: the loop
+// never handled 4 bit alpha and left it uninitialized there.
+#include "baseline.h"
+
+void baseline_expandPalette(const unsigned int *pal, unsigned char *buf, int w, int h, int alphabits, unsigned int *p)
+{
+	unsigned char *c, *a;
+	bool hasalpha = alphabits!=0;
+
+	int cnt = 0;
+	c = &buf[0];
+	a = &buf[0] + w*h;
+	for (int y=0; y<h; y++) {
+		for (int x=0; x<w; x++) {
+			unsigned int k = pal[*c++];
+			k = ((k&0x00FF0000)>>16) | ((k&0x0000FF00)) | ((k& 0x000000FF)<<16);
+			int alpha = 0;
+			if (hasalpha) {
+				if (alphabits == 8) {
+					alpha = (*a++);
+				} else if (alphabits == 1) {
+					alpha = (*a & (1 << cnt++)) ? 0xff : 0;
+					if (cnt == 8) {
+						cnt = 0;
+						a++;
+					}
+				}
+			} else alpha = 0xff;
+
+			k |= alpha << 24;
+			*p++ = k;
+		}
+	}
+}
@@ -0,0 +1,329 @@
+// tests/baseline: TileData::parse as it was before it parsed the chunks
+// in place, reading everything through MPQFile::read, kept for adt_bench
+// to compare against. Only the member function became a free one and
+// MapChunkHeader moved into the anonymous namespace.
+#include "baseline.h"
+#include "tiledata.h"
+#include "wowmapview.h"
+#include "mpq.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+struct MapChunkHeader {
+	uint32 flags;
+	uint32 ix;
+	uint32 iy;
+	uint32 nLayers;
+	uint32 nDoodadRefs;
+	uint32 ofsHeight;
+	uint32 ofsNormal;
+	uint32 ofsLayer;
+	uint32 ofsRefs;
+	uint32 ofsAlpha;
+	uint32 sizeAlpha;
+	uint32 ofsShadow;
+	uint32 sizeShadow;
+	uint32 areaid;
+	uint32 nMapObjRefs;
+	uint32 holes;
+	uint16 s1;
+	uint16 s2;
+	uint32 d1;
+	uint32 d2;
+	uint32 d3;
+	uint32 predTex;
+	uint32 nEffectDoodad;
+	uint32 ofsSndEmitters;
+	uint32 nSndEmitters;
+	uint32 ofsLiquid;
+	uint32 sizeLiquid;
+	float  zpos;
+	float  xpos;
+	float  ypos;
+	uint32 textureId;
+	uint32 props;
+	uint32 effectId;
+};
+
+void readNames(MPQFile &f, size_t size, vector<string> &names)
+{
+	char *buf = new char[size];
+	f.read(buf, size);
+	char *p=buf;
+	while (p<buf+size) {
+		string path(p);
+		p+=strlen(p)+1;
+		fixname(path);
+		names.push_back(path);
+	}
+	delete[] buf;
+}
+
+void parseChunk(ChunkData &c, MPQFile &f)
+{
+    f.seekRelative(4);
+	char fcc[5];
+	uint32 size;
+	f.read(&size, 4);
+
+	// okay here we go ^_^
+	size_t lastpos = f.getPos() + size;
+
+	MapChunkHeader header;
+	f.read(&header, 0x80);
+
+	c.areaID = header.areaid;
+	c.flags = header.flags;
+	c.holes = header.holes;
+
+	// correct the x and z values ^_^
+	c.zbase = header.zpos*-1.0f + ZEROPOINT;
+	c.xbase = header.xpos*-1.0f + ZEROPOINT;
+	c.ybase = header.ypos;
+
+	c.vmin = Vec3D( 9999999.0f, 9999999.0f, 9999999.0f);
+	c.vmax = Vec3D(-9999999.0f,-9999999.0f,-9999999.0f);
+
+	while (f.getPos() < lastpos) {
+		f.read(fcc,4);
+		f.read(&size, 4);
+
+		flipcc(fcc);
+		fcc[4] = 0;
+
+		size_t nextpos = f.getPos() + size;
+
+		if (!strcmp(fcc,"MCNR")) {
+			nextpos = f.getPos() + 0x1C0; // size fix
+			// normal vectors
+			char nor[3];
+			Vec3D *ttn = c.normals;
+			for (int j=0; j<17; j++) {
+				for (int i=0; i<((j%2)?8:9); i++) {
+					f.read(nor,3);
+					// order Z,X,Y ?
+					*ttn++ = Vec3D(-(float)nor[1]/127.0f, (float)nor[2]/127.0f, -(float)nor[0]/127.0f);
+				}
+			}
+		}
+		else if (!strcmp(fcc,"MCVT")) {
+			Vec3D *ttv = c.vertices;
+
+			// vertices
+			for (int j=0; j<17; j++) {
+				for (int i=0; i<((j%2)?8:9); i++) {
+					float h,xpos,zpos;
+					f.read(&h,4);
+					xpos = i * UNITSIZE;
+					zpos = j * 0.5f * UNITSIZE;
+					if (j%2) {
+                        xpos += UNITSIZE*0.5f;
+					}
+					Vec3D v = Vec3D(c.xbase+xpos, c.ybase+h, c.zbase+zpos);
+					*ttv++ = v;
+					if (v.y < c.vmin.y) c.vmin.y = v.y;
+					if (v.y > c.vmax.y) c.vmax.y = v.y;
+				}
+			}
+
+			c.vmin.x = c.xbase;
+			c.vmin.z = c.zbase;
+			c.vmax.x = c.xbase + 8 * UNITSIZE;
+			c.vmax.z = c.zbase + 8 * UNITSIZE;
+			c.r = (c.vmax - c.vmin).length() * 0.5f;
+		}
+		else if (!strcmp(fcc,"MCLY")) {
+			// texture info
+			c.nTextures = std::min((int)size / 16, 4);
+			for (int i=0; i<c.nTextures; i++) {
+				int tex, flags;
+				f.read(&tex,4);
+				f.read(&flags, 4);
+
+				f.seekRelative(8);
+
+				flags &= ~0x100;
+
+				c.textures[i] = tex;
+				c.animated[i] = (flags & 0x80) ? flags : 0;
+			}
+		}
+		else if (!strcmp(fcc,"MCSH")) {
+			// shadow map 64 x 64
+			unsigned char *p = c.shadow, b8[8];
+			for (int j=0; j<64; j++) {
+				f.read(b8,8);
+				for (int i=0; i<8; i++) {
+					for (int b=0x01; b!=0x100; b<<=1) {
+						*p++ = (b8[i] & b) ? 85 : 0;
+					}
+				}
+			}
+			c.hasShadow = true;
+		}
+		else if (!strcmp(fcc,"MCAL")) {
+			// alpha maps  64 x 64
+			if (c.nTextures>0) {
+				for (int i=0; i<c.nTextures-1; i++) {
+					unsigned char *p = c.alphamaps[i];
+					unsigned char *abuf = (unsigned char*)f.getPointer(0x800);
+					for (int j=0; j<64*32; j++) {
+						unsigned char v = *abuf++;
+						*p++ = (v & 0x0f) << 4;
+						*p++ = (v & 0xf0);
+					}
+					f.seekRelative(0x800);
+				}
+			} else {
+				// some MCAL chunks have incorrect sizes! :(
+                continue;
+			}
+		}
+		else if (!strcmp(fcc,"MCLQ")) {
+			// liquid / water level
+			char fcc1[5];
+			f.read(fcc1,4);
+			flipcc(fcc1);
+			fcc1[4]=0;
+			if (!strcmp(fcc1,"MCSE")) {
+				c.haswater = false;
+			}
+			else {
+				c.haswater = true;
+				f.seekRelative(-4);
+				f.read(&c.waterlevel,4);
+
+				if (c.waterlevel > c.vmax.y) c.vmax.y = c.waterlevel;
+				if (c.waterlevel < c.vmin.y) c.haswater = false;
+
+				f.seekRelative(4);
+
+				char *lq = f.getPointer(liquidDataSize);
+				c.liquid.assign(lq, lq + liquidDataSize);
+			}
+			// we're done here!
+			break;
+		}
+		f.seek((int)nextpos);
+	}
+}
+
+}
+
+bool baseline_parseTile(TileData &d, int x0, int z0, const char *filename)
+{
+	d.x = x0;
+	d.z = z0;
+
+	gLog("Loading tile %d,%d\n",x0,z0);
+
+	MPQFile f(filename);
+	d.ok = !f.isEof();
+	if (!d.ok) {
+		gLogError("-> Error loading %s\n",filename);
+		return false;
+	}
+
+	char fourcc[5];
+	uint32 size;
+
+	uint32 mcnk_offsets[256], mcnk_sizes[256];
+
+	while (!f.isEof()) {
+		f.read(fourcc,4);
+		f.read(&size, 4);
+
+		flipcc(fourcc);
+		fourcc[4] = 0;
+
+		size_t nextpos = f.getPos() + size;
+
+		if (!strcmp(fourcc,"MCIN")) {
+			// mapchunk offsets/sizes
+			for (int i=0; i<256; i++) {
+				f.read(&mcnk_offsets[i],4);
+				f.read(&mcnk_sizes[i],4);
+				f.seekRelative(8);
+			}
+		}
+		else if (!strcmp(fourcc,"MTEX")) {
+			// texture lists
+			if (size) readNames(f, size, d.textures);
+		}
+		else if (!strcmp(fourcc,"MMDX")) {
+			// models ...
+			// MMID would be relative offsets for MMDX filenames
+			if (size) readNames(f, size, d.models);
+		}
+		else if (!strcmp(fourcc, "MWMO")) {
+			// map objects
+			if (size) readNames(f, size, d.wmos);
+
+			// archive lookups ignore case, so the names are fixed already
+			for (size_t i=0; i<d.wmos.size(); i++) {
+				AssetPath path(d.wmos[i]);
+				if (MPQFile::exists(path)) {
+					gLog("Adding WMO: %s\n", d.wmos[i].c_str());
+				} else {
+					gLog("Skipping missing WMO: %s\n", d.wmos[i].c_str());
+					d.wmos[i].clear();
+				}
+			}
+		}
+		else if (!strcmp(fourcc,"MDDF")) {
+			// model instance data
+			int n = (int)size / 36;
+			for (int i=0; i<n; i++) {
+				ModelPlacement p;
+				float ff[3];
+				f.read(&p.name, 4);
+				f.read(&p.d1, 4);
+				f.read(ff,12);
+				p.pos = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.dir = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(&p.scale,4);
+				d.modelPlacements.push_back(p);
+			}
+		}
+		else if (!strcmp(fourcc,"MODF")) {
+			// wmo instance data
+			int n = (int)size / 64;
+			for (int i=0; i<n; i++) {
+				WMOPlacement p;
+				float ff[3];
+				f.read(&p.name, 4);
+				f.read(&p.id, 4);
+				f.read(ff,12);
+				p.pos = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.dir = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.pos2 = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.pos3 = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(&p.d2,4);
+				f.read(&p.d3,4);
+				d.wmoPlacements.push_back(p);
+			}
+		}
+
+		// MCNK data will be processed separately ^_^
+
+		f.seek((int)nextpos);
+	}
+
+	// read individual map chunks
+	for (int j=0; j<16; j++) {
+		for (int i=0; i<16; i++) {
+			f.seek((int)mcnk_offsets[j*16+i]);
+			parseChunk(d.chunks[j][i], f);
+		}
+	}
+
+	f.close();
+	return true;
+}
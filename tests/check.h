@@ -0,0 +1,40 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <chrono>
+
+// What the tests and benchmarks share. A failed CHECK is reported and
+// counted, the program goes on so that one run shows everything wrong;
+// main() returns checkFailures() != 0 for ctest.
+inline int &checkFailures()
+{
+	static int n = 0;
+	return n;
+}
+
+#define CHECK(c) do { if (!(c)) { printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #c); checkFailures()++; } } while (0)
+
+inline double nowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift, so that the data is the same everywhere
+struct TestRandom {
+	unsigned int s;
+
+	TestRandom(unsigned int seed): s(seed ? seed : 1) {}
+
+	unsigned int next()
+	{
+		s ^= s << 13;
+		s ^= s >> 17;
+		s ^= s << 5;
+		return s;
+	}
+	// [lo, hi)
+	float uniform(float lo, float hi) { return lo + (hi - lo) * (next() >> 8) * (1.0f / 16777216.0f); }
+};
+
+#endif
@@ -0,0 +1,44 @@
+// Megapixels per second of the scalar and the SSE2 DXT decoders on a
+// 1024x1024 texture of random blocks, per format.
+// usage: dxt_bench [repeats]
+#include "check.h"
+#include "dxt.h"
+#include <stdlib.h>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 20;
+	const int w = 1024, h = 1024;
+	const struct {
+		GLint format;
+		const char *name;
+	} formats[] = {
+		{GL_COMPRESSED_RGB_S3TC_DXT1_EXT, "DXT1 RGB"},
+		{GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, "DXT1 RGBA"},
+		{GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, "DXT3"},
+		{GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, "DXT5"},
+	};
+
+	TestRandom rnd(1);
+	for (int f=0; f<4; f++) {
+		size_t bs = f >= 2 ? 16 : 8;
+		std::vector<unsigned char> src((w/4) * (h/4) * bs), scalar(w*h*4), simd(w*h*4);
+		for (size_t k=0; k<src.size(); k++) src[k] = (unsigned char)rnd.next();
+
+		// same pixels first
+		decompressDXTCScalar(formats[f].format, w, h, src.size(), &src[0], &scalar[0]);
+		decompressDXTC(formats[f].format, w, h, src.size(), &src[0], &simd[0]);
+		CHECK(scalar == simd);
+
+		double t0 = nowMs();
+		for (int r=0; r<repeats; r++) decompressDXTCScalar(formats[f].format, w, h, src.size(), &src[0], &scalar[0]);
+		double t1 = nowMs();
+		for (int r=0; r<repeats; r++) decompressDXTC(formats[f].format, w, h, src.size(), &src[0], &simd[0]);
+		double t2 = nowMs();
+
+		double mp = (double)repeats * w * h / 1e6;
+		printf("%-10s scalar %7.1f MP/s  decompressDXTC %7.1f MP/s\n", formats[f].name, mp / ((t1 - t0) / 1000), mp / ((t2 - t1) / 1000));
+	}
+	return checkFailures() != 0;
+}
@@ -0,0 +1,147 @@
+// Decodes S3TC blocks worked out by hand, then checks the SSE2 decoder
+// against the scalar one on random blocks of every format and mip size.
+#include "check.h"
+#include "dxt.h"
+#include <string.h>
+#include <vector>
+
+namespace {
+
+const GLint formats[] = {
+	GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+	GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+	GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
+	GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+};
+
+size_t blockSize(GLint format)
+{
+	return (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT || format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) ? 16 : 8;
+}
+
+// the index bytes E4 1B 00 FF of the blocks below: 0 1 2 3 / 3 2 1 0 / all 0 / all 3
+const int rowIndex[4][4] = {{0, 1, 2, 3}, {3, 2, 1, 0}, {0, 0, 0, 0}, {3, 3, 3, 3}};
+
+// c0 = red, c1 = green, so c0 > c1: two thirds and one third of the way
+const unsigned char fourColor[8] = {0x00, 0xF8, 0xE0, 0x07, 0xE4, 0x1B, 0x00, 0xFF};
+const unsigned char fourPalette[4][3] = {{248, 0, 0}, {0, 252, 0}, {165, 84, 0}, {82, 168, 0}};
+
+// c0 = blue, c1 = red, so c0 <= c1: half way, then black
+const unsigned char threeColor[8] = {0x1F, 0x00, 0x00, 0xF8, 0xE4, 0x1B, 0x00, 0xFF};
+const unsigned char threePalette[4][3] = {{0, 0, 248}, {248, 0, 0}, {124, 0, 124}, {0, 0, 0}};
+
+void decodeBoth(GLint format, int w, int h, const std::vector<unsigned char> &src, std::vector<unsigned char> &out)
+{
+	std::vector<unsigned char> in(src), scalar(w*h*4, 0xCD);
+	out.assign(w*h*4, 0xCD);
+	decompressDXTC(format, w, h, in.size(), &in[0], &out[0]);
+	decompressDXTCScalar(format, w, h, in.size(), &in[0], &scalar[0]);
+	CHECK(out == scalar);
+}
+
+// one 4x4 block against the palette and alpha it was made from, and its
+// top left corner decoded as the 2x2 and 1x1 mips
+void checkBlock(GLint format, const std::vector<unsigned char> &block, const unsigned char (*palette)[3], const unsigned char *alpha)
+{
+	std::vector<unsigned char> out;
+	decodeBoth(format, 4, 4, block, out);
+	bool same = true;
+	for (int j=0; j<4; j++) {
+		for (int i=0; i<4; i++) {
+			const unsigned char *p = &out[(j*4 + i) * 4];
+			const unsigned char *c = palette[rowIndex[j][i]];
+			same = same && p[0] == c[0] && p[1] == c[1] && p[2] == c[2] && p[3] == alpha[j*4 + i];
+		}
+	}
+	CHECK(same);
+
+	for (int size=1; size<=2; size++) {
+		std::vector<unsigned char> mip;
+		decodeBoth(format, size, size, block, mip);
+		for (int j=0; j<size; j++) {
+			CHECK(memcmp(&mip[j*size*4], &out[j*16], size*4) == 0);
+		}
+	}
+}
+
+void goldenBlocks()
+{
+	unsigned char opaque[16], punch[16], dxt3[16], dxt5a[16], dxt5b[16];
+	for (int k=0; k<16; k++) {
+		opaque[k] = 255;
+		// index 3 of a three color block is transparent
+		punch[k] = rowIndex[k / 4][k % 4] == 3 ? 0 : 255;
+		dxt3[k] = (unsigned char)(k * 16);
+	}
+	// the eight and the six level DXT5 ramps, pixel k using level k % 8
+	const unsigned char eight[8] = {255, 0, 218, 182, 145, 109, 72, 36};
+	const unsigned char six[8] = {0, 255, 51, 102, 153, 204, 0, 255};
+	for (int k=0; k<16; k++) {
+		dxt5a[k] = eight[k % 8];
+		dxt5b[k] = six[k % 8];
+	}
+
+	std::vector<unsigned char> four(fourColor, fourColor + 8), three(threeColor, threeColor + 8);
+	checkBlock(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, four, fourPalette, opaque);
+	checkBlock(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, three, threePalette, opaque);
+	checkBlock(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, four, fourPalette, opaque);
+	checkBlock(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, three, threePalette, punch);
+
+	// explicit alpha: the nibbles 0 to 15 in pixel order
+	std::vector<unsigned char> b3;
+	for (int k=0; k<8; k++) b3.push_back((unsigned char)((2*k + 1) << 4 | 2*k));
+	b3.insert(b3.end(), fourColor, fourColor + 8);
+	checkBlock(GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, b3, fourPalette, dxt3);
+
+	for (int ramp=0; ramp<2; ramp++) {
+		std::vector<unsigned char> b5;
+		b5.push_back(ramp ? 0 : 255);
+		b5.push_back(ramp ? 255 : 0);
+		unsigned long long bits = 0;
+		for (int k=0; k<16; k++) bits |= (unsigned long long)(k % 8) << (3*k);
+		for (int k=0; k<6; k++) b5.push_back((unsigned char)(bits >> (8*k)));
+		b5.insert(b5.end(), fourColor, fourColor + 8);
+		checkBlock(GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, b5, fourPalette, ramp ? dxt5b : dxt5a);
+	}
+}
+
+void randomBlocks()
+{
+	TestRandom rnd(1);
+	const int sizes[][2] = {{1, 1}, {2, 2}, {4, 4}, {8, 2}, {2, 8}, {6, 10}, {5, 3}, {64, 64}, {256, 128}};
+	for (int f=0; f<4; f++) {
+		for (size_t s=0; s<sizeof(sizes) / sizeof(sizes[0]); s++) {
+			for (int rep=0; rep<50; rep++) {
+				int w = sizes[s][0], h = sizes[s][1];
+				size_t bs = blockSize(formats[f]);
+				std::vector<unsigned char> src(((w+3)/4) * ((h+3)/4) * bs);
+				for (size_t k=0; k<src.size(); k++) src[k] = (unsigned char)rnd.next();
+				// half of them with c0 == c1, the three color case
+				if (rep & 1) {
+					for (size_t k=bs-8; k<src.size(); k+=bs) {
+						src[k] = src[k+2];
+						src[k+1] = src[k+3];
+					}
+				}
+				std::vector<unsigned char> out;
+				decodeBoth(formats[f], w, h, src, out);
+			}
+		}
+	}
+
+	// a short buffer stops at the last whole block and leaves the rest alone
+	std::vector<unsigned char> src(3 * 8, 0x55), out(8*8*4, 0xCD);
+	decompressDXTC(GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 8, 8, src.size() - 1, &src[0], &out[0]);
+	CHECK(out[(4*8 + 0) * 4] == 0xCD && out[4 * 4] != 0xCD);
+}
+
+}
+
+int main()
+{
+	goldenBlocks();
+	randomBlocks();
+
+	printf("dxt_test: %d failures\n", checkFailures());
+	return checkFailures() != 0;
+}
@@ -0,0 +1,183 @@
+// Regression test for the explode rewrite. Decodes PKWARE's own example
+// stream, then a corpus of imploded sectors (text, tables of numbers,
+// noise and long runs, ascii and binary mode, every dictionary size)
+// both directly and through an MPQ. Every sector is also damaged in a
+// few ways, and each damaged copy must give the same return value and the
+// same bytes as the explode of the baseline, without writing past the
+// output buffer.
+#include "check.h"
+#include "implode.h"
+#include "mpqwriter.h"
+#include "baseline/baseline.h"
+#include "mpq.h"
+#include <string.h>
+
+extern "C" {
+#include "explode.h"
+#include "extract.h"
+}
+
+namespace {
+
+struct Sector {
+	std::vector<unsigned char> raw, packed;
+};
+
+uint32_t explode(uint8_t *in, uint32_t inSize, uint8_t *out, uint32_t outSize, uint32_t *outPos)
+{
+	std::vector<uint8_t> work(sizeof(pkzip_cmp_s), 0);
+	pkzip_data_s info;
+	info.in_buf = in;
+	info.in_pos = 0;
+	info.in_bytes = (int32_t)inSize;
+	info.out_buf = out;
+	info.out_pos = 0;
+	info.max_out = (int32_t)outSize;
+	uint32_t result = libmpq__do_decompress_pkzip(&work[0], &info);
+	*outPos = info.out_pos;
+	return result;
+}
+
+// what an M2 or a WMO might hold: vertices and indices
+std::vector<unsigned char> tables(TestRandom &rnd, size_t size)
+{
+	std::vector<unsigned char> d;
+	float x = 0;
+	while (d.size() < size) {
+		x += rnd.uniform(-1, 1);
+		float v[3] = {x, x * 0.5f, 100.0f};
+		unsigned short i = (unsigned short)(rnd.next() % 300);
+		d.insert(d.end(), (unsigned char*)v, (unsigned char*)v + sizeof(v));
+		d.insert(d.end(), (unsigned char*)&i, (unsigned char*)&i + 2);
+	}
+	d.resize(size);
+	return d;
+}
+
+std::vector<unsigned char> text(TestRandom &rnd, size_t size)
+{
+	const char *words[] = {"void", "MapTile", "int", "for", "return", "float", "const", "if", "gWorld",
+		"->", "(", ")", "{", "}", ";", "=", "0", "1", "size", "chunks", "texture", "// the"};
+	std::string s;
+	while (s.size() < size) {
+		s += words[rnd.next() % 22];
+		s += (rnd.next() % 8) ? " " : "\r\n\t";
+	}
+	return std::vector<unsigned char>(s.begin(), s.begin() + size);
+}
+
+std::vector<Sector> corpus()
+{
+	TestRandom rnd(5);
+	std::vector<std::vector<unsigned char> > blobs;
+	for (int k=0; k<4; k++) blobs.push_back(text(rnd, 4096));
+	for (int k=0; k<4; k++) blobs.push_back(tables(rnd, 4096));
+	std::vector<unsigned char> noise(4096), runs(4096, 0);
+	for (size_t i=0; i<noise.size(); i++) noise[i] = (unsigned char)rnd.next();
+	for (size_t i=2048; i<runs.size(); i++) runs[i] = "ab"[i % 2];
+	blobs.push_back(noise);
+	blobs.push_back(runs);
+	// the last sector of a file is usually short
+	blobs.push_back(text(rnd, 1));
+	blobs.push_back(text(rnd, 333));
+
+	std::vector<Sector> sectors;
+	for (size_t b=0; b<blobs.size(); b++) {
+		for (int ascii=0; ascii<2; ascii++) {
+			for (int dictBits=4; dictBits<=6; dictBits++) {
+				Sector s;
+				s.raw = blobs[b];
+				s.packed = implode(&s.raw[0], s.raw.size(), ascii != 0, dictBits, rnd.next());
+				sectors.push_back(s);
+			}
+		}
+	}
+	return sectors;
+}
+
+// the example stream of PKWARE's appnote, as blast.c has it
+void reference()
+{
+	unsigned char in[] = {0x00, 0x04, 0x82, 0x24, 0x25, 0x8f, 0x80, 0x7f};
+	unsigned char out[32];
+	int n = libmpq__decompress_pkzip(in, sizeof(in), out, sizeof(out));
+	CHECK(n == 13 && memcmp(out, "AIAIAIAIAIAIA", 13) == 0);
+}
+
+void roundTrip(const std::vector<Sector> &sectors)
+{
+	for (size_t i=0; i<sectors.size(); i++) {
+		std::vector<unsigned char> in(sectors[i].packed), out(sectors[i].raw.size());
+		int n = libmpq__decompress_pkzip(&in[0], (uint32_t)in.size(), &out[0], (uint32_t)out.size());
+		CHECK(n == (int)out.size() && out == sectors[i].raw);
+	}
+}
+
+void againstBaseline(const std::vector<Sector> &sectors)
+{
+	TestRandom rnd(9);
+	int aborted = 0, cases = 0;
+	for (size_t i=0; i<sectors.size(); i++) {
+		const Sector &s = sectors[i];
+		for (int k=0; k<40; k++) {
+			std::vector<unsigned char> in(s.packed);
+			uint32_t inSize = (uint32_t)in.size(), outSize = (uint32_t)s.raw.size();
+			// as it is, output too short, input cut off, one bit flipped
+			if (k % 4 == 1) outSize = rnd.next() % (outSize + 1);
+			if (k % 4 == 2) inSize = rnd.next() % (inSize + 1);
+			if (k % 4 == 3) in[2 + rnd.next() % (in.size() - 2)] ^= (unsigned char)(1 << (rnd.next() % 8));
+
+			// the baseline may write past what it reports, not past outSize
+			std::vector<unsigned char> a(8192, 0xAA), b(8192, 0xAA);
+			uint32_t aPos, bPos;
+			uint32_t ra = baseline_explode(&in[0], inSize, &a[0], outSize, &aPos);
+			uint32_t rb = explode(&in[0], inSize, &b[0], outSize, &bPos);
+			CHECK(ra == rb && aPos == bPos);
+			CHECK(memcmp(&a[0], &b[0], bPos) == 0);
+			bool clean = true;
+			for (size_t q=outSize; q<b.size(); q++) clean = clean && b[q] == 0xAA;
+			CHECK(clean);
+			aborted += rb != LIBMPQ_PKZIP_CMP_NO_ERROR;
+			cases++;
+		}
+	}
+	printf("%d damaged sectors, %d of them aborted\n", cases, aborted);
+}
+
+void throughArchive()
+{
+	TestRandom rnd(3);
+	MPQWriter w;
+	std::vector<unsigned char> a = text(rnd, 70000), b = tables(rnd, 9000);
+	w.add("Test\\text.txt", a, MPQWriter::PKZIP);
+	w.add("Test\\tables.bin", b, MPQWriter::PKZIP);
+	w.add("Test\\single.bin", b, MPQWriter::PKZIP, true);
+	CHECK(w.write("explode_test.mpq"));
+
+	{
+		MPQArchive archive("explode_test.mpq");
+		gMPQIndex.build();
+		MPQFile fa("Test\\text.txt"), fb("Test\\tables.bin"), fc("Test\\single.bin");
+		CHECK(fa.getSize() == a.size() && memcmp(fa.getBuffer(), &a[0], a.size()) == 0);
+		CHECK(fb.getSize() == b.size() && memcmp(fb.getBuffer(), &b[0], b.size()) == 0);
+		CHECK(fc.getSize() == b.size() && memcmp(fc.getBuffer(), &b[0], b.size()) == 0);
+		gMPQIndex.clear();
+		archive.close();
+		gOpenArchives.clear();
+	}
+	remove("explode_test.mpq");
+}
+
+}
+
+int main()
+{
+	std::vector<Sector> sectors = corpus();
+	reference();
+	roundTrip(sectors);
+	againstBaseline(sectors);
+	throughArchive();
+
+	printf("explode_test: %u sectors, %d failures\n", (unsigned int)sectors.size(), checkFailures());
+	return checkFailures() != 0;
+}
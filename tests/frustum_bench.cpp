@@ -0,0 +1,118 @@
+// Boxes per second through the frustum tests: the eight corner test
+// Frustum::intersects used to be, the center and extent one it is now,
+// intersects4 and, for spheres, cull. All of them must agree with the
+// eight corner test (cull with the plain sphere rule) on every box first.
+// usage: frustum_bench [repeats]
+#include "check.h"
+#include "baseline/baseline.h"
+#include "frustum.h"
+#include <math.h>
+#include <stdlib.h>
+
+namespace {
+
+const int count = 1 << 16;
+
+// 90 degrees wide and high, looking down +x from the origin, near 1, far 500
+void makeFrustum(Frustum &f)
+{
+	const Plane planes[6] = {
+		{1, 0, -1, 0}, {1, 0, 1, 0}, {1, 1, 0, 0}, {1, -1, 0, 0}, {-1, 0, 0, 500}, {1, 0, 0, -1},
+	};
+	for (int i=0; i<6; i++) {
+		f.planes[i] = planes[i];
+		f.planes[i].normalize();
+	}
+}
+
+bool sphereVisible(const Frustum &f, float x, float y, float z, float r)
+{
+	for (int i=0; i<6; i++) {
+		const Plane &p = f.planes[i];
+		if (p.a*x + p.b*y + p.c*z + p.d + r <= 0) return false;
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 50;
+
+	Frustum f;
+	makeFrustum(f);
+
+	// around the frustum, near and past every plane; some flat or empty
+	TestRandom rnd(3);
+	std::vector<Vec3D> lo(count), hi(count);
+	for (int i=0; i<count; i++) {
+		float x = rnd.uniform(-50, 600);
+		Vec3D c(x, rnd.uniform(-1.3f, 1.3f) * fabsf(x), rnd.uniform(-1.3f, 1.3f) * fabsf(x));
+		if (i % 8 == 0) c.x = rnd.uniform(-3, 3);
+		Vec3D e(rnd.uniform(0, 30), rnd.uniform(0, 30), rnd.uniform(0, 30));
+		if (i % 16 == 0) e.y = 0;
+		if (i % 64 == 1) e = Vec3D(0, 0, 0);
+		lo[i] = c - e;
+		hi[i] = c + e;
+	}
+	std::vector<Boxes4> boxes(count / 4);
+	// the hints start anywhere, so that every plane gets to go first
+	std::vector<unsigned char> hints(count / 4);
+	for (size_t k=0; k<hints.size(); k++) hints[k] = (unsigned char)(rnd.next() % 6);
+	for (int i=0; i<count; i++) boxes[i / 4].set(i % 4, lo[i], hi[i]);
+
+	// twice, the second time starting from the hints
+	int visible = 0, wrong = 0;
+	for (int pass=0; pass<2; pass++) {
+		for (int i=0; i<count; i+=4) {
+			unsigned int in = f.intersects4(boxes[i / 4], hints[i / 4]);
+			for (int k=0; k<4; k++) {
+				bool old = baseline_intersects(f, lo[i+k], hi[i+k]);
+				if (old != (((in >> k) & 1) != 0) || old != f.intersects(lo[i+k], hi[i+k])) wrong++;
+				visible += old;
+			}
+		}
+	}
+	printf("%d of %d boxes visible\n", visible / 2, count);
+	CHECK(wrong == 0);
+
+	// a count that is not a multiple of four, for the padded tail
+	SphereList spheres;
+	for (int i=0; i<count - 3; i++) spheres.add((lo[i] + hi[i]) * 0.5f, rnd.uniform(0, 40));
+	wrong = 0;
+	for (int pass=0; pass<2; pass++) {
+		f.cull(spheres);
+		for (size_t i=0; i<spheres.size(); i++) {
+			if (spheres.isVisible(i) != sphereVisible(f, spheres.x[i], spheres.y[i], spheres.z[i], spheres.r[i])) wrong++;
+		}
+	}
+	CHECK(wrong == 0);
+
+	double mb = (double)repeats * count / 1e6;
+	volatile unsigned int sink = 0;
+	double t0 = nowMs();
+	for (int r=0; r<repeats; r++) {
+		for (int i=0; i<count; i++) sink += baseline_intersects(f, lo[i], hi[i]);
+	}
+	double t1 = nowMs();
+	for (int r=0; r<repeats; r++) {
+		for (int i=0; i<count; i++) sink += f.intersects(lo[i], hi[i]);
+	}
+	double t2 = nowMs();
+	for (int r=0; r<repeats; r++) {
+		for (int i=0; i<count/4; i++) sink += f.intersects4(boxes[i], hints[i]);
+	}
+	double t3 = nowMs();
+	for (int r=0; r<repeats; r++) {
+		f.cull(spheres);
+		sink += spheres.visible[0];
+	}
+	double t4 = nowMs();
+
+	printf("eight corners %6.1f Mboxes/s\n", mb / ((t1 - t0) / 1000));
+	printf("intersects    %6.1f Mboxes/s\n", mb / ((t2 - t1) / 1000));
+	printf("intersects4   %6.1f Mboxes/s\n", mb / ((t3 - t2) / 1000));
+	printf("cull          %6.1f Mspheres/s\n", mb / ((t4 - t3) / 1000));
+	return checkFailures() != 0;
+}
@@ -0,0 +1,201 @@
+// Megabytes per second out of the huffman decoder and out of the one it
+// replaced, for each of the nine trees, alone and as the first half of the
+// WAV sectors (0x41 mono and 0x81 stereo ADPCM through decompress_multi).
+// The streams are made with the decoder's own trees and must come back
+// as they went in, and decode the same with both when cut short.
+// usage: huffman_bench [repeats]
+#include "check.h"
+#include "baseline/baseline.h"
+#include "mpq.h"
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+#include "huffman.h"
+#include "extract.h"
+}
+
+namespace {
+
+const int blockSize = 4096;
+
+struct BitWriter {
+	std::vector<unsigned char> out;
+	unsigned int acc, bits;
+
+	BitWriter(): acc(0), bits(0) {}
+	void put(unsigned int v, int n)
+	{
+		for (int i=0; i<n; i++) {
+			acc |= ((v >> i) & 1) << bits;
+			if (++bits == 8) {
+				out.push_back((unsigned char)acc);
+				acc = bits = 0;
+			}
+		}
+	}
+};
+
+struct Tree {
+	huffman_tree_s *ht;
+
+	Tree(int type)
+	{
+		ht = (huffman_tree_s*)calloc(1, sizeof(huffman_tree_s));
+		libmpq__huffman_tree_init(ht, LIBMPQ_HUFF_DECOMPRESS);
+		libmpq__huffman_tree_build(ht, type);
+	}
+	~Tree() { free(ht); }
+
+	// root first, 1 for the sibling that is not the first child
+	void code(BitWriter &w, unsigned int symbol) const
+	{
+		int path[0x204], n = 0;
+		for (huffman_tree_item_s *p = ht->items306C[symbol]; p->parent; p = p->parent) path[n++] = p->parent->child != p;
+		while (n--) w.put(path[n], 1);
+	}
+};
+
+// what was decoded is what went in, bytes every tree has a code for
+std::vector<unsigned char> encode(int type, const std::vector<unsigned char> &data)
+{
+	Tree t(type);
+	BitWriter w;
+	w.put(type, 8);
+	for (size_t i=0; i<data.size(); i++) {
+		t.code(w, data[i]);
+		// type 0 adapts to what it has seen
+		if (type == 0) libmpq__huffman_call_1500E820(t.ht, t.ht->items306C[data[i]]);
+	}
+	t.code(w, 0x100);
+	w.put(0, 16);
+	return w.out;
+}
+
+std::vector<unsigned char> symbols(int type)
+{
+	Tree t(type);
+	std::vector<unsigned char> s;
+	for (int i=0; i<256; i++) {
+		if (t.ht->items306C[i]) s.push_back((unsigned char)i);
+	}
+	return s;
+}
+
+// ADPCM codes of quiet sound: a few small steps most of the time
+std::vector<unsigned char> adpcm(const std::vector<unsigned char> &sym, size_t size, TestRandom &rnd)
+{
+	std::vector<unsigned char> d(size);
+	size_t n = sym.size();
+	for (size_t i=0; i<size; i++) {
+		unsigned int r = rnd.next() % 100;
+		d[i] = sym[r < 60 ? rnd.next() % std::min<size_t>(n, 8) : r < 90 ? rnd.next() % std::min<size_t>(n, 40) : rnd.next() % n];
+	}
+	return d;
+}
+
+// The old decoder reads on past the end of the input, so every stream is
+// kept with plenty of zeros after it. Neither decoder writes to it.
+struct Stream {
+	std::vector<unsigned char> bytes;
+	uint32_t size;
+
+	Stream(const std::vector<unsigned char> &d, size_t n): bytes(d.begin(), d.begin() + n), size((uint32_t)n)
+	{
+		bytes.resize(n + 0x10000, 0);
+	}
+	unsigned char *data() { return &bytes[0]; }
+};
+
+int32_t oldHuffman(Stream &in, unsigned char *out, uint32_t outSize)
+{
+	return baseline_decompress_huffman(in.data(), in.size, out, outSize);
+}
+
+int32_t newHuffman(Stream &in, unsigned char *out, uint32_t outSize)
+{
+	return libmpq__decompress_huffman(in.data(), in.size, out, outSize);
+}
+
+// what decompress_multi did with a huffman and a wave mask before
+int32_t oldMulti(Stream &in, unsigned char *out, uint32_t outSize, std::vector<unsigned char> &temp)
+{
+	int32_t n = baseline_decompress_huffman(in.data() + 1, in.size - 1, out, outSize);
+	if (n < 0) return n;
+	temp.assign(outSize, 0);
+	n = (in.bytes[0] & 0x80) ? libmpq__decompress_wave_stereo(out, outSize, &temp[0], outSize) : libmpq__decompress_wave_mono(out, outSize, &temp[0], outSize);
+	memcpy(out, &temp[0], outSize);
+	return n;
+}
+
+// Streams cut off and output buffers too short must give the same
+// with both. Random bytes are no good for this: they crash the old
+// decoder now and then.
+void shortStreams(int type, const std::vector<unsigned char> &packed, TestRandom &rnd)
+{
+	int differ = 0;
+	for (int k=0; k<100; k++) {
+		Stream in(packed, 1 + rnd.next() % packed.size());
+		uint32_t outSize = 1 + rnd.next() % blockSize;
+		std::vector<unsigned char> a(outSize, 0xAA), b(outSize, 0xAA);
+		if (oldHuffman(in, &a[0], outSize) != newHuffman(in, &b[0], outSize) || a != b) differ++;
+	}
+	if (differ) printf("type %d: %d of 100 short streams differ\n", type, differ);
+	CHECK(differ == 0);
+}
+
+double mbPerSecond(double bytes, double ms)
+{
+	return bytes / 1e6 / (ms / 1000);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 200;
+
+	TestRandom rnd(7);
+	std::vector<unsigned char> a(blockSize), b(blockSize);
+	printf("MB/s out        huffman            0x41 mono          0x81 stereo\n");
+	for (int type=0; type<9; type++) {
+		std::vector<unsigned char> sym = symbols(type);
+		std::vector<unsigned char> raw = adpcm(sym, blockSize, rnd);
+		std::vector<unsigned char> packed = encode(type, raw);
+		Stream stream(packed, packed.size());
+
+		CHECK(oldHuffman(stream, &a[0], blockSize) == blockSize && a == raw);
+		CHECK(newHuffman(stream, &b[0], blockSize) == blockSize && b == raw);
+		shortStreams(type, packed, rnd);
+
+		double t0 = nowMs();
+		for (int r=0; r<repeats; r++) oldHuffman(stream, &a[0], blockSize);
+		double t1 = nowMs();
+		for (int r=0; r<repeats; r++) newHuffman(stream, &b[0], blockSize);
+		double t2 = nowMs();
+		printf("type %d   old %6.1f new %6.1f", type, mbPerSecond((double)repeats * blockSize, t1 - t0), mbPerSecond((double)repeats * blockSize, t2 - t1));
+
+		// a sector of 16 bit samples: two bytes of header, the first sample
+		// of each channel, then one code per sample
+		for (int channels=1; channels<=2; channels++) {
+			std::vector<unsigned char> codes = adpcm(sym, blockSize / 2 - 2 * channels + 2, rnd);
+			std::vector<unsigned char> bytes = encode(type, codes);
+			bytes.insert(bytes.begin(), channels == 1 ? 0x41 : 0x81);
+			Stream sector(bytes, bytes.size());
+
+			std::vector<unsigned char> temp;
+			int32_t ra = oldMulti(sector, &a[0], blockSize, temp);
+			int32_t rb = libmpq__decompress_multi(sector.data(), sector.size, &b[0], blockSize);
+			CHECK(ra == rb && a == b && rb > 0);
+
+			t0 = nowMs();
+			for (int r=0; r<repeats; r++) oldMulti(sector, &a[0], blockSize, temp);
+			t1 = nowMs();
+			for (int r=0; r<repeats; r++) libmpq__decompress_multi(sector.data(), sector.size, &b[0], blockSize);
+			t2 = nowMs();
+			printf("   old %6.1f new %6.1f", mbPerSecond((double)repeats * rb, t1 - t0), mbPerSecond((double)repeats * rb, t2 - t1));
+		}
+		printf("\n");
+	}
+	return checkFailures() != 0;
+}
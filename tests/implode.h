@@ -0,0 +1,13 @@
+#ifndef IMPLODE_H
+#define IMPLODE_H
+
+#include <stddef.h>
+#include <vector>
+
+// PKWARE DCL implode, the other half of libmpq's explode, for making
+// sectors in the tests. Greedy matching over the last 32 places each three
+// bytes were seen; with a seed, one match in twenty is cut short at random
+// so that every length code gets used. dictBits is 4, 5 or 6 (1, 2 or 4 KB).
+std::vector<unsigned char> implode(const unsigned char *data, size_t size, bool ascii, int dictBits, unsigned int seed = 0);
+
+#endif
@@ -0,0 +1,109 @@
+// Megabytes per second out of MPQFile for files of many zlib, bzip2 and
+// pkzip sectors, with the sectors spread over 1, 2, 4 and 8 threads (the
+// caller and a pool one smaller). The MPQ cache is off, so every read
+// decompresses, and every read must give the file back as it went in.
+// usage: inflate_bench [repeats]
+#include "check.h"
+#include "mpqwriter.h"
+#include "mpq.h"
+#include "threadpool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+namespace {
+
+const char *archiveName = "inflate_bench.mpq";
+const int filesPerType = 4;
+const size_t fileSize = 1 << 20;
+
+// vertices, indices and names, about as compressible as models are
+std::vector<unsigned char> makeFile(TestRandom &rnd)
+{
+	std::vector<unsigned char> d;
+	float x = 0;
+	while (d.size() < fileSize) {
+		if (rnd.next() % 16 == 0) {
+			const char *name = "World\\Azeroth\\Elwynn\\PassiveDoodads\\Trees\\";
+			d.insert(d.end(), name, name + strlen(name));
+		}
+		x += rnd.uniform(-1, 1);
+		float v[3] = {x, rnd.uniform(0, 4), 100.0f};
+		unsigned short i = (unsigned short)(rnd.next() % 1000);
+		d.insert(d.end(), (unsigned char*)v, (unsigned char*)v + sizeof(v));
+		d.insert(d.end(), (unsigned char*)&i, (unsigned char*)&i + 2);
+	}
+	d.resize(fileSize);
+	return d;
+}
+
+std::string fileName(const char *type, int i)
+{
+	char s[64];
+	snprintf(s, sizeof(s), "Test\\%s%d.bin", type, i);
+	return s;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 5;
+
+	const struct {
+		MPQWriter::Compression c;
+		const char *name;
+	} types[] = {
+		{MPQWriter::ZLIB, "zlib"},
+		{MPQWriter::BZIP2, "bzip2"},
+		{MPQWriter::PKZIP, "pkzip"},
+	};
+
+	TestRandom rnd(1);
+	MPQWriter w;
+	std::vector<std::vector<unsigned char> > files;
+	for (int t=0; t<3; t++) {
+		for (int i=0; i<filesPerType; i++) {
+			files.push_back(makeFile(rnd));
+			w.add(fileName(types[t].name, i), files.back(), types[t].c);
+		}
+	}
+	CHECK(w.write(archiveName));
+
+	gMPQCache.setBudget(0);
+	{
+		MPQArchive archive(archiveName);
+		gMPQIndex.build();
+
+		printf("MB/s out, %u hardware threads\n", std::thread::hardware_concurrency());
+		const int threads[] = {1, 2, 4, 8};
+		for (int t=0; t<3; t++) {
+			printf("%-6s", types[t].name);
+			for (int k=0; k<4; k++) {
+				gThreadPool.shutdown();
+				gThreadPool.start(threads[k] - 1);
+
+				bool same = true;
+				double t0 = nowMs();
+				for (int r=0; r<repeats; r++) {
+					for (int i=0; i<filesPerType; i++) {
+						MPQFile f(fileName(types[t].name, i).c_str());
+						const std::vector<unsigned char> &d = files[t * filesPerType + i];
+						same = same && f.getSize() == d.size() && memcmp(f.getBuffer(), &d[0], d.size()) == 0;
+					}
+				}
+				double ms = nowMs() - t0;
+				CHECK(same);
+				printf("  %d: %6.1f", threads[k], (double)repeats * filesPerType * fileSize / 1e6 / (ms / 1000));
+			}
+			printf("\n");
+		}
+
+		gThreadPool.shutdown();
+		gMPQIndex.clear();
+		archive.close();
+		gOpenArchives.clear();
+	}
+	remove(archiveName);
+	return checkFailures() != 0;
+}
@@ -0,0 +1,172 @@
+// Lookups in the FlatMap managers against the std::map ones they
+// replaced, with 1k to 200k M2 paths loaded: add() of something already
+// loaded (by name and by AssetPath), get() and item(). Before timing,
+// both managers go through the same random adds and deletes and must
+// agree on what is loaded, and stale ids must stay dead.
+// usage: manager_bench [repeats], 100000 lookups each
+#include "check.h"
+#include "baseline/manager.h"
+#include "manager.h"
+#include <stdlib.h>
+
+namespace {
+
+// what ModelManager::add does, without loading anything
+struct NewManager: SimpleManager {
+	int add(const std::string &name)
+	{
+		int id;
+		if (addref(name, id)) return id;
+		id = nextID();
+		do_add(name, id, new ManagedItem(name));
+		return id;
+	}
+	int add(const AssetPath &path)
+	{
+		int id;
+		if (addref(path, id)) return id;
+		id = nextID();
+		do_add(path, id, new ManagedItem(path.str()));
+		return id;
+	}
+};
+
+// and what it did before
+struct OldManager: BaselineSimpleManager {
+	int add(std::string name)
+	{
+		int id;
+		if (names.find(name) != names.end()) {
+			id = names[name];
+			items[id]->addref();
+			return id;
+		}
+		id = nextID();
+		do_add(name, id, new BaselineManagedItem(name));
+		return id;
+	}
+};
+
+// the managers leave deleting what is still loaded to their owners
+void unload(NewManager &m, OldManager &old)
+{
+	m.forEach([](int, ManagedItem *item) { delete item; });
+	for (std::map<int, BaselineManagedItem*>::iterator it = old.items.begin(); it != old.items.end(); ++it) delete it->second;
+}
+
+std::string modelName(int i)
+{
+	char s[128];
+	snprintf(s, sizeof(s), "World\\Azeroth\\Elwynn\\PassiveDoodads\\Tree%d\\ElwynnTree%d.m2", i * 7919, i);
+	return s;
+}
+
+void churn()
+{
+	NewManager m;
+	OldManager old;
+
+	int a = m.add("a"), b = m.add("b");
+	CHECK(a != 0 && m.add("a") == a);
+	m.del(a);
+	CHECK(m.item(a) != 0);
+	m.del(a);
+	CHECK(m.item(a) == 0 && !m.has("a") && m.get("a") == 0);
+	// the slot comes back with a new generation; the old id stays dead
+	int c = m.add("c");
+	CHECK(c != a && m.item(a) == 0 && m.item(c) != 0);
+	m.del(a);
+	CHECK(m.item(b) != 0 && m.item(c) != 0);
+	m.del(b);
+	m.del(c);
+
+	TestRandom rnd(1);
+	std::vector<int> ids, oldIds;
+	std::vector<std::string> names;
+	int wrong = 0;
+	for (int k=0; k<200000; k++) {
+		if (ids.empty() || rnd.next() % 3) {
+			names.push_back(modelName(rnd.next() % 5000));
+			ids.push_back(m.add(names.back()));
+			oldIds.push_back(old.add(names.back()));
+		} else {
+			size_t i = rnd.next() % ids.size();
+			ManagedItem *item = m.item(ids[i]);
+			if (!item || item->name != names[i]) wrong++;
+			m.del(ids[i]);
+			old.del(oldIds[i]);
+			if (m.has(names[i]) != old.has(names[i])) wrong++;
+			ids[i] = ids.back();
+			ids.pop_back();
+			oldIds[i] = oldIds.back();
+			oldIds.pop_back();
+			names[i] = names.back();
+			names.pop_back();
+		}
+	}
+	CHECK(wrong == 0 && m.count() == old.items.size());
+	printf("%u loaded after the churn\n", (unsigned int)m.count());
+	unload(m, old);
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 10;
+	int lookups = repeats * 100000;
+
+	churn();
+
+	const int sizes[] = {1000, 10000, 50000, 200000};
+	for (int s=0; s<4; s++) {
+		int n = sizes[s];
+		std::vector<std::string> names;
+		std::vector<AssetPath> paths;
+		for (int i=0; i<n; i++) {
+			names.push_back(modelName(i));
+			paths.push_back(AssetPath(names.back()));
+		}
+		TestRandom rnd(2);
+		std::vector<int> pick(lookups);
+		for (int k=0; k<lookups; k++) pick[k] = (int)(rnd.next() % n);
+
+		NewManager *m = new NewManager;
+		OldManager *old = new OldManager;
+		std::vector<int> ids, oldIds;
+		for (int i=0; i<n; i++) {
+			ids.push_back(m->add(names[i]));
+			oldIds.push_back(old->add(names[i]));
+		}
+
+		volatile long sink = 0;
+		double t0 = nowMs();
+		for (int k=0; k<lookups; k++) sink += m->add(names[pick[k]]);
+		double t1 = nowMs();
+		for (int k=0; k<lookups; k++) sink += old->add(names[pick[k]]);
+		double t2 = nowMs();
+		for (int k=0; k<lookups; k++) sink += m->add(paths[pick[k]]);
+		double t3 = nowMs();
+		for (int k=0; k<lookups; k++) sink += m->get(names[pick[k]]);
+		double t4 = nowMs();
+		for (int k=0; k<lookups; k++) sink += old->get(names[pick[k]]);
+		double t5 = nowMs();
+		for (int k=0; k<lookups; k++) sink += (long)m->item(ids[pick[k]]);
+		double t6 = nowMs();
+		for (int k=0; k<lookups; k++) sink += (long)old->items[oldIds[pick[k]]];
+		double t7 = nowMs();
+
+		printf("%6d loaded, ms per %d: add %.1f / old %.1f (AssetPath %.1f)  get %.1f / old %.1f  item %.1f / old %.1f\n",
+			n, lookups, t1 - t0, t2 - t1, t3 - t2, t4 - t3, t5 - t4, t6 - t5, t7 - t6);
+
+		// the same ids resolve to the same names
+		bool same = true;
+		for (int i=0; i<n; i++) same = same && m->item(ids[i])->name == old->items[oldIds[i]]->name;
+		CHECK(same);
+
+		unload(*m, *old);
+		delete m;
+		delete old;
+	}
+	return checkFailures() != 0;
+}
@@ -0,0 +1,126 @@
+// Reads every file of the (listfile) from several threads at once and
+// compares each byte with what single threaded reads gave. With the cache
+// off every read goes to libmpq, so the threads share the archive's file
+// handle (pread / OVERLAPPED) and its per-file state. Runs once reading
+// the archive and once with it mapped.
+// usage: mpq_stress_test [threads] [rounds]
+#include "check.h"
+#include "mpqwriter.h"
+#include "mpq.h"
+#include "threadpool.h"
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+const char *archiveName = "mpq_stress_test.mpq";
+
+std::vector<unsigned char> makeFile(TestRandom &rnd)
+{
+	// empty, shorter than a sector, a sector and a bit, many sectors
+	const size_t sizes[] = {0, 1, 5, 100, 4096, 4097, 9000, 70000, 300000};
+	std::vector<unsigned char> d(sizes[rnd.next() % 9]);
+	// compresses, but not to nothing
+	for (size_t i=0; i<d.size(); i++) {
+		d[i] = (rnd.next() % 10 < 8) ? (unsigned char)('a' + rnd.next() % 8) : (unsigned char)rnd.next();
+	}
+	return d;
+}
+
+std::vector<unsigned char> readFile(const std::string &name, bool lazy)
+{
+	MPQFile f(name.c_str(), lazy);
+	// files of one byte or less count as missing
+	if (f.isEof()) return std::vector<unsigned char>();
+	std::vector<unsigned char> d(f.getSize());
+	if (lazy) {
+		// odd pieces, so that sectors are fetched one by one
+		for (size_t pos=0; pos<d.size(); pos+=777) {
+			f.seek((int)pos);
+			f.read(&d[pos], std::min<size_t>(777, d.size() - pos));
+		}
+	} else if (!d.empty()) {
+		memcpy(&d[0], f.getBuffer(), d.size());
+	}
+	return d;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int threads = argc > 1 ? atoi(argv[1]) : 8;
+	int rounds = argc > 2 ? atoi(argv[2]) : 3;
+
+	TestRandom rnd(1);
+	MPQWriter w;
+	std::vector<std::string> names;
+	std::vector<std::vector<unsigned char> > files;
+	std::string listfile;
+	for (int i=0; i<300; i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "World\\Test\\file%03d.bin", i);
+		names.push_back(name);
+		files.push_back(makeFile(rnd));
+		listfile += name;
+		listfile += "\r\n";
+		const MPQWriter::Compression c[] = {MPQWriter::ZLIB, MPQWriter::BZIP2, MPQWriter::NONE};
+		w.add(name, files.back(), c[i % 3], i == 7);
+	}
+	w.add("(listfile)", std::vector<unsigned char>(listfile.begin(), listfile.end()));
+	CHECK(w.write(archiveName));
+
+	// nothing served from memory
+	gMPQCache.setBudget(0);
+	gThreadPool.start(4);
+
+	for (int mapped=0; mapped<2; mapped++) {
+		MPQArchive::mapFiles = mapped != 0;
+		MPQArchive *archive = new MPQArchive(archiveName);
+		gMPQIndex.build();
+
+		std::vector<std::string> list;
+		archive->GetFileListTo(list);
+		CHECK(list == names);
+
+		std::vector<std::vector<unsigned char> > single;
+		for (size_t i=0; i<list.size(); i++) {
+			single.push_back(readFile(list[i], false));
+			CHECK(single.back() == files[i] || (files[i].size() <= 1 && single.back().empty()));
+		}
+
+		std::atomic<int> mismatches(0), reads(0);
+		double t0 = nowMs();
+		std::vector<std::thread> pool;
+		for (int t=0; t<threads; t++) {
+			pool.push_back(std::thread([&, t] {
+				for (int r=0; r<rounds; r++) {
+					// every thread starts somewhere else, half of them streaming
+					bool lazy = (t + r) % 2 != 0;
+					for (size_t k=0; k<list.size(); k++) {
+						size_t i = (k + t * 37) % list.size();
+						if (readFile(list[i], lazy) != single[i]) mismatches++;
+						reads++;
+					}
+				}
+			}));
+		}
+		for (size_t t=0; t<pool.size(); t++) pool[t].join();
+
+		printf("%s: %d reads from %d threads in %.0f ms, %d mismatches\n", mapped ? "mapped" : "read",
+			(int)reads, threads, nowMs() - t0, (int)mismatches);
+		CHECK(mismatches == 0);
+
+		gMPQIndex.clear();
+		archive->close();
+		gOpenArchives.clear();
+		delete archive;
+	}
+
+	gThreadPool.shutdown();
+	remove(archiveName);
+
+	printf("mpq_stress_test: %d failures\n", checkFailures());
+	return checkFailures() != 0;
+}
@@ -0,0 +1,77 @@
+// A lazy MPQFile whose first sector does not decompress: getBuffer() and
+// getPointer() must give NULL and set eof instead of handing out the
+// bytes nobody wrote, and read() must read nothing there. The sectors
+// that are fine still read as they went in.
+#include "check.h"
+#include "mpqwriter.h"
+#include "mpq.h"
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const char *archiveName = "mpqfile_test.mpq";
+const char *fileName = "World\\Test\\damaged.bin";
+
+// overwrites part of the first sector's zlib stream; the file starts right
+// after the 32 byte header with its sector offset table
+bool damage(size_t sectors)
+{
+	FILE *f = fopen(archiveName, "r+b");
+	if (!f) return false;
+	unsigned char junk[16];
+	memset(junk, 0x5a, sizeof(junk));
+	bool ok = fseek(f, (long)(32 + (sectors + 1) * 4 + 40), SEEK_SET) == 0 && fwrite(junk, 1, sizeof(junk), f) == sizeof(junk);
+	fclose(f);
+	return ok;
+}
+
+}
+
+int main()
+{
+	// 16 sectors of 4 KB that compress, but not to nothing
+	TestRandom rnd(9);
+	std::vector<unsigned char> data(16 * 4096);
+	for (size_t i=0; i<data.size(); i++) {
+		data[i] = (rnd.next() % 10 < 8) ? (unsigned char)('a' + rnd.next() % 8) : (unsigned char)rnd.next();
+	}
+	MPQWriter w;
+	w.add(fileName, data);
+	CHECK(w.write(archiveName));
+	CHECK(damage(16));
+
+	gMPQCache.setBudget(0);
+	{
+		MPQArchive archive(archiveName);
+		gMPQIndex.build();
+
+		{
+			MPQFile f(fileName, true);
+			CHECK(!f.isEof() && f.getSize() == data.size());
+			// past the damage first
+			f.seek(8192);
+			const char *p = f.getPointer(4096);
+			CHECK(p && memcmp(p, &data[8192], 4096) == 0);
+			CHECK(!f.isEof());
+			CHECK(f.getBuffer() == 0 && f.isEof());
+		}
+		{
+			MPQFile f(fileName, true);
+			CHECK(f.getPointer() == 0 && f.isEof());
+		}
+		{
+			MPQFile f(fileName, true);
+			char buf[100];
+			CHECK(f.read(buf, sizeof(buf)) == 0 && f.isEof());
+			f.seek(4096);
+			CHECK(f.read(buf, sizeof(buf)) == sizeof(buf) && memcmp(buf, &data[4096], sizeof(buf)) == 0);
+		}
+
+		gMPQIndex.clear();
+		archive.close();
+		gOpenArchives.clear();
+	}
+	remove(archiveName);
+	return checkFailures() != 0;
+}
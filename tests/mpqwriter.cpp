@@ -0,0 +1,186 @@
+#include "mpqwriter.h"
+#include "implode.h"
+#include <zlib.h>
+#include <bzlib.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+struct CryptTable {
+	unsigned int v[0x500];
+
+	CryptTable()
+	{
+		unsigned int seed = 0x00100001;
+		for (int i=0; i<0x100; i++) {
+			for (int j=0, k=i; j<5; j++, k+=0x100) {
+				seed = (seed * 125 + 3) % 0x2AAAAB;
+				unsigned int hi = (seed & 0xFFFF) << 16;
+				seed = (seed * 125 + 3) % 0x2AAAAB;
+				v[k] = hi | (seed & 0xFFFF);
+			}
+		}
+	}
+};
+
+const CryptTable &cryptTable()
+{
+	static const CryptTable t;
+	return t;
+}
+
+unsigned int hashString(const std::string &s, unsigned int type)
+{
+	const unsigned int *t = cryptTable().v;
+	unsigned int seed1 = 0x7FED7FED, seed2 = 0xEEEEEEEE;
+	for (size_t i=0; i<s.size(); i++) {
+		unsigned int c = (unsigned char)s[i];
+		if (c >= 'a' && c <= 'z') c -= 'a' - 'A';
+		seed1 = t[type + c] ^ (seed1 + seed2);
+		seed2 = c + seed1 + seed2 + (seed2 << 5) + 3;
+	}
+	return seed1;
+}
+
+void encrypt(std::vector<unsigned int> &data, unsigned int key)
+{
+	const unsigned int *t = cryptTable().v;
+	unsigned int seed = 0xEEEEEEEE;
+	for (size_t i=0; i<data.size(); i++) {
+		unsigned int v = data[i];
+		seed += t[0x400 + (key & 0xFF)];
+		data[i] = v ^ (key + seed);
+		key = ((~key << 0x15) + 0x11111111) | (key >> 0x0B);
+		seed = v + seed + (seed << 5) + 3;
+	}
+}
+
+void put32(std::vector<unsigned char> &out, unsigned int v)
+{
+	for (int i=0; i<4; i++) out.push_back((unsigned char)(v >> (i * 8)));
+}
+
+// the sector with its compression mask in front, or as it was if that isn't smaller
+std::vector<unsigned char> compress(const unsigned char *data, size_t size, MPQWriter::Compression c)
+{
+	std::vector<unsigned char> out;
+	if (c == MPQWriter::ZLIB) {
+		uLongf len = compressBound((uLong)size);
+		out.resize(1 + len);
+		out[0] = 0x02;
+		if (compress2(&out[1], &len, data, (uLong)size, Z_DEFAULT_COMPRESSION) != Z_OK) len = (uLongf)size;
+		out.resize(1 + len);
+	} else if (c == MPQWriter::BZIP2) {
+		unsigned int len = (unsigned int)(size + size / 100 + 600);
+		out.resize(1 + len);
+		out[0] = 0x10;
+		if (BZ2_bzBuffToBuffCompress((char*)&out[1], &len, (char*)data, (unsigned int)size, 9, 0, 0) != BZ_OK) len = (unsigned int)size;
+		out.resize(1 + len);
+	} else if (c == MPQWriter::PKZIP) {
+		out = implode(data, size, false, 6);
+		out.insert(out.begin(), 0x08);
+	}
+	if (c == MPQWriter::NONE || out.size() >= size) out.assign(data, data + size);
+	return out;
+}
+
+}
+
+MPQWriter::MPQWriter(int sectorShift): sectorShift(sectorShift)
+{
+}
+
+void MPQWriter::add(const std::string &name, const std::vector<unsigned char> &data, Compression c, bool singleUnit)
+{
+	const unsigned char *p = data.empty() ? 0 : &data[0];
+	Block b;
+	b.offset = 32 + (unsigned int)body.size();
+	b.fsize = (unsigned int)data.size();
+	b.flags = 0x80000000;
+
+	if (c == NONE) {
+		body.insert(body.end(), data.begin(), data.end());
+		b.csize = b.fsize;
+	} else if (singleUnit) {
+		std::vector<unsigned char> s = compress(p, data.size(), c);
+		body.insert(body.end(), s.begin(), s.end());
+		b.csize = (unsigned int)s.size();
+		b.flags |= 0x200 | 0x01000000;
+	} else {
+		size_t sector = 512 << sectorShift;
+		size_t n = (data.size() + sector - 1) / sector;
+		std::vector<unsigned char> sectors;
+		std::vector<unsigned int> offsets;
+		unsigned int pos = (unsigned int)(n + 1) * 4;
+		for (size_t i=0; i<n; i++) {
+			size_t len = std::min(sector, data.size() - i * sector);
+			std::vector<unsigned char> s = compress(p + i * sector, len, c);
+			offsets.push_back(pos);
+			sectors.insert(sectors.end(), s.begin(), s.end());
+			pos += (unsigned int)s.size();
+		}
+		offsets.push_back(pos);
+		for (size_t i=0; i<offsets.size(); i++) put32(body, offsets[i]);
+		body.insert(body.end(), sectors.begin(), sectors.end());
+		b.csize = pos;
+		b.flags |= 0x200;
+	}
+
+	names.push_back(name);
+	blocks.push_back(b);
+}
+
+bool MPQWriter::write(const char *path) const
+{
+	unsigned int hashCount = 1;
+	while (hashCount < names.size() * 2) hashCount *= 2;
+
+	// hashA, hashB, locale and platform, block index
+	std::vector<unsigned int> hashes(hashCount * 4, 0xFFFFFFFF);
+	for (size_t i=0; i<names.size(); i++) {
+		unsigned int k = hashString(names[i], 0) & (hashCount - 1);
+		while (hashes[k*4 + 3] != 0xFFFFFFFF) k = (k + 1) & (hashCount - 1);
+		hashes[k*4] = hashString(names[i], 0x100);
+		hashes[k*4 + 1] = hashString(names[i], 0x200);
+		hashes[k*4 + 2] = 0;
+		hashes[k*4 + 3] = (unsigned int)i;
+	}
+
+	std::vector<unsigned int> table;
+	for (size_t i=0; i<blocks.size(); i++) {
+		table.push_back(blocks[i].offset);
+		table.push_back(blocks[i].csize);
+		table.push_back(blocks[i].fsize);
+		table.push_back(blocks[i].flags);
+	}
+
+	encrypt(hashes, hashString("(hash table)", 0x300));
+	encrypt(table, hashString("(block table)", 0x300));
+
+	unsigned int hashOffset = 32 + (unsigned int)body.size();
+	unsigned int blockOffset = hashOffset + hashCount * 16;
+
+	std::vector<unsigned char> out;
+	out.insert(out.end(), "MPQ\x1a", "MPQ\x1a" + 4);
+	put32(out, 32);
+	put32(out, blockOffset + (unsigned int)blocks.size() * 16);
+	// format version 0, then the sector shift
+	out.push_back(0);
+	out.push_back(0);
+	out.push_back((unsigned char)sectorShift);
+	out.push_back(0);
+	put32(out, hashOffset);
+	put32(out, blockOffset);
+	put32(out, hashCount);
+	put32(out, (unsigned int)blocks.size());
+	out.insert(out.end(), body.begin(), body.end());
+	for (size_t i=0; i<hashes.size(); i++) put32(out, hashes[i]);
+	for (size_t i=0; i<table.size(); i++) put32(out, table[i]);
+
+	FILE *f = fopen(path, "wb");
+	if (!f) return false;
+	bool ok = fwrite(&out[0], 1, out.size(), f) == out.size();
+	return fclose(f) == 0 && ok;
+}
@@ -0,0 +1,33 @@
+#ifndef MPQWRITER_H
+#define MPQWRITER_H
+
+#include <string>
+#include <vector>
+
+// Writes small MPQ archives (format 0, no encrypted files) for the tests
+// to open with MPQArchive. Sectors are stored compressed only when that
+// makes them smaller, like the real tools do; PKZIP sectors are binary
+// mode with a 4 KB dictionary.
+class MPQWriter {
+public:
+	enum Compression { NONE, ZLIB, BZIP2, PKZIP };
+
+	// sectors are 512 << sectorShift bytes
+	MPQWriter(int sectorShift = 3);
+
+	// singleUnit stores the file as one compressed block without a sector table
+	void add(const std::string &name, const std::vector<unsigned char> &data, Compression c = ZLIB, bool singleUnit = false);
+	bool write(const char *path) const;
+
+private:
+	struct Block {
+		unsigned int offset, csize, fsize, flags;
+	};
+
+	int sectorShift;
+	std::vector<std::string> names;
+	std::vector<Block> blocks;
+	std::vector<unsigned char> body;
+};
+
+#endif
@@ -0,0 +1,221 @@
+// OcclusionBuffer without a GPU: a wall hides the boxes behind it and
+// nothing else, back faces hide nothing, and the buffer and its pyramid
+// come out the same on the calling thread alone and with four workers.
+// Also the terrain occluder, which must leave out the chunks it is told
+// to and the holes, and stay under the ground.
+#include "check.h"
+#include "occlusion.h"
+#include "heightfield.h"
+#include "threadpool.h"
+#include <math.h>
+#include <string.h>
+
+namespace {
+
+// from the origin down -z, 90 degrees high and twice as wide, near 1, far 1000
+void perspective(float *m)
+{
+	const float n = 1, f = 1000;
+	for (int i=0; i<16; i++) m[i] = 0;
+	m[0] = 0.5f;
+	m[5] = 1;
+	m[10] = (f + n) / (n - f);
+	m[11] = -1;
+	m[14] = 2 * f * n / (n - f);
+}
+
+// at depth z, facing the camera unless flipped
+void addWall(OcclusionBuffer &ob, float x0, float x1, float y0, float y1, float z, bool flipped = false)
+{
+	const Vec3D verts[4] = {Vec3D(x0, y0, z), Vec3D(x1, y0, z), Vec3D(x1, y1, z), Vec3D(x0, y1, z)};
+	const unsigned short front[6] = {0, 1, 2, 0, 2, 3}, back[6] = {0, 2, 1, 0, 3, 2};
+	ob.addTriangles(verts, 4, flipped ? back : front, 2);
+}
+
+bool visible(OcclusionBuffer &ob, float x0, float y0, float z0, float x1, float y1, float z1)
+{
+	return ob.visible(Vec3D(x0, y0, z0), Vec3D(x1, y1, z1));
+}
+
+void wall()
+{
+	float m[16];
+	perspective(m);
+	OcclusionBuffer ob;
+
+	// nothing drawn yet
+	ob.begin(m);
+	CHECK(visible(ob, -1, -1, -41, 1, 1, -39));
+
+	addWall(ob, -10, 10, -5, 5, -20);
+	ob.finish();
+	CHECK(ob.getStats().triangles == 2);
+
+	// behind it, small, big and far
+	CHECK(!visible(ob, -1, -1, -41, 1, 1, -39));
+	CHECK(!visible(ob, -10, -4, -50, 10, 4, -45));
+	CHECK(!visible(ob, -1, -1, -900, 1, 1, -800));
+	// in front of it, beside it, peeking over it, wider than it
+	CHECK(visible(ob, -1, -1, -16, 1, 1, -14));
+	CHECK(visible(ob, 29, -1, -41, 31, 1, -39));
+	CHECK(visible(ob, -1, 3, -41, 1, 12, -39));
+	CHECK(visible(ob, -25, -1, -41, 25, 1, -39));
+	// through it, and from behind it to behind the camera
+	CHECK(visible(ob, -1, -1, -25, 1, 1, -18));
+	CHECK(visible(ob, -1, -1, -30, 1, 1, 0.5f));
+	CHECK(visible(ob, -1, -1, -30, 1, 1, 5));
+	CHECK(ob.getStats().hidden == 3 && ob.getStats().tested == 11);
+
+	ob.clear();
+	CHECK(visible(ob, -1, -1, -41, 1, 1, -39));
+}
+
+void backFaces()
+{
+	float m[16];
+	perspective(m);
+	OcclusionBuffer ob;
+	ob.begin(m);
+	addWall(ob, -10, 10, -5, 5, -20, true);
+	ob.finish();
+	CHECK(ob.getStats().triangles == 0);
+	CHECK(visible(ob, -1, -1, -41, 1, 1, -39));
+	const float *d = ob.getDepth();
+	bool empty = true;
+	for (int i=0; i<OcclusionBuffer::WIDTH * OcclusionBuffer::HEIGHT; i++) empty = empty && d[i] == 0;
+	CHECK(empty);
+}
+
+// an occluder reaching behind the camera is cut at the near plane and
+// still hides what is behind the part in front
+void nearPlane()
+{
+	float m[16];
+	perspective(m);
+	OcclusionBuffer ob;
+	ob.begin(m);
+	// a floor under the camera, from behind it out to z = -100
+	const Vec3D verts[4] = {Vec3D(-50, -2, 10), Vec3D(50, -2, 10), Vec3D(50, -2, -100), Vec3D(-50, -2, -100)};
+	const unsigned short tris[6] = {0, 1, 2, 0, 2, 3};
+	ob.addTriangles(verts, 4, tris, 2);
+	ob.finish();
+	CHECK(ob.getStats().triangles > 2);
+	CHECK(!visible(ob, -1, -10, -41, 1, -8, -39));
+	CHECK(visible(ob, -1, -1, -41, 1, 1, -39));
+}
+
+struct Result {
+	std::vector<float> depth;
+	std::vector<std::vector<float> > levels;
+	std::vector<bool> visible;
+};
+
+Result scene(size_t workers)
+{
+	gThreadPool.shutdown();
+	gThreadPool.start((int)workers);
+	CHECK(gThreadPool.size() == workers);
+
+	float m[16];
+	perspective(m);
+	OcclusionBuffer ob;
+	ob.begin(m);
+	TestRandom rnd(5);
+	for (int k=0; k<300; k++) {
+		float x = rnd.uniform(-200, 200), y = rnd.uniform(-100, 100), z = rnd.uniform(-400, 3);
+		float s = rnd.uniform(1, 30);
+		addWall(ob, x, x + s, y, y + rnd.uniform(1, 30), z, k % 7 == 0);
+	}
+	ob.finish();
+
+	Result r;
+	r.depth.assign(ob.getDepth(), ob.getDepth() + OcclusionBuffer::WIDTH * OcclusionBuffer::HEIGHT);
+	for (size_t k=0; k<ob.getLevelCount(); k++) {
+		size_t n = (OcclusionBuffer::WIDTH >> k) * (OcclusionBuffer::HEIGHT >> k);
+		r.levels.push_back(std::vector<float>(ob.getLevel(k), ob.getLevel(k) + n));
+	}
+	for (int k=0; k<2000; k++) {
+		Vec3D c(rnd.uniform(-300, 300), rnd.uniform(-150, 150), rnd.uniform(-600, 0));
+		r.visible.push_back(ob.visibleSphere(c, rnd.uniform(0, 10)));
+	}
+	gThreadPool.shutdown();
+	return r;
+}
+
+bool sameBytes(const std::vector<float> &a, const std::vector<float> &b)
+{
+	return a.size() == b.size() && memcmp(&a[0], &b[0], a.size() * sizeof(float)) == 0;
+}
+
+void workers()
+{
+	Result alone = scene(0), four = scene(4);
+	CHECK(sameBytes(alone.depth, four.depth));
+	bool same = alone.levels.size() == four.levels.size();
+	for (size_t k=0; same && k<alone.levels.size(); k++) same = sameBytes(alone.levels[k], four.levels[k]);
+	CHECK(same);
+	CHECK(alone.visible == four.visible);
+
+	int hidden = 0;
+	for (size_t k=0; k<alone.visible.size(); k++) hidden += !alone.visible[k];
+	printf("%d of %u spheres hidden\n", hidden, (unsigned int)alone.visible.size());
+	CHECK(hidden > 0 && hidden < (int)alone.visible.size());
+}
+
+void terrain()
+{
+	// rolling ground, with a hole in chunk (3,4)
+	HeightField *hf = new HeightField;
+	ChunkData *d = new ChunkData;
+	for (int j=0; j<16; j++) {
+		for (int i=0; i<16; i++) {
+			for (int k=0; k<mapbufsize; k++) {
+				// rows of 9 outer vertices, then 8 inner ones between them
+				int row = k / 17, r = k % 17;
+				float x = r < 9 ? r : r - 9 + 0.5f, z = r < 9 ? row : row + 0.5f;
+				d->vertices[k].y = 10 * sinf((i*8 + x) * 0.1f) + 5 * cosf((j*8 + z) * 0.13f);
+			}
+			d->holes = (i == 3 && j == 4) ? 0x0001 : 0;
+			hf->set(i, j, *d);
+		}
+	}
+
+	// only the left half of the tile
+	bool show[16*16];
+	for (int k=0; k<16*16; k++) show[k] = (k % 16) < 8;
+	std::vector<Vec3D> verts;
+	std::vector<unsigned short> tris;
+	hf->occluder(0, 0, show, verts, tris);
+	// 8x16 chunks of 2x2 quads of two triangles, less the quad with the hole
+	CHECK(tris.size() == (8*16*4 - 1) * 2 * 3);
+
+	int outside = 0, above = 0;
+	for (size_t t=0; t<tris.size(); t+=3) {
+		Vec3D c = (verts[tris[t]] + verts[tris[t+1]] + verts[tris[t+2]]) * (1.0f / 3);
+		if (c.x / UNITSIZE >= 64) outside++;
+		for (int k=0; k<3; k++) {
+			const Vec3D &p = verts[tris[t+k]];
+			// under the ground at the corners, a little inside the triangle
+			Vec3D q = p + (c - p) * 0.01f;
+			float h;
+			if (hf->height(q.x / UNITSIZE, q.z / UNITSIZE, h) && q.y > h + 1e-3f) above++;
+		}
+	}
+	CHECK(outside == 0);
+	CHECK(above == 0);
+
+	delete hf;
+	delete d;
+}
+
+}
+
+int main()
+{
+	wall();
+	backFaces();
+	nearPlane();
+	workers();
+	terrain();
+	return checkFailures() != 0;
+}
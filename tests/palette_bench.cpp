@@ -0,0 +1,102 @@
+// Megapixels per second of expandPalette and of the per pixel loop it
+// replaced, on 256x256 and 512x512 mips with 0, 1, 4 and 8 bit alpha.
+// Before timing, both must give the same bytes on those and on odd sizes
+// (the old loop has no 4 bit alpha; there it must be n*0x11 per nibble).
+// usage: palette_bench [repeats]
+#include "check.h"
+#include "baseline/baseline.h"
+#include "palette.h"
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+
+const int alphas[] = {0, 1, 4, 8};
+
+// what decodeBLP does to the palette before expandPalette
+void swizzle(const unsigned int *pal, int alphabits, unsigned int *rgba)
+{
+	for (int i=0; i<256; i++) {
+		unsigned int k = pal[i];
+		k = ((k&0x00FF0000)>>16) | ((k&0x0000FF00)) | ((k& 0x000000FF)<<16);
+		rgba[i] = alphabits ? k : k | 0xFF000000;
+	}
+}
+
+// indices followed by a byte of alpha per pixel, as decodeBLP reads them
+std::vector<unsigned char> makeMip(int w, int h, TestRandom &rnd)
+{
+	std::vector<unsigned char> buf(w*h*2);
+	for (size_t i=0; i<buf.size(); i++) buf[i] = (unsigned char)rnd.next();
+	return buf;
+}
+
+bool same(const unsigned int *pal, int w, int h, int alphabits, TestRandom &rnd)
+{
+	std::vector<unsigned char> buf = makeMip(w, h, rnd);
+	unsigned int rgba[256];
+	swizzle(pal, alphabits, rgba);
+	std::vector<unsigned int> before(w*h), after(w*h);
+	expandPalette(rgba, &buf[0], &buf[0] + w*h, alphabits, w*h, &after[0]);
+	if (alphabits != 4) {
+		baseline_expandPalette(pal, &buf[0], w, h, alphabits, &before[0]);
+		return before == after;
+	}
+	for (int n=0; n<w*h; n++) {
+		unsigned int nibble = (buf[w*h + n/2] >> ((n&1)*4)) & 0x0f;
+		if (after[n] != ((rgba[buf[n]] & 0x00FFFFFF) | (nibble * 0x11) << 24)) return false;
+	}
+	return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : 200;
+
+	TestRandom rnd(3);
+	unsigned int pal[256];
+	for (int i=0; i<256; i++) pal[i] = rnd.next();
+
+	const int sizes[][2] = {{1, 1}, {3, 5}, {16, 1}, {17, 3}, {31, 33}, {64, 64}, {256, 256}, {512, 512}};
+	int differ = 0;
+	for (int k=0; k<4; k++) {
+		for (int s=0; s<8; s++) {
+			if (!same(pal, sizes[s][0], sizes[s][1], alphas[k], rnd)) {
+				printf("%d bit alpha, %dx%d differs\n", alphas[k], sizes[s][0], sizes[s][1]);
+				differ++;
+			}
+		}
+	}
+	CHECK(differ == 0);
+
+	printf("MP/s        alpha 0          alpha 1          alpha 4          alpha 8\n");
+	for (int size=256; size<=512; size*=2) {
+		int n = size * size;
+		std::vector<unsigned char> buf = makeMip(size, size, rnd);
+		std::vector<unsigned int> out(n);
+		double mp = (double)repeats * n / 1e6;
+
+		printf("%dx%d", size, size);
+		for (int k=0; k<4; k++) {
+			unsigned int rgba[256];
+			swizzle(pal, alphas[k], rgba);
+
+			double t0 = nowMs();
+			// the old loop has no 4 bit alpha, so only the new one is timed there
+			if (alphas[k] != 4) {
+				for (int r=0; r<repeats; r++) baseline_expandPalette(pal, &buf[0], size, size, alphas[k], &out[0]);
+			}
+			double t1 = nowMs();
+			for (int r=0; r<repeats; r++) expandPalette(rgba, &buf[0], &buf[0] + n, alphas[k], n, &out[0]);
+			double t2 = nowMs();
+
+			if (alphas[k] != 4) printf("  old %5.0f", mp / ((t1 - t0) / 1000));
+			else printf("  old     -");
+			printf(" new %5.0f", mp / ((t2 - t1) / 1000));
+		}
+		printf("\n");
+	}
+	return checkFailures() != 0;
+}
@@ -0,0 +1,226 @@
+// TriangleBVH::intersect and HeightField::raycast against trying every
+// triangle: the same rays must hit, at the same t, with and without a
+// limit on how far to look. Also how long a ray takes both ways.
+#include "check.h"
+#include "raycast.h"
+#include "heightfield.h"
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+namespace {
+
+// closest hit over all triangles, t as for rayTriangle
+bool bruteForce(const std::vector<Vec3D> &verts, const std::vector<unsigned short> &tris, const Vec3D &o, const Vec3D &d, float &t)
+{
+	bool hit = false;
+	for (size_t i=0; i<tris.size(); i+=3) {
+		if (rayTriangle(o, d, verts[tris[i]], verts[tris[i+1]], verts[tris[i+2]], t)) hit = true;
+	}
+	return hit;
+}
+
+Vec3D randomDirection(TestRandom &rnd)
+{
+	Vec3D d;
+	do {
+		d = Vec3D(rnd.uniform(-1, 1), rnd.uniform(-1, 1), rnd.uniform(-1, 1));
+	} while (d.lengthSquared() < 0.01f || d.lengthSquared() > 1);
+	return d.normalize();
+}
+
+bool same(bool hit0, float t0, bool hit1, float t1)
+{
+	return hit0 == hit1 && (!hit0 || fabsf(t0 - t1) <= 1e-4f * (1 + t0));
+}
+
+// small triangles in clusters, some of them in a pile on the same spot,
+// so that the tree gets both deep and lopsided
+void checkBVH()
+{
+	TestRandom rnd(11);
+	std::vector<Vec3D> verts;
+	std::vector<unsigned short> tris;
+	for (int k=0; k<6000; k++) {
+		Vec3D c;
+		if (k % 10 == 0) c = Vec3D(5, 5, 5);
+		else if (k % 3 == 0) c = Vec3D(rnd.uniform(-100, 100), rnd.uniform(-100, 100), rnd.uniform(-100, 100));
+		else c = Vec3D(rnd.uniform(20, 30), rnd.uniform(-30, -20), rnd.uniform(-5, 5));
+		for (int v=0; v<3; v++) {
+			tris.push_back((unsigned short)verts.size());
+			verts.push_back(c + Vec3D(rnd.uniform(-3, 3), rnd.uniform(-3, 3), rnd.uniform(-3, 3)));
+		}
+	}
+
+	std::vector<Vec3D> v = verts;
+	std::vector<unsigned short> t = tris;
+	TriangleBVH bvh;
+	bvh.assign(v, t);
+
+	const int rays = 20000;
+	std::vector<Vec3D> os(rays), ds(rays);
+	std::vector<float> tmax(rays);
+	for (int k=0; k<rays; k++) {
+		os[k] = Vec3D(rnd.uniform(-150, 150), rnd.uniform(-150, 150), rnd.uniform(-150, 150));
+		// every other one aimed at a point inside one of the triangles
+		if (k & 1) {
+			ds[k] = randomDirection(rnd);
+		} else {
+			size_t n = rnd.next() % (tris.size() / 3) * 3;
+			float a = rnd.uniform(0.05f, 0.9f), b = rnd.uniform(0.05f, 0.95f - a);
+			Vec3D p = verts[tris[n]] + (verts[tris[n+1]] - verts[tris[n]]) * a + (verts[tris[n+2]] - verts[tris[n]]) * b;
+			ds[k] = (p - os[k]).normalize();
+		}
+		// and some of those only looking part of the way
+		tmax[k] = k % 4 < 2 ? 1e30f : rnd.uniform(0, 200);
+	}
+	// straight along the axes, where 1/d is infinite
+	ds[1] = Vec3D(1, 0, 0);
+	ds[3] = Vec3D(0, -1, 0);
+	ds[5] = Vec3D(0, 0, 1);
+
+	int wrong = 0, hits = 0;
+	for (int k=0; k<rays; k++) {
+		float t0 = tmax[k], t1 = tmax[k];
+		bool h0 = bruteForce(verts, tris, os[k], ds[k], t0);
+		bool h1 = bvh.intersect(os[k], ds[k], t1);
+		if (!same(h0, t0, h1, t1)) wrong++;
+		if (h0) hits++;
+	}
+	CHECK(wrong == 0);
+	CHECK(hits > rays / 4 && hits < rays);
+
+	volatile float sink = 0;
+	double start = nowMs();
+	for (int k=0; k<rays; k++) {
+		float t0 = tmax[k];
+		if (bruteForce(verts, tris, os[k], ds[k], t0)) sink += t0;
+	}
+	double brute = nowMs() - start;
+	start = nowMs();
+	for (int k=0; k<rays; k++) {
+		float t1 = tmax[k];
+		if (bvh.intersect(os[k], ds[k], t1)) sink += t1;
+	}
+	double tree = nowMs() - start;
+	printf("%d triangles: every triangle %.1f us per ray, TriangleBVH %.2f us per ray\n",
+		(int)tris.size() / 3, brute * 1e3 / rays, tree * 1e3 / rays);
+}
+
+// A tile of rough terrain with holes, the edges the chunks share agreeing
+// as they do in real ADTs
+void makeTerrain(HeightField &hf, std::vector<float> &outer, std::vector<float> &inner, std::vector<int> &holes)
+{
+	TestRandom rnd(12);
+	outer.resize(129*129);
+	inner.resize(128*128);
+	holes.resize(16*16);
+	for (size_t k=0; k<outer.size(); k++) outer[k] = rnd.uniform(0, 40);
+	for (size_t k=0; k<inner.size(); k++) inner[k] = rnd.uniform(0, 40);
+	for (int k=0; k<16*16; k++) holes[k] = k % 5 == 0 ? (int)(rnd.next() & 0xffff) : 0;
+
+	ChunkData *c = new ChunkData;
+	for (int j=0; j<16; j++) {
+		for (int i=0; i<16; i++) {
+			for (int y=0; y<9; y++) {
+				for (int x=0; x<9; x++) c->vertices[y*17 + x].y = outer[(j*8 + y)*129 + i*8 + x];
+			}
+			for (int y=0; y<8; y++) {
+				for (int x=0; x<8; x++) c->vertices[y*17 + 9 + x].y = inner[(j*8 + y)*128 + i*8 + x];
+			}
+			c->holes = holes[j*16 + i];
+			hf.set(i, j, *c);
+		}
+	}
+	delete c;
+}
+
+// the four triangles of every cell of chunk (i,j) that is not a hole, in
+// world coordinates from the tile corner x0, z0
+void chunkTriangles(const std::vector<float> &outer, const std::vector<float> &inner, const std::vector<int> &holes,
+	int i, int j, float x0, float z0, std::vector<Vec3D> &verts, std::vector<unsigned short> &tris)
+{
+	verts.clear();
+	tris.clear();
+	for (int cj=j*8; cj<j*8+8; cj++) {
+		for (int ci=i*8; ci<i*8+8; ci++) {
+			if (holes[j*16 + i] & (1 << (((cj & 7) >> 1)*4 + ((ci & 7) >> 1)))) continue;
+			float x = x0 + ci*UNITSIZE, z = z0 + cj*UNITSIZE;
+			unsigned short a = (unsigned short)verts.size();
+			verts.push_back(Vec3D(x, outer[cj*129 + ci], z));
+			verts.push_back(Vec3D(x + UNITSIZE, outer[cj*129 + ci + 1], z));
+			verts.push_back(Vec3D(x + UNITSIZE, outer[(cj + 1)*129 + ci + 1], z + UNITSIZE));
+			verts.push_back(Vec3D(x, outer[(cj + 1)*129 + ci], z + UNITSIZE));
+			verts.push_back(Vec3D(x + UNITSIZE*0.5f, inner[cj*128 + ci], z + UNITSIZE*0.5f));
+			for (int k=0; k<4; k++) {
+				unsigned short t[3] = {(unsigned short)(a + k), (unsigned short)(a + (k + 1) % 4), (unsigned short)(a + 4)};
+				tris.insert(tris.end(), t, t + 3);
+			}
+		}
+	}
+}
+
+void checkHeightField()
+{
+	HeightField *hf = new HeightField;
+	std::vector<float> outer, inner;
+	std::vector<int> holes;
+	makeTerrain(*hf, outer, inner, holes);
+
+	const float x0 = 1000, z0 = -2000;
+	TestRandom rnd(13);
+	std::vector<Vec3D> verts;
+	std::vector<unsigned short> tris;
+	int wrong = 0, hits = 0, rays = 0;
+	for (int j=0; j<16; j++) {
+		for (int i=0; i<16; i++) {
+			chunkTriangles(outer, inner, holes, i, j, x0, z0, verts, tris);
+			Vec3D bmin(1e30f, 1e30f, 1e30f), bmax(-1e30f, -1e30f, -1e30f);
+			for (size_t n=0; n<verts.size(); n++) {
+				bmin = Vec3D(std::min(bmin.x, verts[n].x), std::min(bmin.y, verts[n].y), std::min(bmin.z, verts[n].z));
+				bmax = Vec3D(std::max(bmax.x, verts[n].x), std::max(bmax.y, verts[n].y), std::max(bmax.z, verts[n].z));
+			}
+			for (int k=0; k<200; k++, rays++) {
+				// from above the chunk or beside it: straight down, level with
+				// the ground, or mostly downwards
+				Vec3D o(x0 + (i*8 + rnd.uniform(-2, 10))*UNITSIZE, rnd.uniform(-10, 80), z0 + (j*8 + rnd.uniform(-2, 10))*UNITSIZE);
+				Vec3D d = randomDirection(rnd);
+				if (k % 7 == 0) d = Vec3D(0, -1, 0);
+				else if (k % 7 == 1) d = Vec3D(d.x, 0, 0).normalize();
+				else if (k % 7 == 2) d = Vec3D(0, 0, d.z).normalize();
+				else d.y = -fabsf(d.y) - 0.2f;
+				float tmax = k % 3 == 0 ? rnd.uniform(0, 150) : 1e30f;
+				// starting where the ray enters the chunk, as MapNode does
+				float tmin = 0, tfar = tmax;
+				Vec3D inv(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+				if (k & 1 && !verts.empty() && !rayBox(o, inv, bmin, bmax, tmin, tfar)) tmin = 0;
+
+				float t0 = tmax, t1 = tmax;
+				bool h0 = false;
+				for (size_t n=0; n<tris.size(); n+=3) {
+					float t = t0;
+					if (rayTriangle(o, d, verts[tris[n]], verts[tris[n+1]], verts[tris[n+2]], t) && t >= tmin) {
+						t0 = t;
+						h0 = true;
+					}
+				}
+				bool h1 = hf->raycast(i, j, o, d, x0, z0, tmin, t1);
+				if (!same(h0, t0, h1, t1)) { if (wrong < 8) printf("HF k %d h %d %d t %g %g tmin %g d %g %g %g\n", k, h0, h1, t0, t1, tmin, d.x, d.y, d.z); wrong++; }
+				if (h0) hits++;
+			}
+		}
+	}
+	CHECK(wrong == 0);
+	CHECK(hits > rays / 8 && hits < rays);
+	delete hf;
+}
+
+}
+
+int main()
+{
+	checkBVH();
+	checkHeightField();
+	printf("raycast_test: %d failures\n", checkFailures());
+	return checkFailures() != 0;
+}
@@ -0,0 +1,50 @@
+// What the tests need from wowmapview.cpp: the log, quiet unless TEST_VERBOSE
+// is set, and fixname, which leaves names as they were written.
+#include "wowmapview.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int gLogLevel = getenv("TEST_VERBOSE") ? LOG_DEBUG : LOG_ERROR;
+
+static void testLog(int level, const char *str, va_list ap)
+{
+	if (level > gLogLevel) return;
+	vprintf(str, ap);
+}
+
+void gLog(const char *str, ...)
+{
+	va_list ap;
+	va_start(ap, str);
+	testLog(LOG_INFO, str, ap);
+	va_end(ap);
+}
+
+void gLogError(const char *str, ...)
+{
+	va_list ap;
+	va_start(ap, str);
+	testLog(LOG_ERROR, str, ap);
+	va_end(ap);
+}
+
+void gLogNotice(const char *str, ...)
+{
+	va_list ap;
+	va_start(ap, str);
+	testLog(LOG_NOTICE, str, ap);
+	va_end(ap);
+}
+
+void gLogDebug(const char *str, ...)
+{
+	va_list ap;
+	va_start(ap, str);
+	testLog(LOG_DEBUG, str, ap);
+	va_end(ap);
+}
+
+void fixname(std::string &)
+{
+}
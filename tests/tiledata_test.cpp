@@ -0,0 +1,274 @@
+// Parses an ADT put together here, packed in an MPQ, with no GL context
+// and checks every one of its 256 chunks. Then the HeightField made from
+// them: height() against the triangles that are drawn and the holes, and
+// which quads the quarter hole masks keep for the occluder.
+#include "check.h"
+#include "adtwriter.h"
+#include "mpqwriter.h"
+#include "tiledata.h"
+#include "heightfield.h"
+#include "mpq.h"
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace {
+
+const char *adtName = "World\\Maps\\Test\\Test_30_31.adt";
+
+void checkChunk(const ChunkData &c, int i, int j, const ExpectedChunk &e)
+{
+	int n = j*16 + i;
+	float yb = (float)n;
+
+	CHECK(c.areaID == 100u + n);
+	CHECK(c.flags == (e.water ? 4u : 0u));
+	CHECK((c.holes != 0) == (n == 3));
+
+	CHECK(fabsf(c.xbase - (ZEROPOINT - (17066.66f - i * 33.3333f))) < 1e-2f);
+	CHECK(fabsf(c.zbase - (ZEROPOINT - (17066.66f - j * 33.3333f))) < 1e-2f);
+	CHECK(c.ybase == yb);
+
+	bool heights = true, grid = true, normals = true;
+	float lo = e.heights[0], hi = e.heights[0];
+	for (int k=0, row=0, col=0; k<mapbufsize; k++) {
+		heights = heights && c.vertices[k].y == yb + e.heights[k];
+		// rows of 9 and 8 in turn, the short ones offset by half a unit
+		float x = c.xbase + col * UNITSIZE + ((row % 2) ? UNITSIZE * 0.5f : 0);
+		float z = c.zbase + row * 0.5f * UNITSIZE;
+		grid = grid && fabsf(c.vertices[k].x - x) < 1e-3f && fabsf(c.vertices[k].z - z) < 1e-3f;
+		if (++col == ((row % 2) ? 8 : 9)) {
+			col = 0;
+			row++;
+		}
+		// stored Z, X, Y
+		const signed char *s = &e.normals[k*3];
+		normals = normals && c.normals[k].x == -s[1] / 127.0f && c.normals[k].y == s[2] / 127.0f && c.normals[k].z == -s[0] / 127.0f;
+		lo = std::min(lo, e.heights[k]);
+		hi = std::max(hi, e.heights[k]);
+	}
+	CHECK(heights);
+	CHECK(grid);
+	CHECK(normals);
+	CHECK(c.vmin.y == yb + lo && c.vmax.y == yb + hi && c.r > 0);
+
+	CHECK(c.nTextures == 2);
+	CHECK(c.textures[0] == 0 && c.textures[1] == 1);
+	CHECK(c.animated[0] == 0 && c.animated[1] == (0x80|3));
+
+	bool shadow = true;
+	for (int k=0; k<64*64; k++) shadow = shadow && c.shadow[k] == ((e.shadow[k / 8] & (1 << (k % 8))) ? 85 : 0);
+	CHECK(c.hasShadow && shadow);
+
+	bool alpha = true;
+	for (int k=0; k<0x800; k++) {
+		alpha = alpha && c.alphamaps[0][k*2] == (e.alpha[k] & 0x0f) << 4 && c.alphamaps[0][k*2 + 1] == (e.alpha[k] & 0xf0);
+	}
+	CHECK(alpha);
+
+	CHECK(c.haswater == e.water);
+	if (e.water) {
+		CHECK(c.waterlevel == -10.0f);
+		CHECK(c.liquid.size() == (size_t)liquidDataSize);
+		float h;
+		memcpy(&h, &c.liquid[80*8 + 4], 4);
+		CHECK(h == 81.0f && c.liquid[liquidDataSize - 1] == 15);
+	} else {
+		CHECK(c.liquid.empty());
+	}
+}
+
+// how MapChunk::initStrip leaves out a hole: bit j*4 + i covers cells
+// 2i..2i+1 across and 2j..2j+1 down
+bool isHole(int holes, int i, int j)
+{
+	return (holes & (0x1111 << i) & (0x000F << (j*4))) != 0;
+}
+
+// height at (x, z) on the plane of the triangle a, b, c, seen from above;
+// returns the smallest barycentric weight, negative outside the triangle
+float onTriangle(const Vec3D &a, const Vec3D &b, const Vec3D &c, float x, float z, float &h)
+{
+	float d = (b.x - a.x) * (c.z - a.z) - (c.x - a.x) * (b.z - a.z);
+	float s = ((x - a.x) * (c.z - a.z) - (c.x - a.x) * (z - a.z)) / d;
+	float t = ((b.x - a.x) * (z - a.z) - (x - a.x) * (b.z - a.z)) / d;
+	h = a.y + (b.y - a.y) * s + (c.y - a.y) * t;
+	return std::min(std::min(s, t), 1 - s - t);
+}
+
+// Outer vertex (gx, gz) of the tile. Neighbouring chunks share their
+// edges; the random test chunks don't agree on them, and the one set last
+// (the later row, then the later column) is what the HeightField holds.
+float outerHeight(const TileData &d, int gx, int gz)
+{
+	int i = std::min(gx / 8, 15), j = std::min(gz / 8, 15);
+	return d.chunks[j][i].vertices[(gz - j*8)*17 + gx - i*8].y;
+}
+
+// HeightField::height against the four triangles each cell is drawn as,
+// fanned around its inner vertex, in the cell's own units
+void checkHeights(const TileData &d, HeightField &hf)
+{
+	TestRandom rnd(4);
+	int wrong = 0, holes = 0, outside = 0;
+	for (int k=0; k<200000; k++) {
+		float u = rnd.uniform(0, 128), v = rnd.uniform(0, 128);
+		int ci = (int)u, cj = (int)v;
+		const ChunkData &c = d.chunks[cj >> 3][ci >> 3];
+		int x = ci & 7, y = cj & 7;
+		bool hole = isHole(c.holes, x >> 1, y >> 1);
+
+		float h;
+		bool found = hf.height(u, v, h);
+		if (hole) {
+			holes++;
+			if (found) wrong++;
+			continue;
+		}
+		if (!found) {
+			wrong++;
+			continue;
+		}
+
+		Vec3D o00(0, outerHeight(d, ci, cj), 0), o10(1, outerHeight(d, ci + 1, cj), 0);
+		Vec3D o01(0, outerHeight(d, ci, cj + 1), 1), o11(1, outerHeight(d, ci + 1, cj + 1), 1);
+		Vec3D m(0.5f, c.vertices[y*17 + 9 + x].y, 0.5f);
+		float fx = u - ci, fz = v - cj;
+		// on an edge both triangles agree, so the one the point is deepest in
+		const Vec3D fan[5] = { o00, o10, o11, o01, o00 };
+		float expected = 0, best = -1;
+		for (int t=0; t<4; t++) {
+			float e, w = onTriangle(fan[t], fan[t + 1], m, fx, fz, e);
+			if (w > best) {
+				best = w;
+				expected = e;
+			}
+		}
+		if (best < -1e-4f) {
+			outside++;
+			continue;
+		}
+		if (fabsf(h - expected) > 1e-2f) wrong++;
+	}
+	CHECK(wrong == 0 && outside == 0);
+	// chunk 3 has a column of holes
+	CHECK(holes > 0);
+
+	float h;
+	CHECK(!hf.height(-0.01f, 5, h) && !hf.height(5, 128, h) && !hf.height(NAN, 5, h));
+
+	const int queries = 1000000;
+	std::vector<float> us(queries), vs(queries);
+	for (int k=0; k<queries; k++) {
+		us[k] = rnd.uniform(0, 128);
+		vs[k] = rnd.uniform(0, 128);
+	}
+	volatile float sink = 0;
+	double t0 = nowMs();
+	for (int k=0; k<queries; k++) {
+		if (hf.height(us[k], vs[k], h)) sink += h;
+	}
+	printf("HeightField::height: %.1f ns per query\n", (nowMs() - t0) * 1e6 / queries);
+}
+
+// The occluder keeps a 4x4 cell quad exactly when none of its four hole
+// bits are set, which is what the quarter masks of set() decide
+void checkHoleQuarters()
+{
+	HeightField *hf = new HeightField;
+	ChunkData *c = new ChunkData;
+	bool show[16*16];
+	for (int k=0; k<16*16; k++) show[k] = k == 0;
+	std::vector<Vec3D> verts;
+	std::vector<unsigned short> tris;
+
+	TestRandom rnd(6);
+	int wrong = 0;
+	for (int n=0; n<64; n++) {
+		c->holes = n < 16 ? 1 << n : (int)(rnd.next() & 0xffff);
+		hf->set(0, 0, *c);
+		hf->occluder(0, 0, show, verts, tris);
+
+		for (int qz=0; qz<2; qz++) {
+			for (int qx=0; qx<2; qx++) {
+				bool hole = false;
+				for (int k=0; k<4; k++) hole = hole || isHole(c->holes, qx*2 + (k & 1), qz*2 + (k >> 1));
+				// the quad's first corner
+				unsigned short a = (unsigned short)(qz*33 + qx);
+				bool kept = false;
+				for (size_t t=0; t<tris.size(); t+=6) kept = kept || tris[t] == a;
+				if (kept == hole) wrong++;
+			}
+		}
+	}
+	CHECK(wrong == 0);
+	delete hf;
+	delete c;
+}
+
+}
+
+int main()
+{
+	static ExpectedChunk expected[256];
+	Bytes adt = makeAdt(expected);
+
+	MPQWriter w;
+	w.add(adtName, adt);
+	w.add("World\\wmo\\Azeroth\\House.wmo", std::vector<unsigned char>(64, 'x'));
+	CHECK(w.write("tiledata_test.mpq"));
+
+	{
+		MPQArchive archive("tiledata_test.mpq");
+		gMPQIndex.build();
+
+		TileData *d = new TileData;
+		CHECK(d->parse(30, 31, adtName));
+		CHECK(d->ok && d->x == 30 && d->z == 31);
+
+		CHECK(d->textures.size() == 2 && d->textures[1] == "Tileset\\Elwynn\\ElwynnDirt.blp");
+		CHECK(d->models.size() == 1 && d->models[0] == "World\\Azeroth\\Tree.mdx");
+		// the missing WMO is left empty
+		CHECK(d->wmos.size() == 2 && d->wmos[0] == "World\\wmo\\Azeroth\\House.wmo" && d->wmos[1].empty());
+
+		CHECK(d->modelPlacements.size() == 1);
+		if (d->modelPlacements.size() == 1) {
+			const ModelPlacement &m = d->modelPlacements[0];
+			CHECK(m.name == 0 && m.d1 == 7 && m.scale == 2048);
+			CHECK(m.pos.x == 1 && m.pos.y == 2 && m.pos.z == 3 && m.dir.x == 4 && m.dir.y == 5 && m.dir.z == 6);
+		}
+		CHECK(d->wmoPlacements.size() == 2);
+		if (d->wmoPlacements.size() == 2) {
+			const WMOPlacement &p = d->wmoPlacements[0];
+			CHECK(p.name == 0 && p.id == 9 && p.d2 == 0x30000);
+			CHECK(p.pos.x == 10 && p.pos.y == 20 && p.pos.z == 30 && p.pos2.x == 1 && p.pos3.z == 2);
+			CHECK(d->wmoPlacements[1].name == 1 && d->wmoPlacements[1].id == 11);
+		}
+
+		for (int j=0; j<16; j++) {
+			for (int i=0; i<16; i++) {
+				checkChunk(d->chunks[j][i], i, j, expected[j*16 + i]);
+			}
+		}
+
+		HeightField *hf = new HeightField;
+		for (int j=0; j<16; j++) {
+			for (int i=0; i<16; i++) hf->set(i, j, d->chunks[j][i]);
+		}
+		checkHeights(*d, *hf);
+		delete hf;
+		checkHoleQuarters();
+		delete d;
+
+		TileData missing;
+		CHECK(!missing.parse(1, 2, "World\\Maps\\Test\\Test_1_2.adt") && !missing.ok);
+
+		gMPQIndex.clear();
+		archive.close();
+		gOpenArchives.clear();
+	}
+	remove("tiledata_test.mpq");
+
+	printf("tiledata_test: %d failures\n", checkFailures());
+	return checkFailures() != 0;
+}
@@ -0,0 +1,88 @@
+// What TileStreamer counts against the tile memory budget while tiles are
+// queued, dropped, wanted again, parsed and taken. The only worker is kept
+// busy until the test lets it go, so the queued states last as long as
+// the test needs them to.
+#include "check.h"
+#include "adtwriter.h"
+#include "mpqwriter.h"
+#include "tilestream.h"
+#include "threadpool.h"
+#include "mpq.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+
+const char *archiveName = "tilestream_test.mpq";
+
+void waitWarm(TileStreamer &s, int x, int z)
+{
+	for (int k=0; k<10000 && !s.isWarm(x, z); k++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+}
+
+int main()
+{
+	static ExpectedChunk expected[256];
+	MPQWriter w;
+	w.add("World\\Maps\\Test\\Test_30_31.adt", makeAdt(expected));
+	w.add("World\\Maps\\Test\\Test_31_31.adt", makeAdt(expected));
+	CHECK(w.write(archiveName));
+
+	gThreadPool.start(1);
+	{
+		MPQArchive archive(archiveName);
+		gMPQIndex.build();
+
+		{
+			TileStreamer s("Test");
+			const size_t tile = sizeof(TileData);
+
+			std::atomic<bool> hold(true);
+			gThreadPool.push([&hold] { while (hold) std::this_thread::yield(); });
+
+			CHECK(s.prefetch(30, 31));
+			CHECK(!s.prefetch(30, 31));
+			CHECK(s.pendingBytes() == tile);
+
+			// forgotten while queued: the job still runs but holds nothing
+			s.forget(30, 31);
+			CHECK(s.pendingBytes() == 0);
+			// wanted again before it ran, it counts again
+			CHECK(s.prefetch(30, 31));
+			CHECK(s.pendingBytes() == tile);
+
+			CHECK(s.prefetch(31, 31));
+			CHECK(s.pendingBytes() == 2 * tile);
+			s.forget(31, 31);
+			CHECK(s.pendingBytes() == tile);
+
+			hold = false;
+			waitWarm(s, 30, 31);
+			CHECK(s.isWarm(30, 31) && !s.isWarm(31, 31));
+			// parsed and waiting, once
+			CHECK(s.pendingBytes() == tile);
+
+			TileData *d = s.take(30, 31);
+			CHECK(d && d->ok);
+			delete d;
+			CHECK(s.pendingBytes() == 0);
+
+			// the dropped one is gone once its job ran, and can come back
+			while (gThreadPool.pending() > 0) std::this_thread::yield();
+			CHECK(s.prefetch(31, 31));
+			waitWarm(s, 31, 31);
+			CHECK(s.pendingBytes() == tile);
+			s.forget(31, 31);
+			CHECK(s.pendingBytes() == 0);
+		}
+
+		gThreadPool.shutdown();
+		gMPQIndex.clear();
+		archive.close();
+		gOpenArchives.clear();
+	}
+	remove(archiveName);
+	return checkFailures() != 0;
+}
@@ -0,0 +1,160 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool gThreadPool;
+
+ThreadPool::ThreadPool() : stop(false)
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+    shutdown();
+}
+
+void ThreadPool::start(int threads)
+{
+    if (!workers.empty())
+        return;
+
+    if (threads < 0)
+    {
+        int hw = (int)std::thread::hardware_concurrency();
+        threads = hw > 1 ? hw - 1 : 1;
+    }
+
+    stop = false;
+    for (int i = 0; i < threads; i++)
+        workers.push_back(std::thread(&ThreadPool::WorkerThread, this));
+}
+
+void ThreadPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+        lowJobs.clear();
+    }
+    wake.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+    workers.clear();
+}
+
+void ThreadPool::push(const Job& job)
+{
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    wake.notify_one();
+}
+
+void ThreadPool::pushLow(const Job& job)
+{
+    if (workers.empty())
+    {
+        job();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lowJobs.push_back(job);
+    }
+    wake.notify_one();
+}
+
+size_t ThreadPool::pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + lowJobs.size();
+}
+
+void ThreadPool::WorkerThread()
+{
+    for (;;)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stop || !jobs.empty() || !lowJobs.empty(); });
+
+            // finish what was queued before shutting down
+            std::deque<Job>& queue = jobs.empty() ? lowJobs : jobs;
+            if (queue.empty())
+                return;
+
+            job = queue.front();
+            queue.pop_front();
+        }
+        job();
+    }
+}
+
+namespace
+{
+    struct ParallelForState
+    {
+        std::atomic<size_t> next;
+        size_t count, done;
+        const std::function<void(size_t)>* fn;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        // returns once no indices are left to claim
+        void run()
+        {
+            size_t i;
+            while ((i = next++) < count)
+            {
+                (*fn)(i);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++done == count)
+                    finished.notify_all();
+            }
+        }
+    };
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn)
+{
+    if (count == 0)
+        return;
+
+    if (workers.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    // helpers that only get to run after everything is done find no index
+    // left and never touch fn, so the state just has to outlive them
+    std::shared_ptr<ParallelForState> state = std::make_shared<ParallelForState>();
+    state->next = 0;
+    state->count = count;
+    state->done = 0;
+    state->fn = &fn;
+
+    size_t helpers = std::min(count - 1, workers.size());
+    for (size_t i = 0; i < helpers; i++)
+        push([state] { state->run(); });
+
+    // the caller works too, which also keeps nested calls from a worker
+    // thread from waiting on a pool that is busy with its own caller
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->done == state->count; });
+}
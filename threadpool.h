@@ -0,0 +1,51 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads draining a FIFO of jobs, and a second one of
+// jobs that can wait. Until start() is called (or with zero workers) jobs
+// simply run on the calling thread.
+class ThreadPool
+{
+    public:
+        typedef std::function<void()> Job;
+
+        ThreadPool();
+        ~ThreadPool();
+
+        // threads < 0 picks one less than the number of hardware threads,
+        // 0 starts none, so that every job runs inline in push()
+        void start(int threads = -1);
+        void shutdown();
+
+        void push(const Job& job);
+        // only taken once no push()ed job is waiting; the ones still
+        // waiting at shutdown() are dropped
+        void pushLow(const Job& job);
+
+        // Runs fn(0) .. fn(count-1) on the workers and the calling thread and
+        // returns once all of them finished. Safe to call from a worker.
+        void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+        size_t size() const { return workers.size(); }
+        size_t pending() const;
+
+    private:
+        void WorkerThread();
+
+        std::vector<std::thread> workers;
+        std::deque<Job> jobs, lowJobs;
+        mutable std::mutex mutex;
+        std::condition_variable wake;
+        bool stop;
+};
+
+extern ThreadPool gThreadPool;
+
+#endif
@@ -0,0 +1,101 @@
+#include "tilecache.h"
+#include <chrono>
+
+size_t TileCache::memoryBudget = 64 * 1024 * 1024;
+
+TileCache::TileCache(): releasing(false), evictions(0)
+{
+	for (int j=0; j<64; j++) {
+		for (int i=0; i<64; i++) {
+			tiles[j][i] = 0;
+		}
+	}
+}
+
+MapTile *TileCache::find(int x, int z)
+{
+	if (x < 0 || z < 0 || x >= 64 || z >= 64) return 0;
+	if (tiles[z][x]) return tiles[z][x];
+
+	for (std::deque<MapTile*>::iterator it = dropped.begin(); it != dropped.end(); ++it) {
+		if ((*it)->x != x || (*it)->z != z) continue;
+		if (it == dropped.begin() && releasing) return 0;
+		MapTile *tile = *it;
+		dropped.erase(it);
+		insert(tile);
+		return tile;
+	}
+	return 0;
+}
+
+void TileCache::insert(MapTile *tile)
+{
+	tiles[tile->z][tile->x] = tile;
+	resident.push_back(tile);
+}
+
+void TileCache::remove(MapTile *tile)
+{
+	tiles[tile->z][tile->x] = 0;
+	for (size_t i=0; i<resident.size(); i++) {
+		if (resident[i] == tile) {
+			resident[i] = resident.back();
+			resident.pop_back();
+			break;
+		}
+	}
+}
+
+size_t TileCache::bytes() const
+{
+	size_t total = 0;
+	for (size_t i=0; i<resident.size(); i++) total += resident[i]->memory().total();
+	return total;
+}
+
+void TileCache::collect(float budgetMs)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (bool first = true; !dropped.empty(); first = false) {
+		float left = 0;
+		if (budgetMs > 0) {
+			left = budgetMs - std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+			// at least one step per call, or slow frames would never get rid of anything
+			if (left <= 0) {
+				if (!first) return;
+				left = 0.001f;
+			}
+		}
+
+		MapTile *tile = dropped.front();
+		releasing = true;
+		if (!tile->release(left)) return;
+
+		delete tile;
+		dropped.pop_front();
+		releasing = false;
+	}
+}
+
+void TileCache::clear()
+{
+	for (size_t i=0; i<resident.size(); i++) {
+		MapTile *tile = resident[i];
+		tiles[tile->z][tile->x] = 0;
+		dropped.push_back(tile);
+	}
+	resident.clear();
+	collect(0);
+}
+
+TileCache::Stats TileCache::getStats() const
+{
+	Stats st;
+	st.tiles = resident.size();
+	st.bytes = bytes();
+	st.budget = memoryBudget;
+	st.dropped = dropped.size();
+	st.evictions = evictions;
+	return st;
+}
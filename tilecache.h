@@ -0,0 +1,83 @@
+#ifndef TILECACHE_H
+#define TILECACHE_H
+
+#include "maptile.h"
+#include <vector>
+#include <deque>
+
+// The loaded map tiles by coordinate, held to a memory budget.
+//
+// World puts every tile it loads in here and calls evict() until the
+// cache fits; an evicted tile is only queued, collect() releases the
+// queue a budgeted slice per frame so that leaving a dozen tiles behind
+// doesn't stall one. A tile asked for again before its release started
+// comes back as it was.
+class TileCache {
+	MapTile *tiles[64][64];
+	std::vector<MapTile*> resident;
+
+	// evicted, front first; the front one may be half released
+	std::deque<MapTile*> dropped;
+	bool releasing;
+
+	unsigned int evictions;
+
+	void remove(MapTile *tile);
+
+public:
+	struct Stats {
+		size_t tiles, bytes, budget;
+		size_t dropped;
+		unsigned int evictions;
+	};
+
+	// bytes of MapTile::Memory to keep, set before a world is loaded
+	static size_t memoryBudget;
+
+	TileCache();
+	// releases everything at once, call while the managers are still there
+	~TileCache() { clear(); }
+
+	MapTile *find(int x, int z);
+	// just the resident tile, for lookups that must not bring anything back
+	MapTile *peek(int x, int z) const { return tiles[z][x]; }
+	void insert(MapTile *tile);
+	const std::vector<MapTile*> &all() const { return resident; }
+
+	// MapTile::Memory of the resident tiles
+	size_t bytes() const;
+
+	// Takes the tile score() rates highest out of the cache, if the cache
+	// and pending bytes held elsewhere are over budget; tiles scored below
+	// zero stay regardless. Returns the evicted tile, which is still valid
+	// until collect() gets to it.
+	template <class SCORE>
+	MapTile *evict(SCORE score, size_t pending = 0)
+	{
+		if (bytes() + pending <= memoryBudget) return 0;
+
+		MapTile *worst = 0;
+		float maxscore = 0;
+		for (size_t i=0; i<resident.size(); i++) {
+			float s = score(resident[i]);
+			if (s >= 0 && (!worst || s > maxscore)) {
+				maxscore = s;
+				worst = resident[i];
+			}
+		}
+		if (worst) {
+			remove(worst);
+			dropped.push_back(worst);
+			evictions++;
+		}
+		return worst;
+	}
+
+	// releases evicted tiles for up to budgetMs (0 = all of them)
+	void collect(float budgetMs);
+	void clear();
+
+	Stats getStats() const;
+};
+
+#endif
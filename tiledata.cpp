@@ -0,0 +1,406 @@
+#include "tiledata.h"
+#include "wowmapview.h"
+#include "mpq.h"
+#include <algorithm>
+
+using namespace std;
+
+struct MapChunkHeader {
+	uint32 flags;
+	uint32 ix;
+	uint32 iy;
+	uint32 nLayers;
+	uint32 nDoodadRefs;
+	uint32 ofsHeight;
+	uint32 ofsNormal;
+	uint32 ofsLayer;
+	uint32 ofsRefs;
+	uint32 ofsAlpha;
+	uint32 sizeAlpha;
+	uint32 ofsShadow;
+	uint32 sizeShadow;
+	uint32 areaid;
+	uint32 nMapObjRefs;
+	uint32 holes;
+	uint16 s1;
+	uint16 s2;
+	uint32 d1;
+	uint32 d2;
+	uint32 d3;
+	uint32 predTex;
+	uint32 nEffectDoodad;
+	uint32 ofsSndEmitters;
+	uint32 nSndEmitters;
+	uint32 ofsLiquid;
+	uint32 sizeLiquid;
+	float  zpos;
+	float  xpos;
+	float  ypos;
+	uint32 textureId;
+	uint32 props;
+	uint32 effectId;
+};
+
+namespace {
+
+void readNames(MPQFile &f, size_t size, vector<string> &names)
+{
+	char *buf = new char[size];
+	f.read(buf, size);
+	char *p=buf;
+	while (p<buf+size) {
+		string path(p);
+		p+=strlen(p)+1;
+		fixname(path);
+		names.push_back(path);
+	}
+	delete[] buf;
+}
+
+// ids as the file stores them: read as a little endian uint32 they need no flipcc
+constexpr uint32 fourcc(const char (&s)[5])
+{
+	return (uint32)(unsigned char)s[0] << 24 | (uint32)(unsigned char)s[1] << 16 |
+		(uint32)(unsigned char)s[2] << 8 | (uint32)(unsigned char)s[3];
+}
+
+// nothing in an ADT is aligned; memcpy compiles to a plain unaligned load
+template <class T>
+inline T load(const char *p)
+{
+	T v;
+	memcpy(&v, p, sizeof(T));
+	return v;
+}
+
+// count Ts in place in the file buffer
+template <class T>
+struct Span {
+	const char *data;
+	size_t count;
+
+	Span(): data(0), count(0) {}
+	Span(const char *p, size_t bytes): data(p), count(bytes / sizeof(T)) {}
+
+	T operator[](size_t i) const { return load<T>(data + i * sizeof(T)); }
+};
+
+struct MapLayer {
+	uint32 tex;
+	uint32 flags;
+	uint32 ofsAlpha;
+	uint32 effect;
+};
+
+// The sub-chunks of one MCNK, found without copying anything out of the
+// file buffer. Every span ends inside the MCNK
+struct ChunkView {
+	MapChunkHeader header;
+	Span<float> heights;
+	Span<signed char> normals;
+	Span<MapLayer> layers;
+	Span<unsigned char> shadow;
+	Span<unsigned char> alpha;
+	// from MCLQ to the end of the MCNK; an empty MCLQ is followed by MCSE
+	Span<char> liquid;
+
+	bool map(const char *p, size_t avail)
+	{
+		if (avail < 8 + sizeof(MapChunkHeader)) return false;
+
+		const char *end = p + 8 + std::min((size_t)load<uint32>(p + 4), avail - 8);
+		memcpy(&header, p + 8, sizeof(header));
+
+		const char *q = p + 8 + sizeof(MapChunkHeader);
+		while (end - q >= 8) {
+			uint32 id = load<uint32>(q);
+			size_t size = load<uint32>(q + 4);
+			const char *d = q + 8;
+			size_t left = end - d;
+
+			switch (id) {
+			case fourcc("MCVT"):
+				heights = Span<float>(d, std::min(size, left));
+				break;
+			case fourcc("MCNR"):
+				// the size leaves out 13 bytes of padding
+				size = 0x1C0;
+				normals = Span<signed char>(d, std::min((size_t)mapbufsize * 3, left));
+				break;
+			case fourcc("MCLY"):
+				layers = Span<MapLayer>(d, std::min(size, left));
+				break;
+			case fourcc("MCSH"):
+				shadow = Span<unsigned char>(d, std::min(size, left));
+				break;
+			case fourcc("MCAL"):
+				// some MCAL chunks have incorrect sizes! :(
+				if (layers.count == 0) size = 0;
+				alpha = Span<unsigned char>(d, left);
+				break;
+			case fourcc("MCLQ"):
+				liquid = Span<char>(d, left);
+				// we're done here!
+				return true;
+			}
+			if (size > left) break;
+			q = d + size;
+		}
+		return true;
+	}
+};
+
+// x and z of the 9x9 + 8x8 vertices within a chunk, row by row
+struct GridOffsets {
+	float x[mapbufsize], z[mapbufsize];
+
+	GridOffsets()
+	{
+		int k = 0;
+		for (int j=0; j<17; j++) {
+			for (int i=0; i<((j%2)?8:9); i++) {
+				x[k] = i * UNITSIZE;
+				z[k] = j * 0.5f * UNITSIZE;
+				if (j%2) {
+					x[k] += UNITSIZE*0.5f;
+				}
+				k++;
+			}
+		}
+	}
+};
+
+const GridOffsets &gridOffsets()
+{
+	static const GridOffsets g;
+	return g;
+}
+
+// the eight MCSH texels for each byte, lowest bit first
+struct ShadowBytes {
+	unsigned char texels[256][8];
+
+	ShadowBytes()
+	{
+		for (int v=0; v<256; v++) {
+			for (int i=0; i<8; i++) {
+				texels[v][i] = (v & (1 << i)) ? 85 : 0;
+			}
+		}
+	}
+};
+
+const ShadowBytes &shadowBytes()
+{
+	static const ShadowBytes t;
+	return t;
+}
+
+void parseChunk(ChunkData &c, const char *p, size_t avail)
+{
+	ChunkView v;
+	if (!v.map(p, avail)) return;
+
+	const MapChunkHeader &header = v.header;
+
+	c.areaID = header.areaid;
+	c.flags = header.flags;
+	c.holes = header.holes;
+
+	// correct the x and z values ^_^
+	c.zbase = header.zpos*-1.0f + ZEROPOINT;
+	c.xbase = header.xpos*-1.0f + ZEROPOINT;
+	c.ybase = header.ypos;
+
+	c.vmin = Vec3D( 9999999.0f, 9999999.0f, 9999999.0f);
+	c.vmax = Vec3D(-9999999.0f,-9999999.0f,-9999999.0f);
+
+	if (v.normals.count == mapbufsize * 3) {
+		// order Z,X,Y ?
+		const Span<signed char> &nor = v.normals;
+		for (int i=0; i<mapbufsize; i++) {
+			c.normals[i] = Vec3D(-(float)nor[i*3+1]/127.0f, (float)nor[i*3+2]/127.0f, -(float)nor[i*3]/127.0f);
+		}
+	}
+
+	if (v.heights.count >= mapbufsize) {
+		const Span<float> &h = v.heights;
+		const GridOffsets &g = gridOffsets();
+
+		float lo = h[0], hi = h[0];
+		for (int i=0; i<mapbufsize; i++) {
+			lo = std::min(lo, h[i]);
+			hi = std::max(hi, h[i]);
+		}
+		for (int i=0; i<mapbufsize; i++) {
+			c.vertices[i] = Vec3D(c.xbase + g.x[i], c.ybase + h[i], c.zbase + g.z[i]);
+		}
+
+		c.vmin = Vec3D(c.xbase, c.ybase + lo, c.zbase);
+		c.vmax = Vec3D(c.xbase + 8 * UNITSIZE, c.ybase + hi, c.zbase + 8 * UNITSIZE);
+		c.r = (c.vmax - c.vmin).length() * 0.5f;
+	}
+
+	// texture info
+	c.nTextures = (int)std::min(v.layers.count, (size_t)4);
+	for (int i=0; i<c.nTextures; i++) {
+		MapLayer layer = v.layers[i];
+		c.textures[i] = (int)layer.tex;
+		int flags = (int)(layer.flags & ~0x100);
+		c.animated[i] = (flags & 0x80) ? flags : 0;
+	}
+
+	// shadow map 64 x 64, a bit per texel
+	if (v.shadow.count >= 64*8) {
+		const unsigned char *b = (const unsigned char*)v.shadow.data;
+		const ShadowBytes &t = shadowBytes();
+		for (int i=0; i<64*8; i++) {
+			memcpy(c.shadow + i*8, t.texels[b[i]], 8);
+		}
+		c.hasShadow = true;
+	}
+
+	// alpha maps  64 x 64, 4 bits per texel
+	for (int i=0; i<c.nTextures-1 && v.alpha.count >= (size_t)(i+1) * 0x800; i++) {
+		const unsigned char *abuf = (const unsigned char*)v.alpha.data + i * 0x800;
+		unsigned char *a = c.alphamaps[i];
+		for (int j=0; j<64*32; j++) {
+			a[j*2] = (abuf[j] & 0x0f) << 4;
+			a[j*2+1] = (abuf[j] & 0xf0);
+		}
+	}
+
+	// liquid / water level
+	if (v.liquid.count >= 8 + liquidDataSize && load<uint32>(v.liquid.data) != fourcc("MCSE")) {
+		c.haswater = true;
+		c.waterlevel = load<float>(v.liquid.data);
+
+		if (c.waterlevel > c.vmax.y) c.vmax.y = c.waterlevel;
+		if (c.waterlevel < c.vmin.y) c.haswater = false;
+
+		const char *lq = v.liquid.data + 8;
+		c.liquid.assign(lq, lq + liquidDataSize);
+	}
+}
+
+}
+
+bool TileData::parse(int x0, int z0, const char *filename)
+{
+	x = x0;
+	z = z0;
+
+	gLog("Loading tile %d,%d\n",x0,z0);
+
+	MPQFile f(filename);
+	ok = !f.isEof();
+	if (!ok) {
+		gLogError("-> Error loading %s\n",filename);
+		return false;
+	}
+
+	uint32 id, size;
+
+	uint32 mcnk_offsets[256], mcnk_sizes[256];
+	memset(mcnk_offsets, 0, sizeof(mcnk_offsets));
+
+	while (!f.isEof()) {
+		f.read(&id,4);
+		f.read(&size, 4);
+
+		size_t nextpos = f.getPos() + size;
+
+		switch (id) {
+		case fourcc("MCIN"):
+			// mapchunk offsets/sizes
+			for (int i=0; i<256; i++) {
+				f.read(&mcnk_offsets[i],4);
+				f.read(&mcnk_sizes[i],4);
+				f.seekRelative(8);
+			}
+			break;
+		case fourcc("MTEX"):
+			// texture lists
+			if (size) readNames(f, size, textures);
+			break;
+		case fourcc("MMDX"):
+			// models ...
+			// MMID would be relative offsets for MMDX filenames
+			if (size) readNames(f, size, models);
+			break;
+		case fourcc("MWMO"):
+			// map objects
+			if (size) readNames(f, size, wmos);
+
+			// archive lookups ignore case, so the names are fixed already
+			for (size_t i=0; i<wmos.size(); i++) {
+				AssetPath path(wmos[i]);
+				if (MPQFile::exists(path)) {
+					gLog("Adding WMO: %s\n", wmos[i].c_str());
+				} else {
+					gLog("Skipping missing WMO: %s\n", wmos[i].c_str());
+					wmos[i].clear();
+				}
+			}
+			break;
+		case fourcc("MDDF"):
+			// model instance data
+			for (int i=0; i<(int)size / 36; i++) {
+				ModelPlacement p;
+				float ff[3];
+				f.read(&p.name, 4);
+				f.read(&p.d1, 4);
+				f.read(ff,12);
+				p.pos = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.dir = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(&p.scale,4);
+				modelPlacements.push_back(p);
+			}
+			break;
+		case fourcc("MODF"):
+			// wmo instance data
+			for (int i=0; i<(int)size / 64; i++) {
+				WMOPlacement p;
+				float ff[3];
+				f.read(&p.name, 4);
+				f.read(&p.id, 4);
+				f.read(ff,12);
+				p.pos = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.dir = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.pos2 = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(ff,12);
+				p.pos3 = Vec3D(ff[0],ff[1],ff[2]);
+				f.read(&p.d2,4);
+				f.read(&p.d3,4);
+				wmoPlacements.push_back(p);
+			}
+			break;
+		}
+
+		// MCNK data will be processed separately ^_^
+
+		f.seek((int)nextpos);
+	}
+
+	// the map chunks are read in place
+	const char *buf = f.getBuffer();
+	if (!buf) {
+		gLogError("-> Error reading %s\n",filename);
+		ok = false;
+		f.close();
+		return false;
+	}
+	size_t fsize = f.getSize();
+	for (int j=0; j<16; j++) {
+		for (int i=0; i<16; i++) {
+			size_t ofs = mcnk_offsets[j*16+i];
+			if (ofs && ofs < fsize) parseChunk(chunks[j][i], buf + ofs, fsize - ofs);
+		}
+	}
+
+	f.close();
+	return true;
+}
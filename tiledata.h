@@ -0,0 +1,83 @@
+#ifndef TILEDATA_H
+#define TILEDATA_H
+
+#define TILESIZE (533.33333f)
+#define CHUNKSIZE ((TILESIZE) / 16.0f)
+#define UNITSIZE (CHUNKSIZE / 8.0f)
+#define ZEROPOINT (32.0f * (TILESIZE))
+
+#include "vec3d.h"
+#include <vector>
+#include <string>
+
+const int mapbufsize = 9*9 + 8*8;
+
+// MCLQ after the height range: 9x9 vertices of 8 bytes, then 8x8 tile flags
+const int liquidDataSize = 9*9*8 + 8*8;
+
+// One MCNK, ready to be turned into GL objects by MapChunk::init
+struct ChunkData {
+	unsigned int areaID;
+	unsigned int flags;
+	int holes;
+
+	float xbase, ybase, zbase;
+	Vec3D vmin, vmax;
+	float r;
+
+	Vec3D vertices[mapbufsize];
+	Vec3D normals[mapbufsize];
+
+	// layers index TileData::textures
+	int nTextures;
+	int textures[4];
+	int animated[4];
+
+	bool hasShadow;
+	unsigned char shadow[64*64];
+	unsigned char alphamaps[3][64*64];
+
+	bool haswater;
+	float waterlevel;
+	std::vector<char> liquid;
+
+	ChunkData(): areaID(0), flags(0), holes(0), xbase(0), ybase(0), zbase(0), r(0),
+		nTextures(0), hasShadow(false), haswater(false), waterlevel(0) {}
+};
+
+// MDDF and MODF entries; name indexes TileData::models / wmos
+struct ModelPlacement {
+	int name;
+	unsigned int d1, scale;
+	Vec3D pos, dir;
+};
+
+struct WMOPlacement {
+	int name;
+	int id, d2, d3;
+	Vec3D pos, dir, pos2, pos3;
+};
+
+// Everything MapTile needs from an ADT. parse() only reads the archives, so
+// it can run on a worker thread; MapTile::commit() makes the GL objects
+// and loads the textures, models and WMOs later.
+struct TileData {
+	int x, z;
+	bool ok;
+
+	std::vector<std::string> textures;
+	std::vector<std::string> models;
+	// WMOs that are not in the archives are left empty
+	std::vector<std::string> wmos;
+
+	std::vector<ModelPlacement> modelPlacements;
+	std::vector<WMOPlacement> wmoPlacements;
+
+	ChunkData chunks[16][16];
+
+	TileData(): x(0), z(0), ok(false) {}
+
+	bool parse(int x0, int z0, const char *filename);
+};
+
+#endif
@@ -0,0 +1,173 @@
+#include "tilestream.h"
+#include "mpq.h"
+#include "threadpool.h"
+#include <thread>
+#include <algorithm>
+#include <stdio.h>
+
+TileStreamer::TileStreamer(const std::string &basename):
+	inFlight(0),
+	prefetched(0),
+	basename(basename),
+	tracking(false),
+	crossings(0),
+	hitches(0),
+	lastCrossingMs(0),
+	worstCrossingMs(0),
+	lastBuildMs(0),
+	lookahead(2.0f)
+{
+	for (int j=0; j<64; j++) {
+		for (int i=0; i<64; i++) {
+			state[j][i] = IDLE;
+		}
+	}
+}
+
+TileStreamer::~TileStreamer()
+{
+	// the jobs hold on to this
+	while (inFlight > 0)
+		std::this_thread::yield();
+
+	for (std::map<int, TileData*>::iterator it = parsed.begin(); it != parsed.end(); ++it)
+		delete it->second;
+}
+
+void TileStreamer::predict(const Vec3D &camera, float dt, int &x, int &z)
+{
+	if (!tracking || dt <= 0) {
+		velocity = Vec3D(0,0,0);
+		tracking = true;
+	} else if ((camera - lastCamera).length() > TILESIZE) {
+		// a jump (menu, go to node) is not movement
+		velocity = Vec3D(0,0,0);
+	} else {
+		// smooth over about a quarter second so single frames don't jerk it around
+		float a = std::min(1.0f, dt * 4.0f);
+		velocity = velocity * (1.0f - a) + (camera - lastCamera) * (a / dt);
+	}
+	lastCamera = camera;
+
+	Vec3D p = camera + velocity * lookahead;
+	x = (int)(p.x / TILESIZE);
+	z = (int)(p.z / TILESIZE);
+}
+
+bool TileStreamer::prefetch(int x, int z)
+{
+	unsigned char idle = IDLE;
+	if (!state[z][x].compare_exchange_strong(idle, QUEUED)) {
+		// wanted again before the job got to it, it counts again
+		unsigned char dropped = DROPPED;
+		return state[z][x].compare_exchange_strong(dropped, QUEUED);
+	}
+
+	inFlight++;
+	gThreadPool.push([this, x, z] {
+		warm(x, z);
+		prefetched++;
+		inFlight--;
+	});
+	return true;
+}
+
+void TileStreamer::warm(int x, int z)
+{
+	unsigned char dropped = DROPPED;
+	if (state[z][x].compare_exchange_strong(dropped, IDLE))
+		return;
+
+	char name[256];
+	snprintf(name, sizeof(name), "World\\Maps\\%s\\%s_%d_%d.adt", basename.c_str(), basename.c_str(), x, z);
+
+	TileData *data = new TileData;
+	data->parse(x, z, name);
+
+	// models and WMOs are still loaded on the GL thread, have their files ready
+	for (size_t i=0; i<data->models.size(); i++) {
+		// same renaming as Model does
+		std::string m = data->models[i];
+		if (m.length() > 4 && (m.compare(m.length()-4, 4, ".mdx") == 0 || m.compare(m.length()-4, 4, ".MDX") == 0 || m.compare(m.length()-4, 4, ".Mdx") == 0))
+			m.replace(m.length()-3, 3, "m2");
+		AssetPath path(m);
+		MPQFile f(path);
+	}
+	for (size_t i=0; i<data->wmos.size(); i++) {
+		if (data->wmos[i].empty()) continue;
+		AssetPath path(data->wmos[i]);
+		MPQFile f(path);
+	}
+
+	std::lock_guard<std::mutex> lock(parsedMutex);
+	unsigned char queued = QUEUED;
+	if (!state[z][x].compare_exchange_strong(queued, WARM)) {
+		delete data;
+		state[z][x] = IDLE;
+		return;
+	}
+	parsed[z*64 + x] = data;
+}
+
+TileData *TileStreamer::take(int x, int z)
+{
+	std::lock_guard<std::mutex> lock(parsedMutex);
+	std::map<int, TileData*>::iterator it = parsed.find(z*64 + x);
+	if (it == parsed.end())
+		return 0;
+	TileData *data = it->second;
+	parsed.erase(it);
+	state[z][x] = IDLE;
+	return data;
+}
+
+size_t TileStreamer::pendingBytes()
+{
+	// a WARM tile is in parsed and no longer running; DROPPED jobs are
+	// thrown away when they finish and hold nothing for long
+	size_t n = 0;
+	for (int j=0; j<64; j++) {
+		for (int i=0; i<64; i++) {
+			unsigned char s = state[j][i];
+			if (s == QUEUED || s == WARM) n++;
+		}
+	}
+	return n * sizeof(TileData);
+}
+
+void TileStreamer::forget(int x, int z)
+{
+	std::lock_guard<std::mutex> lock(parsedMutex);
+	std::map<int, TileData*>::iterator it = parsed.find(z*64 + x);
+	if (it != parsed.end()) {
+		delete it->second;
+		parsed.erase(it);
+	}
+	unsigned char warm = WARM;
+	if (!state[z][x].compare_exchange_strong(warm, IDLE)) {
+		unsigned char queued = QUEUED;
+		state[z][x].compare_exchange_strong(queued, DROPPED);
+	}
+}
+
+void TileStreamer::crossed(double ms, bool hitch)
+{
+	crossings++;
+	if (hitch)
+		hitches++;
+	lastCrossingMs = ms;
+	worstCrossingMs = std::max(worstCrossingMs, ms);
+}
+
+TileStreamer::Stats TileStreamer::getStats() const
+{
+	Stats st;
+	st.prefetched = prefetched;
+	st.crossings = crossings;
+	st.hitches = hitches;
+	st.queued = inFlight;
+	st.lastCrossingMs = lastCrossingMs;
+	st.worstCrossingMs = worstCrossingMs;
+	st.lastBuildMs = lastBuildMs;
+	return st;
+}
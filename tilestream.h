@@ -0,0 +1,92 @@
+#ifndef TILESTREAM_H
+#define TILESTREAM_H
+
+#include "vec3d.h"
+#include "tiledata.h"
+#include <string>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+// Parses the tiles the camera is heading for ahead of time.
+//
+// prefetch() parses an ADT into a TileData on gThreadPool and reads the
+// models and WMOs it places, so that they sit decompressed in gMPQCache by
+// the time the tile is committed. predict() extrapolates the camera from
+// its smoothed velocity to tell World which tiles to ask for next.
+class TileStreamer {
+	// DROPPED is QUEUED with nobody waiting for the result any more
+	enum { IDLE, QUEUED, WARM, DROPPED };
+
+	std::atomic<unsigned char> state[64][64];
+	std::atomic<int> inFlight;
+	std::atomic<unsigned int> prefetched;
+
+	// finished parses nobody took yet
+	std::map<int, TileData*> parsed;
+	std::mutex parsedMutex;
+
+	std::string basename;
+
+	Vec3D lastCamera, velocity;
+	bool tracking;
+
+	unsigned int crossings, hitches;
+	double lastCrossingMs, worstCrossingMs, lastBuildMs;
+
+	void warm(int x, int z);
+
+public:
+	struct Stats {
+		unsigned int prefetched, crossings, hitches;
+		int queued;
+		double lastCrossingMs, worstCrossingMs, lastBuildMs;
+	};
+
+	// seconds of travel to look ahead
+	float lookahead;
+
+	TileStreamer(const std::string &basename);
+	// waits for the prefetches still running
+	~TileStreamer();
+
+	// call once per frame; returns the tile the camera will be over in
+	// lookahead seconds
+	void predict(const Vec3D &camera, float dt, int &x, int &z);
+	// where the camera is expected in lookahead seconds
+	Vec3D predicted() const { return lastCamera + velocity * lookahead; }
+
+	// true when this made the tile wanted: a new job, or one dropped
+	// before it ran; false if it was queued or parsed already
+	bool prefetch(int x, int z);
+	bool isWarm(int x, int z) const { return state[z][x] == WARM; }
+	// the parsed tile, for the caller to keep; NULL if it is not warm
+	TileData *take(int x, int z);
+	// what the tiles still wanted hold, parsed and waiting to be taken or
+	// queued and running, for the tile memory budget
+	size_t pendingBytes();
+	// the tile was dropped, prefetch it again next time; a parse still
+	// running is thrown away when it finishes
+	void forget(int x, int z);
+	// forgets the tiles queued or parsed for which unwanted(x, z) is true,
+	// or prefetches nobody takes would pile up
+	template <class PRED>
+	void drop(PRED unwanted)
+	{
+		for (int j=0; j<64; j++) {
+			for (int i=0; i<64; i++) {
+				unsigned char s = state[j][i];
+				if ((s == QUEUED || s == WARM) && unwanted(i, j)) forget(i, j);
+			}
+		}
+	}
+
+	// hitch: a tile the camera entered had to be loaded on the spot
+	void crossed(double ms, bool hitch);
+	// time spent committing tiles this frame
+	void built(double ms) { lastBuildMs = ms; }
+
+	Stats getStats() const;
+};
+
+#endif
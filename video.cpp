@@ -2,6 +2,10 @@
 #include "shaders.h"
 #include "mpq.h"
 #include "wowmapview.h"
+#include "blp.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <chrono>
 
 /////// EXTENSIONS
 
@@ -47,7 +51,7 @@ void Video::init(int xres, int yres, bool fullscreen)
 	SDL_putenv("SDL_VIDEO_X11_VISUALID="); // fixes a bug with SDL and nvidia drivers
 
 	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-		gLog("SDL initialization failed: %s\n", SDL_GetError());
+		gLogError("SDL initialization failed: %s\n", SDL_GetError());
 		exit(1);
 	}
 
@@ -65,7 +69,7 @@ void Video::init(int xres, int yres, bool fullscreen)
 
 	primary = SDL_SetVideoMode(xres, yres, 32, flags);
 	if (!primary) {
-		gLog("SDL_SetVideoMode failed: %s\n", SDL_GetError());
+		gLogError("SDL_SetVideoMode failed: %s\n", SDL_GetError());
 		exit(1);
 	}
 
@@ -79,9 +83,9 @@ void Video::init(int xres, int yres, bool fullscreen)
 
 	// Verify required extensions
 	if (!(supportVBO && supportMultiTex)) {
-		gLog("Required OpenGL extensions missing.\n");
-		if (!supportVBO) gLog("Missing GL_ARB_vertex_buffer_object\n");
-		if (!supportMultiTex) gLog("Missing GL_ARB_multitexture\n");
+		gLogError("Required OpenGL extensions missing.\n");
+		if (!supportVBO) gLogError("Missing GL_ARB_vertex_buffer_object\n");
+		if (!supportMultiTex) gLogError("Missing GL_ARB_multitexture\n");
 		exit(1);
 	}
 
@@ -128,7 +132,7 @@ bool isExtensionSupported(const char* search)
 {
 	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
 	if (!extensions) {
-		gLog("Failed to get OpenGL extensions string\n");
+		gLogError("Failed to get OpenGL extensions string\n");
 		return false;
 	}
 
@@ -248,167 +252,231 @@ void Video::set2D()
 //////// TEXTURE MANAGER
 
 
-GLuint TextureManager::add(std::string name)
+TextureManager::TextureManager():
+	nextSerial(0),
+	decodeMs(0),
+	uploadMs(0),
+	lastFrameUploadMs(0),
+	decoded(0),
+	uploaded(0),
+	failed(0),
+	frame(0),
+	residentBytes(0),
+	streamedIn(0),
+	dropped(0),
+	uploadBudgetMs(4.0f),
+	memoryBudget(512 * 1024 * 1024),
+	streamDistance(200.0f),
+	lowMipSize(64)
+{
+}
+
+GLuint TextureManager::add(const std::string &name)
+{
+	return add(AssetPath(name));
+}
+
+GLuint TextureManager::add(const AssetPath &path)
 {
 	GLuint id;
-	if (names.find(name) != names.end()) {
-		id = names[name];
-		items[id]->addref();
+	if (addref(path, id)) {
 		return id;
 	}
 	glGenTextures(1,&id);
 
-	Texture *tex = new Texture(name);
+	// neutral grey until the real image arrives
+	static const unsigned char placeholder[4] = {0x80, 0x80, 0x80, 0xff};
+	glBindTexture(GL_TEXTURE_2D, id);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+
+	Texture *tex = new Texture(path);
 	tex->id = id;
-	LoadBLP(id, tex);
+	tex->lastUsed = frame;
+	do_add(path, id, tex);
 
-	do_add(name, id, tex);
+	queueDecode(id, path, false);
 
 	return id;
 }
 
-void TextureManager::LoadBLP(GLuint id, Texture *tex)
+void TextureManager::queueDecode(GLuint id, const AssetPath &path, bool full)
 {
-	// load BLP texture
-	glBindTexture(GL_TEXTURE_2D, id);
+	unsigned int serial = nextSerial++;
+	pending[id] = serial;
+
+	int maxSize = full ? 0 : lowMipSize;
+
+	gThreadPool.push([this, path, id, serial, full, maxSize] {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		Upload up;
+		up.id = id;
+		up.serial = serial;
+		up.full = full;
+		up.image = std::make_shared<BLPImage>();
+		if (!decodeBLP(path, *up.image, maxSize))
+			up.image.reset();
+		up.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+		std::lock_guard<std::mutex> lock(readyMutex);
+		ready.push_back(up);
+	});
+}
 
-	int offsets[16],sizes[16],w,h;
-	GLint format;
+void TextureManager::use(GLuint id, float dist)
+{
+	Texture *tex = (Texture*)item(id);
+	if (!tex)
+		return;
 
-	char attr[4];
+	tex->lastUsed = frame;
 
-	MPQFile f(tex->name.c_str());
-	if (f.isEof()) {
-		tex->id = 0;
+	// only once the small mips are in, and not while a decode is queued
+	if (tex->full || !tex->low || dist > streamDistance || pending.find(id) != pending.end())
 		return;
-	}
-
-	f.seek(8);
-	f.read(attr,4);
-	f.read(&w,4);
-	f.read(&h,4);
-	f.read(offsets,4*16);
-	f.read(sizes,4*16);
 
-	tex->w = w;
-	tex->h = h;
+	queueDecode(id, tex->path, true);
+}
 
-	if (attr[0] == 2) {
-		// compressed
+void TextureManager::setResident(Texture *tex, const BLPImage &img)
+{
+	glBindTexture(GL_TEXTURE_2D, tex->id);
+	uploadBLP(img);
 
-        unsigned char *ucbuf;
-        if (!supportCompression) ucbuf = new unsigned char[w*h*4];
+	size_t bytes = img.bytes();
+	residentBytes = residentBytes - tex->bytes + bytes;
+	tex->bytes = bytes;
+}
 
-		format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
-		int blocksize = 8;
+void TextureManager::processUploads()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	double elapsed = 0;
+
+	frame++;
+
+	// always make some progress, even with a tiny budget
+	do {
+		Upload up;
+		{
+			std::lock_guard<std::mutex> lock(readyMutex);
+			if (ready.empty())
+				break;
+			up = ready.front();
+			ready.pop_front();
+		}
 
-		// guesswork here :(
-		if (attr[1]==8) {
-			// dxt3 or 5
-			//if (attr[2]) format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
-			//else format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		std::map<GLuint, unsigned int>::iterator it = pending.find(up.id);
+		if (it == pending.end() || it->second != up.serial)
+			continue;
+		pending.erase(it);
 
-			format = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+		decodeMs += up.decodeMs;
+		decoded++;
 
-			blocksize = 16;
+		Texture *tex = (Texture*)item(up.id);
 
-		} else {
-			if (!attr[3]) format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		if (!up.image) {
+			// keep what is there (the placeholder for a missing file), and
+			// don't ask for the full chain again
+			failed++;
+			tex->full = true;
+			continue;
 		}
 
-        unsigned char *buf = new unsigned char[sizes[0]];
-
-		// do every mipmap level
-		for (int i=0; i<16; i++) {
-			if (w==0) w = 1;
-			if (h==0) h = 1;
-			if (offsets[i] && sizes[i]) {
-				f.seek(offsets[i]);
-				f.read(buf,sizes[i]);
+		tex->w = up.image->w;
+		tex->h = up.image->h;
+
+		// the small chain is all there is when nothing was skipped
+		const BLPImage &img = *up.image;
+		bool complete = up.full || (img.mips[0].w == img.w && img.mips[0].h == img.h);
+
+		if (!tex->low) {
+			if (up.full) {
+				// keep the tail of the full chain to drop back to
+				tex->low = std::make_shared<BLPImage>(img.tail(lowMipSize));
+			} else {
+				tex->low = up.image;
+			}
+			tex->lowBytes = tex->low->bytes();
+		}
 
-				int size = ((w+3)/4) * ((h+3)/4) * blocksize;
+		setResident(tex, img);
+		tex->full = complete;
+		if (up.full)
+			streamedIn++;
+		uploaded++;
 
-                if (supportCompression) {
-                    glCompressedTexImage2DARB(GL_TEXTURE_2D, i, format, w, h, 0, size, buf);
-                } else {
-                    decompressDXTC(format, w, h, size, buf, ucbuf);
-                    glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, ucbuf);
-                }
+		elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < uploadBudgetMs);
 
-			} else break;
-			w >>= 1;
-			h >>= 1;
-		}
+	trimToBudget();
 
-		delete[] buf;
-        if (!supportCompression) delete[] ucbuf;
-	}
-	else if (attr[0]==1) {
-		// uncompressed
-		unsigned int pal[256];
-		f.read(pal,1024);
-
-		unsigned char *buf = new unsigned char[sizes[0]];
-		unsigned int *buf2 = new unsigned int[w*h];
-		unsigned int *p;
-		unsigned char *c, *a;
-
-		int alphabits = attr[1];
-		bool hasalpha = alphabits!=0;
-
-		for (int i=0; i<16; i++) {
-			if (w==0) w = 1;
-			if (h==0) h = 1;
-			if (offsets[i] && sizes[i]) {
-				f.seek(offsets[i]);
-				f.read(buf,sizes[i]);
-
-				int cnt = 0;
-				p = buf2;
-				c = buf;
-				a = buf + w*h;
-				for (int y=0; y<h; y++) {
-					for (int x=0; x<w; x++) {
-						unsigned int k = pal[*c++];
-						k = ((k&0x00FF0000)>>16) | ((k&0x0000FF00)) | ((k& 0x000000FF)<<16);
-						int alpha;
-						if (hasalpha) {
-							if (alphabits == 8) {
-								alpha = (*a++);
-							} else if (alphabits == 1) {
-								alpha = (*a & (1 << cnt++)) ? 0xff : 0;
-								if (cnt == 8) {
-									cnt = 0;
-									a++;
-								}
-							}
-						} else alpha = 0xff;
-
-						k |= alpha << 24;
-						*p++ = k;
-					}
-				}
-
-				glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, buf2);
-
-			} else break;
-			w >>= 1;
-			h >>= 1;
-		}
+	elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	uploadMs += elapsed;
+	lastFrameUploadMs = elapsed;
+}
 
-		delete[] buf2;
-		delete[] buf;
+namespace {
+	bool lessRecentlyUsed(const Texture *a, const Texture *b)
+	{
+		return a->lastUsed < b->lastUsed;
 	}
+}
 
-	f.close();
+void TextureManager::trimToBudget()
+{
+	if (!memoryBudget || residentBytes <= memoryBudget)
+		return;
 
-	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+	// anything drawn in the last couple of frames stays, or it would just
+	// stream right back in
+	std::vector<Texture*> candidates;
+	unsigned int frame = this->frame;
+	forEach([&candidates, frame](GLuint, ManagedItem *item) {
+		Texture *tex = (Texture*)item;
+		if (tex->low && tex->bytes > tex->lowBytes && tex->lastUsed + 2 < frame)
+			candidates.push_back(tex);
+	});
+	std::sort(candidates.begin(), candidates.end(), lessRecentlyUsed);
+
+	for (size_t i=0; i<candidates.size() && residentBytes > memoryBudget; i++) {
+		Texture *tex = candidates[i];
+		setResident(tex, *tex->low);
+		tex->full = false;
+		// a full decode still in flight would undo this
+		pending.erase(tex->id);
+		dropped++;
+	}
 }
 
+TextureManager::Stats TextureManager::getStats()
+{
+	Stats st;
+	{
+		std::lock_guard<std::mutex> lock(readyMutex);
+		st.ready = ready.size();
+	}
+	st.pending = pending.size();
+	st.decoded = decoded;
+	st.uploaded = uploaded;
+	st.failed = failed;
+	st.avgDecodeMs = decoded ? decodeMs / decoded : 0;
+	st.avgUploadMs = uploaded ? uploadMs / uploaded : 0;
+	st.lastFrameUploadMs = lastFrameUploadMs;
+	st.residentBytes = residentBytes;
+	st.memoryBudget = memoryBudget;
+	st.streamedIn = streamedIn;
+	st.dropped = dropped;
+	return st;
+}
 
 void TextureManager::doDelete(GLuint id)
 {
+	pending.erase(id);
+	residentBytes -= ((Texture*)item(id))->bytes;
 	glDeleteTextures(1, &id);
 }
 
@@ -508,73 +576,3 @@ GLuint loadTGA(const char* filename, bool mipmaps)
 	delete[] buf;
 	return t;
 }
-
-struct Color {
-    unsigned char r, g, b;
-};
-
-void decompressDXTC(GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest)
-{
-    // sort of copied from linghuye
-    int bsx = (w<4) ? w : 4;
-    int bsy = (h<4) ? h : 4;
-
-    for(int y=0; y<h; y += bsy) {
-        for(int x=0; x<w; x += bsx) {
-            unsigned long long alpha = 0;
-            unsigned int a0 = 0, a1 = 0;
-
-            if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)	{
-                alpha = *(unsigned long long*)src;
-                src += 8;
-            }
-
-            unsigned int c0 = *(unsigned short*)(src + 0);
-            unsigned int c1 = *(unsigned short*)(src + 2);
-            src += 4;
-
-            Color color[4];
-            color[0].b = (unsigned char) ((c0 >> 11) & 0x1f) << 3;
-            color[0].g = (unsigned char) ((c0 >>  5) & 0x3f) << 2;
-            color[0].r = (unsigned char) ((c0      ) & 0x1f) << 3;
-            color[1].b = (unsigned char) ((c1 >> 11) & 0x1f) << 3;
-            color[1].g = (unsigned char) ((c1 >>  5) & 0x3f) << 2;
-            color[1].r = (unsigned char) ((c1      ) & 0x1f) << 3;
-            if(c0 > c1) {
-                color[2].r = (color[0].r * 2 + color[1].r) / 3;
-                color[2].g = (color[0].g * 2 + color[1].g) / 3;
-                color[2].b = (color[0].b * 2 + color[1].b) / 3;
-                color[3].r = (color[0].r + color[1].r * 2) / 3;
-                color[3].g = (color[0].g + color[1].g * 2) / 3;
-                color[3].b = (color[0].b + color[1].b * 2) / 3;
-            } else {
-                color[2].r = (color[0].r + color[1].r) / 2;
-                color[2].g = (color[0].g + color[1].g) / 2;
-                color[2].b = (color[0].b + color[1].b) / 2;
-                color[3].r = 0;
-                color[3].g = 0;
-                color[3].b = 0;
-            }
-
-            for (int j=0; j<bsy; j++) {
-                unsigned int index = *src++;
-                unsigned char* dd = dest + (w*(y+j)+x)*4;
-                for (int i=0; i<bsx; i++) {
-                    *dd++ = color[index & 0x03].b;
-                    *dd++ = color[index & 0x03].g;
-                    *dd++ = color[index & 0x03].r;
-                    if (format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)	{
-                        *dd++ = ((index & 0x03) == 3 && c0 <= c1) ? 0 : 255;
-                    }
-                    else if (format == GL_COMPRESSED_RGBA_S3TC_DXT3_EXT)	{
-                        *dd++ = (unsigned char)(alpha & 0x0f) << 4;
-                        alpha >>= 4;
-                    }
-                    index >>= 2;
-                }
-            }
-        }
-    }
-}
-
-
@@ -10,6 +10,10 @@
 #endif
 
 #include "vec3d.h"
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 
 #include "manager.h"
 #include "font.h"
@@ -51,23 +55,94 @@ extern bool supportDrawRangeElements;
 
 ////////// TEXTURE MANAGER
 
+struct BLPImage;
+
 class Texture : public ManagedItem {
 public:
 	int w,h;
 	GLuint id;
 
-	Texture(std::string name):ManagedItem(name), w(0), h(0) {}
+	// residency: what is on the card now, and the small mips to fall back to
+	size_t bytes, lowBytes;
+	bool full;
+	unsigned int lastUsed;
+	std::shared_ptr<BLPImage> low;
+
+	AssetPath path;
+
+	Texture(const AssetPath &path):ManagedItem(path.str()), w(0), h(0), bytes(0), lowBytes(0), full(false), lastUsed(0), path(path) {}
 
 };
 
+// Textures are decoded on gThreadPool. add() hands out the GL name right
+// away with a placeholder image in it; processUploads() swaps in the real
+// mip chain once the decode is done.
+//
+// Only mips up to lowMipSize are loaded at first. use() streams in the full
+// chain for textures drawn within streamDistance, and when the resident
+// total goes over memoryBudget the least recently used ones drop back to
+// their small mips.
 class TextureManager : public Manager<GLuint> {
-	
-	void LoadBLP(GLuint id, Texture *tex);
+
+	struct Upload {
+		GLuint id;
+		unsigned int serial;
+		std::shared_ptr<BLPImage> image;
+		bool full;
+		double decodeMs;
+	};
+
+	// finished decodes, filled by the workers
+	std::deque<Upload> ready;
+	std::mutex readyMutex;
+
+	// decode serial per id still waiting for its image, GL thread only.
+	// a deleted (and maybe reused) id no longer matches and is skipped
+	std::map<GLuint, unsigned int> pending;
+	unsigned int nextSerial;
+
+	double decodeMs, uploadMs, lastFrameUploadMs;
+	unsigned int decoded, uploaded, failed;
+
+	unsigned int frame;
+	size_t residentBytes;
+	unsigned int streamedIn, dropped;
+
+	void queueDecode(GLuint id, const AssetPath &path, bool full);
+	void setResident(Texture *tex, const BLPImage &img);
+	void trimToBudget();
 
 public:
-	virtual GLuint add(std::string name);
+	struct Stats {
+		size_t pending, ready;
+		unsigned int decoded, uploaded, failed;
+		double avgDecodeMs, avgUploadMs, lastFrameUploadMs;
+		size_t residentBytes, memoryBudget;
+		unsigned int streamedIn, dropped;
+	};
+
+	// time processUploads() may spend per frame
+	float uploadBudgetMs;
+
+	// 0 = never drop mips
+	size_t memoryBudget;
+	float streamDistance;
+	int lowMipSize;
+
+	TextureManager();
+
+	virtual GLuint add(const std::string &name);
+	GLuint add(const AssetPath &path);
 	void doDelete(GLuint id);
 
+	// call when binding a texture for drawing, with the distance to what
+	// it is drawn on
+	void use(GLuint id, float dist = 0);
+
+	// call once per frame on the GL thread
+	void processUploads();
+	Stats getStats();
+
 };
 
 ////////// VIDEO CLASS
@@ -102,7 +177,6 @@ public:
 extern Video video;
 
 GLuint loadTGA(const char *filename, bool mipmaps);
-void decompressDXTC(GLint format, int w, int h, size_t size, unsigned char *src, unsigned char *dest);
 bool isExtensionSupported(const char *search);
 
 
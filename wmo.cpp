@@ -1,6 +1,7 @@
 #include "wmo.h"
 #include "world.h"
 #include "liquid.h"
+#include <algorithm>
 
 
 using namespace std;
@@ -10,12 +11,12 @@ WMO::WMO(std::string name) : ManagedItem(name)
 	MPQFile f(name.c_str());
 	ok = !f.isEof();
 	if (!ok) {
-		gLog("Error loading WMO %s\n", name.c_str());
+		gLogError("Error loading WMO %s\n", name.c_str());
 		return;
 	}
 
 	if (!f.getBuffer() || f.getSize() < 8) {
-		gLog("Error: Invalid WMO file buffer for %s (buffer=%p size=%zu)\n",
+		gLogError("Error: Invalid WMO file buffer for %s (buffer=%p size=%zu)\n",
 			name.c_str(), f.getBuffer(), f.getSize());
 		ok = false;
 		return;
@@ -39,14 +40,14 @@ WMO::WMO(std::string name) : ManagedItem(name)
 	while (!f.isEof()) {
 		// Read and validate chunk header 
 		if (f.read(fourcc, 4) != 4) {
-			gLog("Error reading WMO chunk header\n");
+			gLogError("Error reading WMO chunk header\n");
 			ok = false;
 			break;
 		}
 
 		// Read size immediately after header
 		if (f.read(&size, 4) != 4) {
-			gLog("Error reading WMO chunk size\n");
+			gLogError("Error reading WMO chunk size\n");
 			ok = false;
 			break;
 		}
@@ -68,20 +69,20 @@ WMO::WMO(std::string name) : ManagedItem(name)
 
 		// Validate chunk size
 		if (size > f.getSize() - f.getPos()) {
-			gLog("Invalid chunk size in WMO %s\n", name.c_str());
+			gLogError("Invalid chunk size in WMO %s\n", name.c_str());
 			ok = false;
 			break;
 		}
 
 		/*if (!validHeader) {
-			gLog("Invalid WMO chunk header found in %s\n", name.c_str());
+			gLogError("Invalid WMO chunk header found in %s\n", name.c_str());
 			ok = false;
 			break;
 		}*/
 
 		// Validate chunk size
 		if (size > f.getSize() - f.getPos()) {
-			gLog("Invalid chunk size in WMO %s\n", name.c_str());
+			gLogError("Invalid chunk size in WMO %s\n", name.c_str());
 			ok = false;
 			break;
 		}
@@ -164,7 +165,9 @@ WMO::WMO(std::string name) : ManagedItem(name)
 			// MMID would be relative offsets for MMDX filenames
 			if (size) {
 
-				ddnames = f.getPointer();
+				// the file buffer is shared, fix up the names in a private copy
+				ddnames = new char[size];
+				memcpy(ddnames, f.getPointer(), size);
 				fixnamen(ddnames, size);
 
 				char *p=ddnames,*end=p+size;
@@ -192,7 +195,7 @@ WMO::WMO(std::string name) : ManagedItem(name)
 			for (int i=0; i<nModels; i++) {
 				int ofs;
 				f.read(&ofs,4);
-				Model *m = (Model*)gWorld->modelmanager.items[gWorld->modelmanager.get(ddnames + ofs)];
+				Model *m = (Model*)gWorld->modelmanager.item(gWorld->modelmanager.get(ddnames + ofs));
 				ModelInstance mi;
 				mi.init2(m,f);
 				modelis.push_back(mi);
@@ -207,7 +210,7 @@ WMO::WMO(std::string name) : ManagedItem(name)
 					gLog("SKYBOX:\n");
 
 					sbid = gWorld->modelmanager.add(path);
-					skybox = (Model*)gWorld->modelmanager.items[sbid];
+					skybox = (Model*)gWorld->modelmanager.item(sbid);
 
 					if (!skybox->ok) {
 						gWorld->modelmanager.del(sbid);
@@ -251,6 +254,7 @@ WMO::WMO(std::string name) : ManagedItem(name)
 
 	f.close();
 	delete[] texbuf;
+	delete[] ddnames;
 
 	for (int i=0; i<nGroups; i++) groups[i].initDisplayList();
 
@@ -282,9 +286,19 @@ WMO::~WMO()
 void WMO::draw(int doodadset, const Vec3D &ofs, const float rot)
 {
 	if (!ok) return;
-	
+
+	groupbounds.clear();
+	for (int i=0; i<nGroups; i++) {
+		Vec3D pos = groups[i].center + ofs;
+		rotate(ofs.x,ofs.z,&pos.x,&pos.z,rot*PI/180.0f);
+		groupbounds.add(pos, groups[i].rad);
+	}
+	gWorld->frustum.cull(groupbounds);
+
 	for (int i=0; i<nGroups; i++) {
-		groups[i].draw(ofs, rot);
+		Vec3D pos(groupbounds.x[i], groupbounds.y[i], groupbounds.z[i]);
+		if (groupbounds.isVisible(i) && gWorld->occlusion.visibleSphere(pos, groups[i].rad)) groups[i].draw(ofs, rot);
+		else groups[i].visible = false;
 	}
 
 	if (gWorld->drawdoodads) {
@@ -566,7 +580,7 @@ void WMOGroup::initDisplayList()
 
 	MPQFile gf(fname);
 	if (gf.isEof()) {
-		gLog("Failed to open WMO group file %s\n", fname);
+		gLogError("Failed to open WMO group file %s\n", fname);
 		return;
 	}
 
@@ -579,13 +593,13 @@ void WMOGroup::initDisplayList()
 
 	// Read and validate header
 	if (gf.read(&gh, sizeof(WMOGroupHeader)) != sizeof(WMOGroupHeader)) {
-		gLog("Failed to read WMO group header from %s\n", fname);
+		gLogError("Failed to read WMO group header from %s\n", fname);
 		return;
 	}
 
 	// Validate fog index
 	if (gh.fogs[0] >= wmo->fogs.size()) {
-		gLog("Invalid fog index in WMO group %s: %d\n", fname, gh.fogs[0]);
+		gLogError("Invalid fog index in WMO group %s: %d\n", fname, gh.fogs[0]);
 		fog = -1;
 		return;
 	}
@@ -738,6 +752,8 @@ void WMOGroup::initDisplayList()
 
         // setup texture
 		glBindTexture(GL_TEXTURE_2D, mat->tex);
+		if (std::find(textures.begin(), textures.end(), mat->tex) == textures.end())
+			textures.push_back(mat->tex);
 
 		bool atest = (mat->transparent) != 0;
 
@@ -795,6 +811,30 @@ void WMOGroup::initDisplayList()
 
 	glEndList();
 
+	// keep what was drawn for picking, in the same coordinates
+	if (vertices && indices && nVertices > 0) {
+		std::vector<Vec3D> verts(nVertices);
+		for (int i=0; i<nVertices; i++) verts[i] = Vec3D(vertices[i].x, vertices[i].z, -vertices[i].y);
+		std::vector<unsigned short> tris;
+		occluder.clear();
+		for (int b=0; b<nBatches; b++) {
+			// what can be seen through does not hide anything
+			const WMOMaterial &m = wmo->mat[batches[b].texture];
+			bool solid = m.transparent == 0, twosided = (m.flags & 0x04) != 0;
+			int end = (int)(batches[b].indexStart + batches[b].indexCount);
+			for (int i=(int)batches[b].indexStart; i+2<end; i+=3) {
+				if (indices[i] >= nVertices || indices[i+1] >= nVertices || indices[i+2] >= nVertices) continue;
+				tris.insert(tris.end(), indices + i, indices + i + 3);
+				if (solid) occluder.insert(occluder.end(), indices + i, indices + i + 3);
+				if (solid && twosided) {
+					unsigned short back[3] = {indices[i], indices[i+2], indices[i+1]};
+					occluder.insert(occluder.end(), back, back + 3);
+				}
+			}
+		}
+		bvh.assign(verts, tris);
+	}
+
 	gf.close();
 
 	// hmm
@@ -839,13 +879,15 @@ void WMOGroup::initLighting(int nLR, short *useLights)
 void WMOGroup::draw(const Vec3D& ofs, const float rot)
 {
 	visible = false;
-	// view frustum culling
 	Vec3D pos = center + ofs;
 	rotate(ofs.x,ofs.z,&pos.x,&pos.z,rot*PI/180.0f);
-	if (!gWorld->frustum.intersectsSphere(pos,rad)) return;
-	float dist = (pos - gWorld->camera).length() - rad;
+	dist = (pos - gWorld->camera).length() - rad;
 	if (dist >= gWorld->culldistance) return;
 	visible = true;
+
+	for (size_t i=0; i<textures.size(); i++) {
+		video.textures.use(textures[i], dist);
+	}
 	
 	if (hascv) {
 		glDisable(GL_LIGHTING);
@@ -894,11 +936,29 @@ void WMOGroup::drawDoodads(int doodadset, const Vec3D& ofs, const float rot)
 	glColor4f(xr,xg,xb,1);
 	*/
 
+	// the set's doodads through the frustum together
+	const WMODoodadSet &set = wmo->doodadsets[doodadset];
+	doodadbounds.clear();
+	for (int i=0; i<nDoodads; i++) {
+		short dd = ddr[i];
+		if ((dd >= set.start) && (dd < (set.start+set.size))) {
+			ModelInstance &mi = wmo->modelis[dd];
+			Vec3D tpos(ofs + mi.pos);
+			rotate(ofs.x,ofs.z,&tpos.x,&tpos.z,rot*PI/180.0f);
+			doodadbounds.add(tpos, mi.model->rad*mi.sc);
+		}
+	}
+	gWorld->frustum.cull(doodadbounds);
+
 	// draw doodads
 	glColor4f(1,1,1,1);
-	for (int i=0; i<nDoodads; i++) {
+	for (int i=0, k=0; i<nDoodads; i++) {
 		short dd = ddr[i];
-		if ((dd >= wmo->doodadsets[doodadset].start) && (dd < (wmo->doodadsets[doodadset].start+wmo->doodadsets[doodadset].size))) {
+		if ((dd >= set.start) && (dd < (set.start+set.size))) {
+			Vec3D tpos(doodadbounds.x[k], doodadbounds.y[k], doodadbounds.z[k]);
+			bool show = doodadbounds.isVisible(k) && gWorld->occlusion.visibleSphere(tpos, doodadbounds.r[k]);
+			k++;
+			if (!show) continue;
 
 			ModelInstance &mi = wmo->modelis[dd];
 
@@ -938,7 +998,7 @@ void WMOGroup::drawLiquid()
 		glDisable(GL_ALPHA_TEST);
 		glDepthMask(GL_TRUE);
 		glColor4f(1,1,1,1);
-		lq->draw();
+		lq->draw(dist);
 		glDisable(GL_LIGHT2);
 	}
 }
@@ -988,20 +1048,23 @@ void WMOFog::setup()
 	}
 }
 
-int WMOManager::add(std::string name)
+int WMOManager::add(const std::string &name)
+{
+	return add(AssetPath(name));
+}
+
+int WMOManager::add(const AssetPath &path)
 {
 	int id;
-	if (names.find(name) != names.end()) {
-		id = names[name];
-		items[id]->addref();
-		//gLog("Loading WMO %s [already loaded]\n",name.c_str());
+	if (addref(path, id)) {
+		//gLog("Loading WMO %s [already loaded]\n",path.c_str());
 		return id;
 	}
 
 	// load new
-	WMO *wmo = new WMO(name);
+	WMO *wmo = new WMO(path.str());
 	id = nextID();
-    do_add(name, id, wmo);
+    do_add(path, id, wmo);
     return id;
 }
 
@@ -1027,6 +1090,19 @@ WMOInstance::WMOInstance(WMO *wmo, MPQFile &f) : wmo (wmo)
 	//gLog("WMO instance: %s (%d, %d)\n", wmo->name.c_str(), d2, d3);
 }
 
+WMOInstance::WMOInstance(WMO *wmo, const WMOPlacement &p) : wmo (wmo)
+{
+	id = p.id;
+	pos = p.pos;
+	dir = p.dir;
+	pos2 = p.pos2;
+	pos3 = p.pos3;
+	d2 = p.d2;
+	d3 = p.d3;
+
+	doodadset = (d2 & 0xFFFF0000) >> 16;
+}
+
 void WMOInstance::draw()
 {
 	if (ids.find(id) != ids.end()) return;
@@ -1066,6 +1142,52 @@ void WMOInstance::drawPortals()
 }
 */
 
+bool WMOGroup::intersect(const Vec3D &o, const Vec3D &d, float &t)
+{
+	if (bvh.empty()) return false;
+	float tnear = 0, tfar = t;
+	if (!rayBox(o, Vec3D(1.0f / d.x, 1.0f / d.y, 1.0f / d.z), vmin, vmax, tnear, tfar)) return false;
+	return bvh.intersect(o, d, t);
+}
+
+void WMOGroup::addOccluders(OcclusionBuffer &ob, const float *model)
+{
+	const std::vector<Vec3D> &verts = bvh.getVertices();
+	if (occluder.empty() || verts.empty()) return;
+	ob.addTriangles(&verts[0], verts.size(), &occluder[0], occluder.size() / 3, model);
+}
+
+bool WMO::intersect(const Vec3D &o, const Vec3D &d, float &t)
+{
+	if (!ok) return false;
+	bool hit = false;
+	for (int i=0; i<nGroups; i++) {
+		if (groups[i].intersect(o, d, t)) hit = true;
+	}
+	return hit;
+}
+
+bool WMOInstance::intersect(const Vec3D &o, const Vec3D &d, float &t)
+{
+	if (!wmo->ok || !raySphere(o, d, pos, std::max(wmo->v1.length(), wmo->v2.length()), t)) return false;
+	return wmo->intersect(unrotate(o - pos, dir), unrotate(d, dir), t);
+}
+
+void WMOInstance::placement(float *m) const
+{
+	// the rotation is the transpose of the one unrotate() undoes
+	Vec3D r[3] = {unrotate(Vec3D(1,0,0), dir), unrotate(Vec3D(0,1,0), dir), unrotate(Vec3D(0,0,1), dir)};
+	float p[3] = {pos.x, pos.y, pos.z};
+	for (int i=0; i<3; i++) {
+		m[i] = r[i].x;
+		m[4+i] = r[i].y;
+		m[8+i] = r[i].z;
+		m[12+i] = p[i];
+		m[i*4+3] = 0;
+	}
+	m[15] = 1;
+}
+
 void WMOInstance::reset()
 {
     ids.clear();
@@ -4,7 +4,11 @@
 #include "manager.h"
 #include "vec3d.h"
 #include "mpq.h"
+#include "tiledata.h"
 #include "model.h"
+#include "raycast.h"
+#include "frustum.h"
+#include "occlusion.h"
 #include <vector>
 #include <set>
 #include "video.h"
@@ -22,31 +26,49 @@ class WMOGroup {
 	Vec3D v1,v2;
 	int nTriangles, nVertices;
 	GLuint dl,dl_light;
-	Vec3D center;
-	float rad;
 	int num;
 	int fog;
 	int nDoodads;
 	short *ddr;
 	Liquid *lq;
+	// materials the display list binds
+	std::vector<TextureID> textures;
+	// the drawn triangles, for picking
+	TriangleBVH bvh;
+	// the opaque ones among them, into bvh's vertices, back faces added
+	// where the material is two-sided
+	std::vector<unsigned short> occluder;
+	// this frame's doodads of the set being drawn
+	SphereList doodadbounds;
 public:
 	Vec3D b1,b2;
 	Vec3D vmin, vmax;
+	Vec3D center;
+	float rad;
 	bool indoor, hascv;
 	bool visible;
+	// from the camera as of the last draw(), for the liquid's textures
+	float dist;
 
 	bool outdoorLights;
 	std::string name;
 
-	WMOGroup() : dl(0) {}
+	WMOGroup() : dl(0), dist(0) {}
 	~WMOGroup();
 	void init(WMO *wmo, MPQFile &f, int num, char *names);
 	void initDisplayList();
 	void initLighting(int nLR, short *useLights);
+	// only called when the group is in the frustum and not occluded,
+	// WMO::draw culls
 	void draw(const Vec3D& ofs, const float rot);
 	void drawLiquid();
 	void drawDoodads(int doodadset, const Vec3D& ofs, const float rot);
 	void setupFog();
+	// o and d in WMO space; t as for rayTriangle
+	bool intersect(const Vec3D &o, const Vec3D &d, float &t);
+	// model places the group like the instance draws it
+	void addOccluders(OcclusionBuffer &ob, const float *model);
+	size_t occluderTriangles() const { return occluder.size() / 3; }
 };
 
 struct WMOMaterial {
@@ -137,17 +159,22 @@ public:
 	Model *skybox;
 	int sbid;
 
+	// the groups as placed by the instance being drawn
+	SphereList groupbounds;
+
 	WMO(std::string name);
 	~WMO();
 	void draw(int doodadset, const Vec3D& ofs, const float rot);
 	//void drawPortals();
 	void drawSkybox();
+	bool intersect(const Vec3D &o, const Vec3D &d, float &t);
 };
 
 
 class WMOManager: public SimpleManager {
 public:
-	int add(std::string name);
+	int add(const std::string &name);
+	int add(const AssetPath &path);
 };
 
 
@@ -161,8 +188,13 @@ public:
 	int doodadset;
 
 	WMOInstance(WMO *wmo, MPQFile &f);
+	WMOInstance(WMO *wmo, const WMOPlacement &p);
 	void draw();
 	//void drawPortals();
+	// o and d in world space, the doodads are not hit
+	bool intersect(const Vec3D &o, const Vec3D &d, float &t);
+	// the transform draw() applies, column major
+	void placement(float *m) const;
 
 	static void reset();
 };
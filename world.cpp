@@ -1,18 +1,19 @@
 #include "world.h"
 #include <cassert>
+#include <algorithm>
+#include <chrono>
+#include <set>
 
 using namespace std;
 
 World *gWorld=0;
 
-World::World(const char* name):basename(name)
+World::World(const char* name):basename(name), streamer(name)
 {
 	gWorld = this;
 
 	gLog("\nLoading world %s\n", name);
 
-	for (int i=0; i<MAPTILECACHESIZE; i++) maptilecache[i] = 0;
-
 	autoheight = false;
 
 	init();
@@ -41,9 +42,12 @@ void World::init()
 	animtime = 0;
 
 	ex = ez = -1;
+	predx = predz = -1;
+	committing = 0;
 	loading = false;
 
 	drawfog = false;
+	occlusionculling = true;
 
 	memset(maps,0,sizeof(maps));
 
@@ -341,7 +345,7 @@ void World::initLowresTerrain()
 
 				// Generate display list
 				if (dl == 0) {
-					gLog("Failed to create display list for tile %d,%d\n", i, j);
+					gLogError("Failed to create display list for tile %d,%d\n", i, j);
 					continue;
 				}
 
@@ -508,7 +512,7 @@ void World::initWMOs()
 			for (int i=0; i<gnWMO; i++) {
 				int id;
 				f.read(&id, 4);
-				WMO *wmo = (WMO*)wmomanager.items[wmomanager.get(gwmos[id])];
+				WMO *wmo = (WMO*)wmomanager.item(wmomanager.get(gwmos[id]));
 				WMOInstance inst(wmo, f);
 				gwmois.push_back(inst);
 			}
@@ -526,9 +530,7 @@ World::~World()
 		}
 	}
 
-	for (int i=0; i<MAPTILECACHESIZE; i++) {
-		if (maptilecache[i] != 0) delete maptilecache[i];
-	}
+	tiles.clear();
 
 	for (vector<string>::iterator it = gwmos.begin(); it != gwmos.end(); ++it) {
 		wmomanager.delbyname(*it);
@@ -564,14 +566,19 @@ void World::enterTile(int x, int z)
 	cz = z;
 	for (int j=0; j<3; j++) {
 		for (int i=0; i<3; i++) {
-			current[j][i] = loadTile(x-1+i, z-1+j);
+			current[j][i] = residentTile(x-1+i, z-1+j);
 		}
 	}
+	// the tile under the camera can't wait, streamTiles() fills in the
+	// others as they arrive
+	if (current[1][1] == 0) current[1][1] = loadTile(x, z);
+
 	if (autoheight && current[1][1]!=0 && current[1][1]->ok) {
-		//Vec3D vc = (current[1][1]->topnode.vmax + current[1][1]->topnode.vmin) * 0.5f;
-		Vec3D vc = current[1][1]->topnode.vmax;
-		if (vc.y < 0) vc.y = 0;
-		camera.y = vc.y + 50.0f;
+		// the ground right below, or the highest point when that is a hole
+		float h;
+		if (!getHeight(camera.x, camera.z, h)) h = current[1][1]->topnode.vmax.y;
+		if (h < 0) h = 0;
+		camera.y = h + 50.0f;
 
 		autoheight = false;
 	}
@@ -584,37 +591,220 @@ MapTile *World::loadTile(int x, int z)
 		return 0;
 	}
 
-	int firstnull = MAPTILECACHESIZE;
-	for (int i=0; i<MAPTILECACHESIZE; i++) {
-		if ((maptilecache[i] != 0)  && (maptilecache[i]->x == x) && (maptilecache[i]->z == z)) {
-            return maptilecache[i];
+	MapTile *tile = tiles.find(x, z);
+	if (tile) {
+		// still being committed, no time to spread it out any more
+		if (tile->commit(0) && tile == committing) committing = 0;
+		return tile;
+	}
+
+	// a parse the streamer already finished saves reading the file here
+	TileData *data = streamer.take(x, z);
+	if (data) {
+		tile = new MapTile(data);
+		tile->commit(0);
+	} else {
+		char name[256];
+		sprintf(name,"World\\Maps\\%s\\%s_%d_%d.adt", basename.c_str(), basename.c_str(), x, z);
+		tile = new MapTile(x,z,name);
+	}
+	tiles.insert(tile);
+	return tile;
+}
+
+float World::tileScore(MapTile *tile)
+{
+	// never the ones around the camera or ahead of it
+	if (tile == committing || wantedTile(tile->x, tile->z)) return -1;
+
+	// distance in tiles from the stretch the camera is expected to cover
+	Vec3D a = camera, b = streamer.predicted();
+	Vec3D c((tile->x + 0.5f) * TILESIZE, 0, (tile->z + 0.5f) * TILESIZE);
+	a.y = b.y = 0;
+	Vec3D ab = b - a;
+	float len2 = ab * ab;
+	float t = len2 > 0 ? std::max(0.0f, std::min(1.0f, ((c - a) * ab) / len2)) : 0;
+	return (c - (a + ab * t)).length() / TILESIZE;
+}
+
+void World::evictTiles()
+{
+	// the streamer's parses count against the same budget
+	size_t pending = streamer.pendingBytes();
+	MapTile *tile;
+	while ((tile = tiles.evict([this](MapTile *t) { return tileScore(t); }, pending)) != 0) {
+		streamer.forget(tile->x, tile->z);
+		for (int j=0; j<3; j++) {
+			for (int i=0; i<3; i++) {
+				if (current[j][i] == tile) current[j][i] = 0;
+			}
 		}
-		if (maptilecache[i] == 0 && i < firstnull) firstnull = i;
 	}
-	// ok we need to find a place in the cache
-	if (firstnull == MAPTILECACHESIZE) {
-		int score, maxscore = 0, maxidx = 0;
-		// oh shit we need to throw away a tile
-		for (int i=0; i<MAPTILECACHESIZE; i++) {
-			score = abs(maptilecache[i]->x - cx) + abs(maptilecache[i]->z - cz);
-			if (score>maxscore) {
-				maxscore = score;
-				maxidx = i;
+
+	// still over with all that could go gone: the tiles ahead of the
+	// camera wait until they are needed, streamTiles won't ask again
+	if (tiles.bytes() + pending > TileCache::memoryBudget) {
+		streamer.drop([this](int x, int z) { return abs(x - cx) > 1 || abs(z - cz) > 1; });
+	}
+}
+
+bool World::getHeight(float x, float z, float &h)
+{
+	if (!(x >= 0 && z >= 0)) return false;
+	int tx = (int)(x / TILESIZE), tz = (int)(z / TILESIZE);
+	if (!oktile(tx,tz)) return false;
+
+	MapTile *tile = tiles.peek(tx, tz);
+	if (!tile || !tile->ok) return false;
+	return tile->heightfield.height((x - tile->xbase) * (1.0f / UNITSIZE), (z - tile->zbase) * (1.0f / UNITSIZE), h);
+}
+
+int World::getHeights(int n, const float *x, const float *z, float *h, bool *hit)
+{
+	// queries in bulk tend to come from the same tile
+	MapTile *tile = 0;
+	int tx = -1, tz = -1, hits = 0;
+	for (int i=0; i<n; i++) {
+		bool ok = false;
+		if (x[i] >= 0 && z[i] >= 0) {
+			int ix = (int)(x[i] / TILESIZE), iz = (int)(z[i] / TILESIZE);
+			if (ix != tx || iz != tz) {
+				tx = ix;
+				tz = iz;
+				tile = oktile(tx,tz) ? tiles.peek(tx, tz) : 0;
+				if (tile && !tile->ok) tile = 0;
 			}
+			if (tile) ok = tile->heightfield.height((x[i] - tile->xbase) * (1.0f / UNITSIZE), (z[i] - tile->zbase) * (1.0f / UNITSIZE), h[i]);
 		}
+		if (ok) hits++;
+		if (hit) hit[i] = ok;
+	}
+	return hits;
+}
 
-		// maxidx is the winner (loser)
-		delete maptilecache[maxidx];
-		firstnull = maxidx;
+bool World::raycast(const Vec3D &o, const Vec3D &d, float maxT, RayHit &hit, bool models)
+{
+	Vec3D inv(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+	float t = maxT;
+	hit = RayHit();
+
+	const vector<MapTile*> &loaded = tiles.all();
+	for (size_t k=0; k<loaded.size(); k++) {
+		MapTile *tile = loaded[k];
+		if (!tile->ok || !tile->isReady()) continue;
+
+		if (tile->topnode.intersect(o, d, inv, t)) {
+			hit.kind = RayHit::TERRAIN;
+			hit.tile = tile;
+		}
+		// objects stick out of the terrain boxes, they are checked on their own
+		for (size_t i=0; i<tile->wmois.size(); i++) {
+			if (tile->wmois[i].intersect(o, d, t)) {
+				hit.kind = RayHit::WMO;
+				hit.tile = tile;
+				hit.wmo = &tile->wmois[i];
+			}
+		}
+		for (size_t i=0; models && i<tile->modelis.size(); i++) {
+			if (tile->modelis[i].intersect(o, d, t)) {
+				hit.kind = RayHit::MODEL;
+				hit.tile = tile;
+				hit.model = &tile->modelis[i];
+			}
+		}
+	}
+	for (size_t i=0; i<gwmois.size(); i++) {
+		if (gwmois[i].intersect(o, d, t)) {
+			hit.kind = RayHit::WMO;
+			hit.tile = 0;
+			hit.wmo = &gwmois[i];
+		}
 	}
 
-	// TODO: make a loader thread  or something :(
+	if (hit.kind == RayHit::NONE) return false;
+	hit.t = t;
+	hit.point = o + d * t;
+	return true;
+}
 
-	char name[256];
-	sprintf(name,"World\\Maps\\%s\\%s_%d_%d.adt", basename.c_str(), basename.c_str(), x, z);
+bool World::lineOfSight(const Vec3D &a, const Vec3D &b)
+{
+	RayHit hit;
+	// stop short so that what a and b stand on doesn't count
+	return !raycast(a, b - a, 0.999f, hit, false);
+}
 
-	maptilecache[firstnull] = new MapTile(x,z,name);
-	return maptilecache[firstnull];
+MapTile *World::residentTile(int x, int z)
+{
+	MapTile *tile = tiles.find(x, z);
+	return (tile && tile->isReady()) ? tile : 0;
+}
+
+bool World::wantedTile(int x, int z)
+{
+	return (abs(x - cx) <= 1 && abs(z - cz) <= 1) || (abs(x - predx) <= 1 && abs(z - predz) <= 1);
+}
+
+void World::streamTiles(float dt)
+{
+	int px, pz;
+	streamer.predict(camera, dt, px, pz);
+
+	// no further than the next tile over: the cache holds the 3x3 around
+	// the camera plus the edge it is moving into
+	predx = std::max(cx - 1, std::min(cx + 1, px));
+	predz = std::max(cz - 1, std::min(cz + 1, pz));
+
+	// what is around the camera first, then what it is heading for. One
+	// tile is committed at a time, and only once the streamer parsed it
+	int bx = -1, bz = -1;
+	// parses for tiles the camera turned away from, or that got loaded on
+	// the spot meanwhile, would never be taken
+	streamer.drop([this](int x, int z) { return !wantedTile(x, z) || tiles.peek(x, z) != 0; });
+	// the tiles around the camera are needed regardless, the ones ahead
+	// of it are not parsed past the tile memory budget
+	size_t used = tiles.bytes() + streamer.pendingBytes();
+	for (int pass=0; pass<2; pass++) {
+		int ox = pass ? predx : cx;
+		int oz = pass ? predz : cz;
+		if (pass && ox == cx && oz == cz) break;
+		for (int j=-1; j<=1; j++) {
+			for (int i=-1; i<=1; i++) {
+				int x = ox + i, z = oz + j;
+				if (!oktile(x,z) || !maps[z][x] || tiles.find(x,z)) continue;
+				if ((pass == 0 || used + sizeof(TileData) <= TileCache::memoryBudget) && streamer.prefetch(x, z)) used += sizeof(TileData);
+				if (bx == -1 && streamer.isWarm(x, z)) {
+					bx = x;
+					bz = z;
+				}
+			}
+		}
+	}
+
+	if (!committing && bx != -1) {
+		TileData *data = streamer.take(bx, bz);
+		if (data) {
+			committing = new MapTile(data);
+			tiles.insert(committing);
+		}
+	}
+
+	if (committing) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (committing->commit(MapTile::commitBudgetMs)) committing = 0;
+		streamer.built(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	// what fell out of the budget goes a slice at a time
+	evictTiles();
+	tiles.collect(MapTile::commitBudgetMs);
+
+	// neighbours that were not there yet when the camera arrived
+	for (int j=0; j<3; j++) {
+		for (int i=0; i<3; i++) {
+			if (current[j][i] == 0) current[j][i] = residentTile(cx-1+i, cz-1+j);
+		}
+	}
 }
 
 
@@ -731,6 +921,92 @@ void World::setupFog()
 	culldistance2 = culldistance * culldistance;
 }
 
+void World::buildOcclusion()
+{
+	// WMO groups occlude from this much of the distance to them across,
+	// up to this many triangles a frame, the biggest first
+	const float minOccluderSize = 0.1f;
+	const size_t maxWMOOccluders = 40000;
+
+	occlusion.begin(frustum.matrix);
+
+	if (drawterrain) {
+		std::vector<Vec3D> verts;
+		std::vector<unsigned short> tris;
+		for (int j=0; j<3; j++) {
+			for (int i=0; i<3; i++) {
+				MapTile *tile = current[j][i];
+				if (!oktile(i, j) || tile == 0 || !tile->ok) continue;
+				// only what MapTile::draw just drew in full; chunks without
+				// layers are marked visible for their water but draw no ground
+				bool show[16*16];
+				for (int k=0; k<16*16; k++) {
+					const MapChunk &c = tile->chunks[k / 16][k % 16];
+					show[k] = c.visible && c.nTextures > 0;
+				}
+				tile->heightfield.occluder(tile->xbase, tile->zbase, show, verts, tris);
+				if (!tris.empty()) occlusion.addTriangles(&verts[0], verts.size(), &tris[0], tris.size() / 3);
+			}
+		}
+	}
+
+	if (drawwmo) {
+		struct Occluder {
+			WMOInstance *wi;
+			int group;
+			float size;
+			bool operator< (const Occluder &o) const { return size > o.size; }
+		};
+		std::vector<Occluder> occluders;
+		std::set<int> seen;
+
+		std::vector<WMOInstance*> instances;
+		for (int i=0; i<gnWMO; i++) instances.push_back(&gwmois[i]);
+		for (int j=0; j<3; j++) {
+			for (int i=0; i<3; i++) {
+				MapTile *tile = current[j][i];
+				if (!oktile(i, j) || tile == 0 || !tile->ok) continue;
+				for (int k=0; k<tile->nWMO; k++) instances.push_back(&tile->wmois[k]);
+			}
+		}
+
+		for (size_t i=0; i<instances.size(); i++) {
+			WMOInstance *wi = instances[i];
+			if (!wi->wmo->ok || !seen.insert(wi->id).second) continue;
+			float m[16];
+			wi->placement(m);
+			for (int g=0; g<wi->wmo->nGroups; g++) {
+				WMOGroup &group = wi->wmo->groups[g];
+				if (group.occluderTriangles() == 0) continue;
+				const Vec3D &c = group.center;
+				Vec3D pos(m[0]*c.x + m[4]*c.y + m[8]*c.z + m[12],
+						  m[1]*c.x + m[5]*c.y + m[9]*c.z + m[13],
+						  m[2]*c.x + m[6]*c.y + m[10]*c.z + m[14]);
+				float dist = (pos - camera).length();
+				// WMOGroup::draw leaves these out
+				if (dist - group.rad >= culldistance) continue;
+				if (group.rad < minOccluderSize * dist) continue;
+				if (!frustum.intersectsSphere(pos, group.rad)) continue;
+				Occluder o = {wi, g, group.rad / std::max(dist, 1.0f)};
+				occluders.push_back(o);
+			}
+		}
+
+		std::sort(occluders.begin(), occluders.end());
+		size_t budget = maxWMOOccluders;
+		for (size_t i=0; i<occluders.size(); i++) {
+			WMOGroup &group = occluders[i].wi->wmo->groups[occluders[i].group];
+			if (group.occluderTriangles() > budget) continue;
+			budget -= group.occluderTriangles();
+			float m[16];
+			occluders[i].wi->placement(m);
+			group.addOccluders(occlusion, m);
+		}
+	}
+
+	occlusion.finish();
+}
+
 void World::draw()
 {
 	WMOInstance::reset();
@@ -880,6 +1156,10 @@ void World::draw()
 		glLightf(light, GL_QUADRATIC_ATTENUATION, l_quadratic);
 	}
 
+	// after the terrain draw, it set which chunks are in view
+	if (occlusionculling) buildOcclusion();
+	else occlusion.clear();
+
 	if (gnWMO && drawwmo) {
 		oob = false;
 		for (int i = 0; i < gnWMO; i++) {
@@ -935,11 +1215,16 @@ void World::tick(float dt)
 {
 	if (loading) {
 		if (ex!=-1 && ez!=-1) {
+			// a hitch is a tile the camera moved onto before it was streamed in
+			bool hitch = oktile(ex,ez) && maps[ez][ex] && !residentTile(ex,ez);
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 			enterTile(ex,ez);
+			streamer.crossed(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(), hitch);
 		}
 		ex = ez = -1;
 		loading = false;
 	}
+	if (!oob) streamTiles(dt);
 	while (dt > 0.1f) {
 		modelmanager.updateEmitters(0.1f);
 		dt -= 0.1f;
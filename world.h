@@ -7,18 +7,31 @@
 #include "frustum.h"
 #include "sky.h"
 #include "nodes.h"
+#include "tilestream.h"
+#include "tilecache.h"
 
 #include <string>
 
-#define MAPTILECACHESIZE 16
-
 const float detail_size = 8.0f;
 
 class World {
 
-	MapTile *maptilecache[MAPTILECACHESIZE];
 	MapTile *current[3][3];
 	int ex,ez;
+	// tile the camera is predicted to be over next
+	int predx, predz;
+	// streamed tile that commit() is being spread over frames for
+	MapTile *committing;
+
+	// how much the camera path needs the tile, below zero if it can't go
+	float tileScore(MapTile *tile);
+	void evictTiles();
+	// only tiles that are done committing
+	MapTile *residentTile(int x, int z);
+	bool wantedTile(int x, int z);
+	void streamTiles(float dt);
+	// draws terrain and the big WMO groups in view into occlusion
+	void buildOcclusion();
 public:
 
 	std::string basename;
@@ -45,6 +58,8 @@ public:
 
 	bool thirdperson, lighting, drawmodels, drawdoodads, drawterrain, drawwmo, loading, drawhighres, drawfog, drawnodes, drawpathpoints, drawnodelabels;
 	bool uselowlod;
+	// test WMOs and models against occlusion before drawing them
+	bool occlusionculling;
 
 	GLuint detailtexcoords, alphatexcoords;
 
@@ -53,12 +68,16 @@ public:
 	TextureID water;
 	Vec3D camera, lookat;
 	Frustum frustum;
+	OcclusionBuffer occlusion;
 	int cx,cz;
 	bool oob;
 
 	WMOManager wmomanager;
 	ModelManager modelmanager;
 
+	TileStreamer streamer;
+	TileCache tiles;
+
 	OutdoorLighting *ol;
 	OutdoorLightStats outdoorLightStats;
 
@@ -72,6 +91,20 @@ public:
 	void initWMOs();
 	void initLowresTerrain();
 
+	// ground height at x,z from the loaded tiles; false over holes and
+	// where no tile is loaded
+	bool getHeight(float x, float z, float &h);
+	// n of the above at once; hit, if given, tells which ones worked.
+	// Returns how many did
+	int getHeights(int n, const float *x, const float *z, float *h, bool *hit = 0);
+
+	// First thing o + d*t hits for t in [0, maxT]: terrain, WMOs and
+	// models of the loaded tiles, and the map's own WMOs. Models are only
+	// boxes, leave them out to find the surfaces
+	bool raycast(const Vec3D &o, const Vec3D &d, float maxT, RayHit &hit, bool models = true);
+	// no terrain or WMO between a and b
+	bool lineOfSight(const Vec3D &a, const Vec3D &b);
+
 	void enterTile(int x, int z);
 	MapTile *loadTile(int x, int z);
 	void tick(float dt);
@@ -18,6 +18,9 @@
 #include <cstdlib>
 #include <algorithm>
 #include <filesystem>
+#include <chrono>
+#include <mutex>
+#include <cstdarg>
 
 #include "mpq.h"
 #include "video.h"
@@ -26,6 +29,11 @@
 #include "test.h"
 #include "menu.h"
 #include "areadb.h"
+#include "threadpool.h"
+#include "maptile.h"
+#include "blp.h"
+#include <atomic>
+#include <set>
 
 #include "Database\Database.h"
 
@@ -37,6 +45,7 @@ std::string gamePath = "D:\\twmoa_1171";//"./";
 int expansion = 0;
 FILE *flog;
 bool glogfirst = true;
+int gLogLevel = LOG_NOTICE;
 
 std::vector<AppState*> gStates;
 bool gPop = false;
@@ -52,7 +61,7 @@ void initFonts()
 {
     ftex = loadTGA("arial.tga", false);
     if (ftex == 0) {
-        gLog("Failed to load arial.tga font!\n");
+        gLogError("Failed to load arial.tga font!\n");
         exit(1);
     }
 
@@ -70,6 +79,63 @@ void deleteFonts()
     delete f32;
 }
 
+// Fills the texture cache with every texture the terrain of a map uses,
+// decoding on all workers.
+void prebuildTextures(const char *map)
+{
+    if (!gMPQDiskCache.isOpen())
+    {
+        gLogError("-prebuildtextures needs -diskcache\n");
+        return;
+    }
+
+    // the map's tiles as the listfiles name them, without probing all 64x64
+    // positions; archives without a listfile still get probed
+    gMPQCatalog.build();
+    std::string prefix = MPQCache::normalize((std::string("World\\Maps\\") + map + "\\").c_str());
+    std::vector<std::string> tiles;
+    for (size_t k=0; k<gMPQCatalog.size(); k++) {
+        std::string name = MPQCache::normalize(gMPQCatalog.name(k));
+        if (name.size() > prefix.size() + 4 && !name.compare(0, prefix.size(), prefix) &&
+            name.find('\\', prefix.size()) == std::string::npos && !name.compare(name.size() - 4, 4, ".ADT"))
+            tiles.push_back(gMPQCatalog.name(k));
+    }
+    if (tiles.empty()) {
+        char fn[256];
+        for (int j=0; j<64; j++) {
+            for (int i=0; i<64; i++) {
+                snprintf(fn, sizeof(fn), "World\\Maps\\%s\\%s_%d_%d.adt", map, map, i, j);
+                tiles.push_back(fn);
+            }
+        }
+    }
+
+    std::set<std::string> unique;
+    for (size_t k=0; k<tiles.size(); k++) {
+        if (!MPQFile::exists(tiles[k].c_str()))
+            continue;
+
+        std::vector<std::string> names;
+        MapTile::textureNames(tiles[k].c_str(), names);
+        unique.insert(names.begin(), names.end());
+    }
+
+    std::vector<std::string> textures(unique.begin(), unique.end());
+    gLogNotice("Prebuilding %zu textures for %s\n", textures.size(), map);
+
+    std::atomic<size_t> decoded(0);
+    gThreadPool.parallelFor(textures.size(), [&](size_t i)
+    {
+        BLPImage img;
+        if (decodeBLP(AssetPath(textures[i]), img))
+            decoded++;
+        else
+            gLogError("Can't decode %s\n", textures[i].c_str());
+    });
+
+    gLogNotice("Prebuilt %zu of %zu textures\n", (size_t)decoded, textures.size());
+}
+
 /*#ifdef _WINDOWS
 // HACK: my stupid compiler wont use main()
 int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
@@ -106,12 +172,20 @@ std::string MakeConnectionString()
 
 int main(int argc, char *argv[])
 {
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    // verbosity has to be known before anything is logged
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i],"-v")) gLogLevel = LOG_INFO;
+        else if (!strcmp(argv[i],"-vv")) gLogLevel = LOG_DEBUG;
+    }
+
     std::string const connection_string = MakeConnectionString();
 
-    printf("\nConnecting to database.\n");
+    gLog("\nConnecting to database.\n");
     if (!GameDb.Initialize(connection_string.c_str()))
     {
-        printf("\nError: Cannot connect to world database!\n");
+        gLogError("\nError: Cannot connect to world database!\n");
         getchar();
         return 1;
     }
@@ -125,6 +199,9 @@ int main(int argc, char *argv[])
 
     const char *override_game_path = NULL;
     int maxFps = 60;
+    int workerThreads = -1;
+    std::string diskCacheDir;
+    const char *prebuildMap = NULL;
 
     for (int i=1; i<argc; i++) {
         if (!strcmp(argv[i],"-gamepath")) {
@@ -173,6 +250,57 @@ int main(int argc, char *argv[])
             i++;
             maxFps = std::max(1, atoi(argv[i]));
         }
+        else if (!strcmp(argv[i],"-mmap")) MPQArchive::mapFiles = true;
+        else if (!strcmp(argv[i],"-threads") && i+1 < argc)
+        {
+            // background workers, 0 = none, everything loads on the main
+            // thread; without the flag one per core minus the main thread
+            i++;
+            workerThreads = std::max(0, atoi(argv[i]));
+        }
+        else if (!strcmp(argv[i],"-mpqcache") && i+1 < argc)
+        {
+            // decompressed file cache budget in MB
+            i++;
+            gMPQCache.setBudget((size_t)std::max(0, atoi(argv[i])) * 1024 * 1024);
+        }
+        else if (!strcmp(argv[i],"-diskcache") && i+1 < argc)
+        {
+            // keep decompressed files in this directory between runs
+            i++;
+            diskCacheDir = argv[i];
+        }
+        else if (!strcmp(argv[i],"-texbudget") && i+1 < argc)
+        {
+            // milliseconds per frame spent uploading decoded textures
+            i++;
+            video.textures.uploadBudgetMs = std::max(0.0f, (float)atof(argv[i]));
+        }
+        else if (!strcmp(argv[i],"-texmem") && i+1 < argc)
+        {
+            // texture memory in MB before unused mips are dropped, 0 = no limit
+            i++;
+            video.textures.memoryBudget = (size_t)std::max(0, atoi(argv[i])) * 1024 * 1024;
+        }
+        else if (!strcmp(argv[i],"-tilebudget") && i+1 < argc)
+        {
+            // milliseconds per frame spent committing streamed tiles and unloading dropped ones, 0 = no limit
+            i++;
+            MapTile::commitBudgetMs = std::max(0.0f, (float)atof(argv[i]));
+        }
+        else if (!strcmp(argv[i],"-tilemem") && i+1 < argc)
+        {
+            // map tile memory in MB, parses waiting to be committed included, before
+            // the tiles off the camera path are dropped
+            i++;
+            TileCache::memoryBudget = (size_t)std::max(0, atoi(argv[i])) * 1024 * 1024;
+        }
+        else if (!strcmp(argv[i],"-prebuildtextures") && i+1 < argc)
+        {
+            // fill the texture cache for a map (its directory name) and quit
+            i++;
+            prebuildMap = argv[i];
+        }
     }
 
 
@@ -194,6 +322,8 @@ int main(int argc, char *argv[])
 
     gLog(APP_TITLE " " APP_VERSION "\nGame path: %s\n", gamePath.c_str());
 
+    gThreadPool.start(workerThreads);
+
 
     std::vector<MPQArchive*> archives;
     char path[512];
@@ -208,42 +338,36 @@ int main(int argc, char *argv[])
             sprintf(path, "%s%s", gamePath.c_str(), "patch.MPQ");
             MPQArchive* archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
 
             sprintf(path, "%s%s", gamePath.c_str(), "enUS\\Patch-enUS.MPQ");
             archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
 
             sprintf(path, "%s%s", gamePath.c_str(), "enUS\\Patch-enUS-2.MPQ");
             archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
 
             sprintf(path, "%s%s", gamePath.c_str(), "enUS\\Patch-enGB.MPQ");
             archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
 
             sprintf(path, "%s%s", gamePath.c_str(), "enUS\\Patch-deDE.MPQ");
             archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
 
             sprintf(path, "%s%s", gamePath.c_str(), "enUS\\Patch-frFR.MPQ");
             archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
         }
@@ -253,7 +377,6 @@ int main(int argc, char *argv[])
             sprintf(path, "%s%s", gamePath.c_str(), archiveNames[i]);
             MPQArchive* archive = new MPQArchive(path);
             if (archive) {
-                archive->ListFiles();
                 archives.push_back(archive);
             }
         }
@@ -290,6 +413,10 @@ int main(int argc, char *argv[])
         }
     }
 
+    gMPQIndex.build();
+    if (!diskCacheDir.empty())
+        gMPQDiskCache.open(diskCacheDir);
+
     gLog("Opening Area DBC Files...\n");
     gAreaDB.open();
 
@@ -299,10 +426,10 @@ int main(int argc, char *argv[])
     if (!(supportVBO && supportMultiTex)) {
         video.close();
         const char *msg = "Error: Cannot initialize OpenGL extensions.";
-        gLog("%s\n",msg);
-        gLog("Missing required extensions:\n");
-        if (!supportVBO) gLog("GL_ARB_vertex_buffer_object\n");
-        if (!supportMultiTex) gLog("GL_ARB_multitexture\n");
+        gLogError("%s\n",msg);
+        gLogError("Missing required extensions:\n");
+        if (!supportVBO) gLogError("GL_ARB_vertex_buffer_object\n");
+        if (!supportMultiTex) gLogError("GL_ARB_multitexture\n");
 #ifdef _WIN32
         MessageBox(0, msg, 0, MB_OK|MB_ICONEXCLAMATION);
         exit(1);
@@ -320,12 +447,20 @@ int main(int argc, char *argv[])
     unsigned int a;
     unsigned int b;
 
-    Menu *m = new Menu();
-    as = m;
+    if (prebuildMap) {
+        // no states pushed, so the main loop is skipped
+        prebuildTextures(prebuildMap);
+    } else {
+        Menu *m = new Menu();
+        as = m;
+
+        gLogNotice("Time to menu: %.2f s\n",
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
 
-    gStates.push_back(as);
-    if (gStates.size() > 100)
-        gStates.erase(gStates.begin(), gStates.begin() + 99);
+        gStates.push_back(as);
+        if (gStates.size() > 100)
+            gStates.erase(gStates.begin(), gStates.begin() + 99);
+    }
     //gStates.erase(gStates.begin());
 
     bool done = false;
@@ -360,6 +495,8 @@ int main(int argc, char *argv[])
 
         as->tick(ftime, dt/1000.0f);
 
+        video.textures.processUploads();
+
         as->display(ftime, dt/1000.0f);
 
         if (gPop) {
@@ -391,12 +528,17 @@ int main(int argc, char *argv[])
 
     video.close();
 
+    gThreadPool.shutdown();
+    gMPQDiskCache.close();
+    gMPQCatalog.clear();
+    gMPQIndex.clear();
     for (auto it = archives.begin(); it != archives.end(); ++it) {
         (*it)->close();
     }
     archives.clear();
 
     gLog("\nExiting.\n");
+    gLogClose();
 
     return 0;
 }
@@ -580,25 +722,76 @@ void getGamePath()
 #endif
 }
 
-void gLog(const char *str, ...)
+// worker threads log too
+static std::mutex logMutex;
+
+static void gLogV(int level, const char *str, va_list ap)
 {
+    bool toFile = level <= std::max(gLogLevel, (int)LOG_INFO);
+    bool toConsole = level <= gLogLevel;
+    if (!toFile && !toConsole)
+        return;
+
+    std::lock_guard<std::mutex> lock(logMutex);
+
     if (glogfirst) {
         flog = fopen("log.txt","w");
-        fclose(flog);
         glogfirst = false;
     }
 
-    flog = fopen("log.txt","a");
+    va_list aq;
+    if (toFile && flog) {
+        va_copy(aq, ap);
+        vfprintf(flog, str, aq);
+        va_end(aq);
+        fflush(flog);
+    }
 
+    if (toConsole) {
+        va_copy(aq, ap);
+        vfprintf(level == LOG_ERROR ? stderr : stdout, str, aq);
+        va_end(aq);
+    }
+}
+
+void gLogClose()
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    if (flog) {
+        fclose(flog);
+        flog = NULL;
+    }
+    glogfirst = false;
+}
+
+void gLog(const char *str, ...)
+{
     va_list ap;
+    va_start(ap, str);
+    gLogV(LOG_INFO, str, ap);
+    va_end(ap);
+}
 
-            va_start (ap, str);
-    vfprintf (flog, str, ap);
-            va_end (ap);
+void gLogError(const char *str, ...)
+{
+    va_list ap;
+    va_start(ap, str);
+    gLogV(LOG_ERROR, str, ap);
+    va_end(ap);
+}
 
-            va_start (ap,str);
-    vprintf(str,ap);
-            va_end(ap);
+void gLogNotice(const char *str, ...)
+{
+    va_list ap;
+    va_start(ap, str);
+    gLogV(LOG_NOTICE, str, ap);
+    va_end(ap);
+}
 
-    fclose(flog);
-};
+void gLogDebug(const char *str, ...)
+{
+    va_list ap;
+    va_start(ap, str);
+    gLogV(LOG_DEBUG, str, ap);
+    va_end(ap);
+}
@@ -39,7 +39,23 @@ std::string GetLast(const char* String);
 void Lower(std::string &text);
 void getGamePath();
 void check_stuff();
-void gLog(const char *str, ...);
+// Log levels: log.txt always gets everything up to LOG_INFO, the console
+// only what is at or below gLogLevel (LOG_NOTICE unless -v/-vv).
+enum LogLevel
+{
+    LOG_ERROR,
+    LOG_NOTICE,
+    LOG_INFO,
+    LOG_DEBUG
+};
+extern int gLogLevel;
+
+void gLog(const char *str, ...);        // LOG_INFO
+void gLogError(const char *str, ...);
+void gLogNotice(const char *str, ...);
+void gLogDebug(const char *str, ...);
+// closes log.txt at shutdown; later messages only reach the console
+void gLogClose();
 int file_exists(const char *path);
 
 extern int fullscreen;